@@ -161,6 +161,28 @@ extern "C" {
 void SysClock48(void);
 void SysClock72(void);
 
+// Idle task sleep (vPortSuppressTicksAndSleep).  The mode can be changed
+// at run time to compare current draw; see SET_IDLE_SLEEP.
+typedef enum {
+    IDLE_SLEEP_NONE,        // Busy idle loop.
+    IDLE_SLEEP_WFI,         // Sleep until the next interrupt; tick kept.
+    IDLE_SLEEP_TICKLESS     // Sleep with the tick suppressed (default).
+} IdleSleepMode;
+
+typedef struct {
+    uint32_t sleeps;            // WFI entered.
+    uint32_t aborts;            // Sleep abandoned; a task became ready.
+    uint64_t asleep_cycles;     // DWT cycles in WFI.
+    uint32_t start;             // Run-time counter at reset.
+    uint32_t max_ticks;         // Longest tickless sleep.
+    uint32_t max_wake_cycles;   // Longest time from wake to interrupts enabled.
+} IdleSleepStats;
+
+extern volatile uint8_t idle_sleep_mode;
+extern IdleSleepStats idle_sleep_stats;
+
+void resetIdleSleepStats(void);
+
 #ifdef __cplusplus
 }
 #endif
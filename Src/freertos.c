@@ -91,9 +91,44 @@ void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackTy
 void vApplicationGetTimerTaskMemory( StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize );
 
 /* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
 void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName);
 void vApplicationMallocFailedHook(void);
 
+/* USER CODE BEGIN 1 */
+/*
+ * Run-time stats count DWT cycles / 64 (~1.1MHz at 72MHz).  The cycle
+ * counter wraps in under a minute, so it is extended to 64 bits here.
+ * This is called on every context switch, which is far more often than
+ * that.  Task times are in cycles, so the units change with the system
+ * clock (48/72MHz); the CPU percentages are not affected.
+ */
+#define RUN_TIME_STATS_SHIFT 6
+
+static uint32_t runTimeLastCycles;
+static uint64_t runTimeCycles;
+
+void configureTimerForRunTimeStats(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  runTimeLastCycles = DWT->CYCCNT;
+  runTimeCycles = 0;
+}
+
+unsigned long getRunTimeCounterValue(void)
+{
+  UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  uint32_t now = DWT->CYCCNT;
+  runTimeCycles += now - runTimeLastCycles;
+  runTimeLastCycles = now;
+  unsigned long result = (unsigned long)(runTimeCycles >> RUN_TIME_STATS_SHIFT);
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return result;
+}
+/* USER CODE END 1 */
+
 /* USER CODE BEGIN 4 */
 __weak void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName)
 {
@@ -121,11 +156,157 @@ __weak void vApplicationMallocFailedHook(void)
 /* USER CODE END 5 */
 
 /* USER CODE BEGIN VPORT_SUPPORT_TICKS_AND_SLEEP */
-__weak void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+/*
+ * Tickless idle in Sleep mode.  This is the Cortex-M port's SysTick
+ * algorithm (configUSE_TICKLESS_IDLE == 1), with the tick period taken
+ * from SystemCoreClock on each call because SysClock48()/SysClock72()
+ * reprogram SysTick.  The HAL tick (TIM2) is suspended while asleep and
+ * advanced by the ticks slept.
+ *
+ * The ADC, DAC and UART keep running under DMA in Sleep mode, and their
+ * half/full transfer and UART idle interrupts wake the core, so each ADC
+ * block is still handled as soon as it is complete.  Stop mode is not
+ * used: it halts the ADC, the DAC and the UART RX DMA ring (USART2 is
+ * clocked from PCLK1 and cannot wake the core from Stop), and the ADC
+ * runs whenever the TNC is receiving.
+ */
+#define SYSTICK_MAX_COUNT 0xFFFFFFUL
+#define SYSTICK_STOPPED_COMPENSATION 45UL
+
+volatile uint8_t idle_sleep_mode = IDLE_SLEEP_TICKLESS;
+IdleSleepStats idle_sleep_stats;
+
+void resetIdleSleepStats(void)
+{
+  taskENTER_CRITICAL();
+  idle_sleep_stats.sleeps = 0;
+  idle_sleep_stats.aborts = 0;
+  idle_sleep_stats.asleep_cycles = 0;
+  idle_sleep_stats.start = getRunTimeCounterValue();
+  idle_sleep_stats.max_ticks = 0;
+  idle_sleep_stats.max_wake_cycles = 0;
+  taskEXIT_CRITICAL();
+}
+
+/*
+ * Sleep until an interrupt is pending.  Called with interrupts disabled;
+ * the interrupt is taken once they are enabled again.  Returns the cycle
+ * count on waking.
+ */
+static uint32_t idleSleep(void)
+{
+  uint32_t start = DWT->CYCCNT;
+  __DSB();
+  __WFI();
+  __ISB();
+  uint32_t wake = DWT->CYCCNT;
+  idle_sleep_stats.sleeps += 1;
+  idle_sleep_stats.asleep_cycles += wake - start;
+  return wake;
+}
+
+/* Time from waking to enabling interrupts, which delays the waking ISR. */
+static void recordWake(uint32_t wake)
+{
+  uint32_t cycles = DWT->CYCCNT - wake;
+  if (cycles > idle_sleep_stats.max_wake_cycles) idle_sleep_stats.max_wake_cycles = cycles;
+}
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
 {
-  // Generated when configUSE_TICKLESS_IDLE == 2.
-  // Function called in tasks.c (in portTASK_FUNCTION).
-  // TO BE COMPLETED or TO BE REPLACED by a user one, overriding that weak one.
+  if (idle_sleep_mode == IDLE_SLEEP_NONE) return;
+
+  if (idle_sleep_mode == IDLE_SLEEP_WFI)
+  {
+    __disable_irq();
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+    {
+      idle_sleep_stats.aborts += 1;
+    }
+    else
+    {
+      recordWake(idleSleep());
+    }
+    __enable_irq();
+    return;
+  }
+
+  const uint32_t countsPerTick = SystemCoreClock / configTICK_RATE_HZ;
+  const TickType_t maxTicks = SYSTICK_MAX_COUNT / countsPerTick;
+  if (xExpectedIdleTime > maxTicks) xExpectedIdleTime = maxTicks;
+
+  // Stop SysTick while the reload value is calculated.
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+  uint32_t reload = SysTick->VAL + (countsPerTick * (xExpectedIdleTime - 1UL));
+  if (reload > SYSTICK_STOPPED_COMPENSATION) reload -= SYSTICK_STOPPED_COMPENSATION;
+
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep)
+  {
+    // Restart the tick from where it was stopped.
+    SysTick->LOAD = SysTick->VAL;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = countsPerTick - 1UL;
+    idle_sleep_stats.aborts += 1;
+    __enable_irq();
+    return;
+  }
+
+  SysTick->LOAD = reload;
+  SysTick->VAL = 0UL;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  HAL_SuspendTick();
+
+  recordWake(idleSleep());
+
+  // Let the interrupt that ended the sleep run.
+  __enable_irq();
+  __DSB();
+  __ISB();
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  // Stop SysTick.  COUNTFLAG is set if it reached zero while asleep.
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk;
+
+  uint32_t completeTicks;
+  if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0)
+  {
+    // The tick interrupt ended the sleep; it has already been handled.
+    uint32_t load = (countsPerTick - 1UL) - (reload - SysTick->VAL);
+    if (load < SYSTICK_STOPPED_COMPENSATION || load > countsPerTick)
+    {
+      load = countsPerTick - 1UL;
+    }
+    SysTick->LOAD = load;
+    completeTicks = xExpectedIdleTime - 1UL;
+  }
+  else
+  {
+    // Another interrupt ended the sleep.
+    uint32_t decrements = (xExpectedIdleTime * countsPerTick) - SysTick->VAL;
+    completeTicks = decrements / countsPerTick;
+    SysTick->LOAD = ((completeTicks + 1UL) * countsPerTick) - decrements;
+  }
+
+  // Restart SysTick so the remainder of the tick period is counted, then
+  // return to the standard tick period.
+  SysTick->VAL = 0UL;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  vTaskStepTick(completeTicks);
+  SysTick->LOAD = countsPerTick - 1UL;
+
+  uwTick += completeTicks;
+  HAL_ResumeTick();
+
+  if (completeTicks > idle_sleep_stats.max_ticks) idle_sleep_stats.max_ticks = completeTicks;
+
+  __enable_irq();
 }
 /* USER CODE END VPORT_SUPPORT_TICKS_AND_SLEEP */
 
@@ -6,16 +6,15 @@
 
 namespace mobilinkd { namespace tnc {
 
-void AFSKModulator::init(const kiss::Hardware& hw)
+template <uint32_t BAUD_RATE, uint32_t MARK_FREQ, uint32_t SPACE_FREQ>
+void BasicAFSKModulator<BAUD_RATE, MARK_FREQ, SPACE_FREQ>::init(const kiss::Hardware& hw)
 {
     audio::setAudioOutputLevel();
     set_twist(hw.tx_twist);
 
     // Configure 72MHz clock for 26.4ksps.
     SysClock72();
-    __HAL_TIM_SET_AUTORELOAD(&htim7, 2726);
-    __HAL_TIM_SET_PRESCALER(&htim7, 0);
-    mobilinkd::dacTimerAdjust = dacTimerAdjust; 
+    activate();
 
     DAC_ChannelConfTypeDef sConfig;
 
@@ -34,4 +33,15 @@ void AFSKModulator::init(const kiss::Hardware& hw)
         CxxErrorHandler();
 }
 
+template <uint32_t BAUD_RATE, uint32_t MARK_FREQ, uint32_t SPACE_FREQ>
+void BasicAFSKModulator<BAUD_RATE, MARK_FREQ, SPACE_FREQ>::activate()
+{
+    __HAL_TIM_SET_AUTORELOAD(&htim7, 2726);
+    __HAL_TIM_SET_PRESCALER(&htim7, 0);
+    mobilinkd::dacTimerAdjust = dacTimerAdjust;
+}
+
+template struct BasicAFSKModulator<1200, 1200, 2200>;
+template struct BasicAFSKModulator<300, 1600, 1800>;
+
 }} // mobilinkd::tnc
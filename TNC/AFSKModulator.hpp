@@ -64,12 +64,26 @@ const int16_t sin_table[SIN_TABLE_LEN] = {
 };
 
 
-struct AFSKModulator : Modulator
+/**
+ * AFSK modulator.  The DAC runs at 26.4ksps and one half of the DMA
+ * buffer holds one bit.  The tones must be multiples of 100Hz, the
+ * sin_table resolution.
+ *
+ * @tparam BAUD_RATE is the bit rate.
+ * @tparam MARK_FREQ is the mark tone in Hz.
+ * @tparam SPACE_FREQ is the space tone in Hz.
+ */
+template <uint32_t BAUD_RATE, uint32_t MARK_FREQ, uint32_t SPACE_FREQ>
+struct BasicAFSKModulator : Modulator
 {
-    static const size_t DAC_BUFFER_LEN = 44;
-    static const size_t BIT_LEN = DAC_BUFFER_LEN / 2;
-    static const size_t MARK_SKIP = 12;
-    static const size_t SPACE_SKIP = 22;
+    static constexpr uint32_t SAMPLE_RATE = 26400;
+    static constexpr size_t BIT_LEN = SAMPLE_RATE / BAUD_RATE;
+    static constexpr size_t DAC_BUFFER_LEN = BIT_LEN * 2;
+    static constexpr size_t MARK_SKIP = MARK_FREQ * SIN_TABLE_LEN / SAMPLE_RATE;
+    static constexpr size_t SPACE_SKIP = SPACE_FREQ * SIN_TABLE_LEN / SAMPLE_RATE;
+    static_assert(SAMPLE_RATE % BAUD_RATE == 0);
+    static_assert(MARK_SKIP * SAMPLE_RATE == MARK_FREQ * SIN_TABLE_LEN);
+    static_assert(SPACE_SKIP * SAMPLE_RATE == SPACE_FREQ * SIN_TABLE_LEN);
 
     size_t pos_{0};
     int running_{-1};
@@ -80,7 +94,7 @@ struct AFSKModulator : Modulator
     std::array<uint16_t, DAC_BUFFER_LEN> buffer_;
     TimerAdjust<2727, 26400, 12320> dacTimerAdjust{&htim7};    
 
-    AFSKModulator(osMessageQId queue, PTT* ptt)
+    BasicAFSKModulator(osMessageQId queue, PTT* ptt)
     : dacOutputQueueHandle_(queue), ptt_(ptt)
     {
         for (size_t i = 0; i != DAC_BUFFER_LEN; i++)
@@ -88,6 +102,7 @@ struct AFSKModulator : Modulator
     }
 
    void init(const kiss::Hardware& hw);
+   void activate() override;
 
    void deinit() override
    {
@@ -200,7 +215,7 @@ struct AFSKModulator : Modulator
         case 0:
             running_ = -1;
             stop_conversion();
-            ptt_->off();
+            if (!hold_ptt_) ptt_->off();
             pos_ = 0;
 #if defined(KISS_LOGGING) && defined(HAVE_LSCO)
                 HAL_RCCEx_EnableLSCO(RCC_LSCOSOURCE_LSE);
@@ -227,7 +242,7 @@ struct AFSKModulator : Modulator
 
    float bits_per_ms() const override
    {
-       return 1.2f;
+       return BAUD_RATE / 1000.0f;
    }
 
 private:
@@ -258,4 +273,11 @@ private:
 
 };
 
+// init() is defined and the modulators instantiated in AFSKModulator.cpp.
+extern template struct BasicAFSKModulator<1200, 1200, 2200>;
+extern template struct BasicAFSKModulator<300, 1600, 1800>;
+
+using AFSKModulator = BasicAFSKModulator<1200, 1200, 2200>;
+using Afsk300Modulator = BasicAFSKModulator<300, 1600, 1800>;
+
 }} // mobilinkd::tnc
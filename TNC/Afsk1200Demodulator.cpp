@@ -2,6 +2,7 @@
 // All rights reserved.
 
 #include "Afsk1200Demodulator.hpp"
+#include "AgcSupervisor.hpp"
 #include "Goertzel.h"
 #include "AudioInput.hpp"
 #include "GPIO.hpp"
@@ -17,65 +18,45 @@ afsk1200::Demodulator Afsk1200Demodulator::demod1(26400, Afsk1200Demodulator::fi
 afsk1200::Demodulator Afsk1200Demodulator::demod2(26400, Afsk1200Demodulator::filter_2);
 afsk1200::Demodulator Afsk1200Demodulator::demod3(26400, Afsk1200Demodulator::filter_3);
 
+/**
+ * Merge a frame from one of the demodulators into the result.  The same
+ * frame decoded by more than one demodulator is suppressed by comparing
+ * its FCS with the last frame delivered.  An FX.25 frame completes long
+ * after the AX.25 frame inside it, so it is compared over a longer window.
+ */
+hdlc::IoFrame* Afsk1200Demodulator::merge(const afsk1200::Demodulator& demod,
+    hdlc::IoFrame* frame, hdlc::IoFrame* result)
+{
+    if (!frame) return result;
+
+    auto window = demod.fx25_frame() ? FX25_DEDUPE_BLOCKS : 2;
+
+    if (!result and (frame->fcs() != last_fcs or counter > last_counter + window))
+    {
+        last_fcs = frame->fcs();
+        last_counter = counter;
+        return frame;
+    }
+
+    hdlc::release(frame);
+    return result;
+}
+
 hdlc::IoFrame* Afsk1200Demodulator::operator()(const q15_t* samples)
 {
     hdlc::IoFrame* result = nullptr;
 
-    q15_t* filtered = demod_filter.filter(const_cast<q15_t* >(samples));
+    q15_t* filtered = demod_filter.filter_adc(samples);
+    audio::agcSupervisor().measure(filtered, ADC_BLOCK_SIZE);
 
     ++counter;
 
-#if 1
-    auto frame1 = demod1(filtered, ADC_BLOCK_SIZE);
-    if (frame1)
-    {
-        if (frame1->fcs() != last_fcs or counter > last_counter + 2)
-        {
-            last_fcs = frame1->fcs();
-            last_counter = counter;
-            result = frame1;
-        }
-        else
-        {
-            hdlc::release(frame1);
-        }
-    }
-#endif
+    result = merge(demod1, demod1(filtered, ADC_BLOCK_SIZE), result);
+    result = merge(demod2, demod2(filtered, ADC_BLOCK_SIZE), result);
+    result = merge(demod3, demod3(filtered, ADC_BLOCK_SIZE), result);
 
-#if 1
-    auto frame2 = demod2(filtered, ADC_BLOCK_SIZE);
-    if (frame2)
-    {
-        if (frame2->fcs() != last_fcs or counter > last_counter + 2)
-        {
-            last_fcs = frame2->fcs();
-            last_counter = counter;
-            result = frame2;
-        }
-        else
-        {
-            hdlc::release(frame2);
-        }
-    }
-#endif
-
-#if 1
-    auto frame3 = demod3(filtered, ADC_BLOCK_SIZE);
-    if (frame3)
-    {
-        if (frame3->fcs() != last_fcs or counter > last_counter + 2)
-        {
-            last_fcs = frame3->fcs();
-            last_counter = counter;
-            result = frame3;
-        }
-        else
-        {
-            hdlc::release(frame3);
-        }
-    }
-#endif
     locked_ = demod1.locked() or demod2.locked() or demod3.locked();
+    twist_(samples, locked_, result != nullptr);
     return result;
 }
 
@@ -107,13 +88,10 @@ float Afsk1200Demodulator::readTwist()
             if (evt.status != osEventMessage)
                 continue;
 
-            auto block = (audio::adc_pool_type::chunk_type*) evt.value.p;
-            uint16_t* data = (uint16_t*) block->buffer;
+            uint16_t* data = audio::adc_slot(evt.value.v);
             gf1200(data, ADC_BLOCK_SIZE);
             gf2200(data, ADC_BLOCK_SIZE);
 
-            audio::adcPool.deallocate(block);
-
             count += ADC_BLOCK_SIZE;
         }
 
@@ -10,6 +10,7 @@
 #include "KissHardware.hpp"
 #include "HdlcFrame.hpp"
 #include "TimerAdjust.h"
+#include "TwistEstimator.hpp"
 
 namespace mobilinkd { namespace tnc {
 
@@ -43,6 +44,11 @@ struct Afsk1200Demodulator : IDemodulator
 
     using audio_filter_t = Q15FirFilter<ADC_BLOCK_SIZE, FILTER_TAP_NUM>;
 
+    // Blocks over which a duplicate FX.25 frame is suppressed; the longest
+    // codeword at 1200 baud.
+    static constexpr uint32_t FX25_DEDUPE_BLOCKS =
+        fx25::MAX_CODEWORD * 8 * SAMPLE_RATE / (1200 * ADC_BLOCK_SIZE) + 2;
+
     static const q15_t bpf_coeffs[FILTER_TAP_NUM];
 
     static afsk1200::emphasis_filter_type filter_1;
@@ -58,15 +64,15 @@ struct Afsk1200Demodulator : IDemodulator
     uint32_t last_counter{0};
     uint32_t counter{0};
     bool locked_{false};
+    TwistEstimator<ADC_BLOCK_SIZE, SAMPLE_RATE> twist_{1200.0f, 2200.0f};
     TimerAdjust<2727, 26400, 12320> adcTimerAdjust{&htim6};
 
     virtual ~Afsk1200Demodulator() {}
     size_t get_adc_exponent() const override { return 2; }
 
-    void start() override
+    /// Set up the filters and decoders from the settings.
+    void init()
     {
-        SysClock72();
-
         // rx_twist is 6dB for discriminator input and 0db for de-emphasized input.
         auto twist = kiss::settings().rx_twist;
 
@@ -80,6 +86,12 @@ struct Afsk1200Demodulator : IDemodulator
 
         demod_filter.init(bpf_coeffs);
         passall(kiss::settings().options & KISS_OPTION_PASSALL);
+    }
+
+    void start() override
+    {
+        SysClock72();
+        init();
 
         ADC_ChannelConfTypeDef sConfig;
 
@@ -92,7 +104,8 @@ struct Afsk1200Demodulator : IDemodulator
         if (HAL_ADC_ConfigChannel(&DEMODULATOR_ADC_HANDLE, &sConfig) != HAL_OK)
             CxxErrorHandler();
         mobilinkd::adcTimerAdjust = adcTimerAdjust;
-        startADC(2727, ADC_BLOCK_SIZE);
+        startADC(2727, ADC_BLOCK_SIZE, true,
+            audio::adc_oversampling(audio::adc_clock(), audio::SAMPLE_RATE, sConfig.SamplingTime));
     }
 
     void stop() override
@@ -101,8 +114,19 @@ struct Afsk1200Demodulator : IDemodulator
         locked_ = false;
     }
 
+    void reset() override
+    {
+        demod1.reset();
+        demod2.reset();
+        demod3.reset();
+        locked_ = false;
+    }
+
     hdlc::IoFrame* operator()(const q15_t* samples) override;
 
+    hdlc::IoFrame* merge(const afsk1200::Demodulator& demod,
+        hdlc::IoFrame* frame, hdlc::IoFrame* result);
+
     float readTwist() override;
 
     uint32_t readBatteryLevel() override;
@@ -0,0 +1,80 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "Afsk1200M17Demodulator.hpp"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace mobilinkd { namespace tnc {
+
+void Afsk1200M17Demodulator::start()
+{
+    // 72MHz, as used by the AFSK1200 modulator, so that transmitting does
+    // not change the ADC sample rate.
+    SysClock72();
+
+    afsk1200_.init();
+    m17_.init();
+    afsk_count_ = 0;
+
+    ADC_ChannelConfTypeDef sConfig;
+
+    sConfig.Channel = AUDIO_IN;
+    sConfig.Rank = ADC_REGULAR_RANK_1;
+    sConfig.SingleDiff = ADC_SINGLE_ENDED;
+    sConfig.SamplingTime = ADC_SAMPLETIME_24CYCLES_5;
+    sConfig.OffsetNumber = ADC_OFFSET_NONE;
+    sConfig.Offset = 0;
+    if (HAL_ADC_ConfigChannel(&DEMODULATOR_ADC_HANDLE, &sConfig) != HAL_OK)
+        CxxErrorHandler();
+
+    mobilinkd::adcTimerAdjust = adcTimerAdjust;
+    startADC(ADC_TIMER_PERIOD - 1, ADC_BLOCK_SIZE, true,
+        audio::adc_oversampling(audio::adc_clock(), SAMPLE_RATE, sConfig.SamplingTime));
+    m17_.dcd_off();
+}
+
+void Afsk1200M17Demodulator::push(hdlc::IoFrame* frame)
+{
+    if (!frame) return;
+
+    if (pending_count_ == pending_.size())
+    {
+        WARN("Afsk1200M17Demodulator: frame dropped");
+        hdlc::release(frame);
+        return;
+    }
+    pending_[pending_count_++] = frame;
+}
+
+void Afsk1200M17Demodulator::release_pending()
+{
+    for (size_t i = 0; i != pending_count_; ++i) hdlc::release(pending_[i]);
+    pending_count_ = 0;
+}
+
+hdlc::IoFrame* Afsk1200M17Demodulator::operator()(const q15_t* samples)
+{
+    auto frame = m17_(samples);
+    if (frame and frame->source() == 0) frame->source(M17_BASIC_PACKET_PORT);
+    push(frame);
+
+    afsk_count_ += resampler_(samples, afsk_buffer_ + afsk_count_);
+    size_t used = 0;
+    for (; afsk_count_ - used >= AFSK_BLOCK_SIZE; used += AFSK_BLOCK_SIZE)
+    {
+        push(afsk1200_(afsk_buffer_ + used));
+    }
+    std::copy(afsk_buffer_ + used, afsk_buffer_ + afsk_count_, afsk_buffer_);
+    afsk_count_ -= used;
+
+    if (pending_count_ == 0) return nullptr;
+
+    auto result = pending_[0];
+    std::copy(pending_.begin() + 1, pending_.begin() + pending_count_, pending_.begin());
+    --pending_count_;
+    return result;
+}
+
+}} // mobilinkd::tnc
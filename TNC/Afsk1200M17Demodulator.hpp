@@ -0,0 +1,110 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "Demodulator.hpp"
+#include "Afsk1200Demodulator.hpp"
+#include "M17Demodulator.h"
+#include "Decimator.hpp"
+#include "HdlcFrame.hpp"
+#include "TimerAdjust.h"
+
+#include <array>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * Receive AFSK1200 (APRS) and M17 at the same time from one ADC stream.
+ *
+ * The ADC runs at the M17 rate (48ksps, from the 72MHz clock) and each
+ * block goes to the M17 demodulator unchanged.  A polyphase resampler
+ * converts the same block to 26.4ksps for the AFSK1200 demodulator, which
+ * is run once for each full block of its own size (once or twice per M17
+ * block).
+ *
+ * AFSK1200 frames are sent on KISS port 0.  M17 frames keep their KISS
+ * ports (1 for encapsulated packets, 2 for streams, 3 for BERT), except
+ * for basic packets, which M17 sends on port 0; these are moved to
+ * M17_BASIC_PACKET_PORT.
+ *
+ * Both demodulators can complete a frame in the same block.  Only one
+ * frame is returned per block; any others are held and returned with the
+ * following blocks.
+ */
+struct Afsk1200M17Demodulator : IDemodulator
+{
+    static constexpr uint32_t ADC_BLOCK_SIZE = M17Demodulator::ADC_BLOCK_SIZE;
+    static constexpr uint32_t SAMPLE_RATE = M17Demodulator::SAMPLE_RATE;
+    static constexpr uint32_t AFSK_BLOCK_SIZE = Afsk1200Demodulator::ADC_BLOCK_SIZE;
+    static constexpr uint8_t M17_BASIC_PACKET_PORT = 0x40;  ///< KISS port 4.
+    static constexpr uint32_t ADC_TIMER_PERIOD = 72000000 / SAMPLE_RATE;
+
+    // 48000 * 11 / 20 = 26400.  The 6kHz cutoff keeps the droop at 2200Hz
+    // under 0.5dB; the AFSK band filter removes the rest.
+    static_assert(SAMPLE_RATE * 11 / 20 == Afsk1200Demodulator::SAMPLE_RATE);
+    using resampler_t = RationalResampler<ADC_BLOCK_SIZE, 11, 20, 8>;
+    static constexpr float RESAMPLER_CUTOFF = 6000.0f / SAMPLE_RATE;
+
+    Afsk1200Demodulator afsk1200_;
+    M17Demodulator m17_;
+    resampler_t resampler_{RESAMPLER_CUTOFF};
+    q15_t afsk_buffer_[AFSK_BLOCK_SIZE + resampler_t::MAX_OUTPUT_SIZE];
+    size_t afsk_count_{0};
+    std::array<hdlc::IoFrame*, 4> pending_{};
+    size_t pending_count_{0};
+    TimerAdjust<ADC_TIMER_PERIOD, SAMPLE_RATE, 72000000 / 9375> adcTimerAdjust{&htim6};
+
+    virtual ~Afsk1200M17Demodulator() {}
+    size_t get_adc_exponent() const override { return 2; }
+
+    void start() override;
+
+    void stop() override
+    {
+        m17_.stop();
+        afsk1200_.reset();
+        release_pending();
+    }
+
+    void reset() override
+    {
+        m17_.reset();
+        afsk1200_.reset();
+    }
+
+    hdlc::IoFrame* operator()(const q15_t* samples) override;
+
+    float readTwist() override
+    {
+        return afsk1200_.readTwist();
+    }
+
+    uint32_t readBatteryLevel() override
+    {
+        return m17_.readBatteryLevel();
+    }
+
+    bool locked() const override
+    {
+        return afsk1200_.locked() or m17_.locked();
+    }
+
+    size_t size() const override
+    {
+        return ADC_BLOCK_SIZE;
+    }
+
+    void passall(bool enabled) override
+    {
+        afsk1200_.passall(enabled);
+        m17_.passall(enabled);
+    }
+
+private:
+    void push(hdlc::IoFrame* frame);
+    void release_pending();
+};
+
+}} // mobilinkd::tnc
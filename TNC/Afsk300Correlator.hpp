@@ -0,0 +1,75 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+namespace mobilinkd { namespace tnc { namespace afsk300 {
+
+constexpr uint32_t SAMPLE_RATE = 9600;
+constexpr uint32_t SYMBOL_RATE = 300;
+constexpr uint32_t SAMPLES_PER_SYMBOL = SAMPLE_RATE / SYMBOL_RATE;
+static_assert(SAMPLE_RATE % SYMBOL_RATE == 0);
+
+constexpr uint32_t MARK_FREQ = 1600;
+constexpr uint32_t SPACE_FREQ = 1800;
+
+/// Q15 sine table, one cycle.
+constexpr std::array<int16_t, 256> make_sin_table()
+{
+    std::array<int16_t, 256> result{};
+    for (size_t i = 0; i != result.size(); ++i)
+    {
+        result[i] = int16_t(std::lround(
+            std::sin(2.0 * std::numbers::pi * i / result.size()) * 32767.0));
+    }
+    return result;
+}
+
+inline constexpr auto sin_table = make_sin_table();
+
+/**
+ * A non-coherent tone detector.  It correlates the last symbol period of
+ * samples with a quadrature tone and returns the energy.  The phase of
+ * the oldest sample is recomputed from the phase accumulator, so the
+ * running sums cancel exactly and never drift.
+ */
+struct ToneCorrelator
+{
+    uint32_t phase_{0};
+    uint32_t step_{0};
+    uint32_t window_{0};    ///< Phase advance over one symbol period.
+    int32_t i_{0};
+    int32_t q_{0};
+
+    void init(uint32_t frequency)
+    {
+        step_ = uint32_t((uint64_t(frequency) << 32) / SAMPLE_RATE);
+        window_ = step_ * SAMPLES_PER_SYMBOL;
+        phase_ = 0;
+        i_ = 0;
+        q_ = 0;
+    }
+
+    static int32_t sin(uint32_t phase) { return sin_table[phase >> 24]; }
+    static int32_t cos(uint32_t phase) { return sin_table[(phase + 0x40000000) >> 24]; }
+
+    /**
+     * Add @p sample and remove @p oldest, the sample one symbol period
+     * earlier.  Return the tone energy.
+     */
+    float operator()(int32_t sample, int32_t oldest)
+    {
+        uint32_t old_phase = phase_ - window_;
+        i_ += ((sample * cos(phase_)) >> 15) - ((oldest * cos(old_phase)) >> 15);
+        q_ += ((sample * sin(phase_)) >> 15) - ((oldest * sin(old_phase)) >> 15);
+        phase_ += step_;
+        return float(i_) * float(i_) + float(q_) * float(q_);
+    }
+};
+
+}}} // mobilinkd::tnc::afsk300
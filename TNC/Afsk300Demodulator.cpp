@@ -0,0 +1,111 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "Afsk300Demodulator.hpp"
+#include "Goertzel.h"
+#include "AudioInput.hpp"
+#include "AudioLevel.hpp"
+#include "GPIO.hpp"
+#include "Log.h"
+#include "power.h"
+
+#include <algorithm>
+
+namespace mobilinkd { namespace tnc {
+
+hdlc::IoFrame* Afsk300Demodulator::operator()(const q15_t* samples)
+{
+    hdlc::IoFrame* result = nullptr;
+
+    ++counter;
+
+    const int32_t vgnd = audio::virtual_ground;
+
+    for (size_t i = 0; i != ADC_BLOCK_SIZE; ++i)
+    {
+        int32_t sample = samples[i] - vgnd;
+        int32_t oldest = history_[history_index_];
+        history_[history_index_] = sample;
+        if (++history_index_ == history_.size()) history_index_ = 0;
+
+        for (auto& decoder : decoders_)
+        {
+            auto frame = decoder(sample, oldest);
+            if (!frame) continue;
+
+            // The same frame is usually decoded by adjacent decoders.
+            if (!result and (frame->fcs() != last_fcs or counter > last_counter + 2))
+            {
+                last_fcs = frame->fcs();
+                last_counter = counter;
+                result = frame;
+            }
+            else
+            {
+                hdlc::release(frame);
+            }
+        }
+    }
+
+    locked_ = std::any_of(decoders_.begin(), decoders_.end(),
+        [](const afsk300::ToneDecoder& decoder) { return decoder.locked(); });
+    twist_(samples, locked_, result != nullptr);
+
+    return result;
+}
+
+/*
+ * Return twist as a the difference in dB between mark and space.
+ */
+float Afsk300Demodulator::readTwist()
+{
+    TNC_DEBUG("enter Afsk300Demodulator::readTwist");
+
+    float gmark = 0.0f;
+    float gspace = 0.0f;
+
+    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf_mark(afsk300::MARK_FREQ, 0);
+    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf_space(afsk300::SPACE_FREQ, 0);
+
+    const uint32_t AVG_SAMPLES = 20;
+
+    startADC(ADC_TIMER_PERIOD - 1, ADC_BLOCK_SIZE);
+
+    for (uint32_t i = 0; i != AVG_SAMPLES; ++i)
+    {
+        uint32_t count = 0;
+        while (count < ADC_BLOCK_SIZE)
+        {
+            osEvent evt = osMessageGet(adcInputQueueHandle, osWaitForever);
+            if (evt.status != osEventMessage)
+                continue;
+
+            uint16_t* data = audio::adc_slot(evt.value.v);
+            gf_mark(data, ADC_BLOCK_SIZE);
+            gf_space(data, ADC_BLOCK_SIZE);
+
+            count += ADC_BLOCK_SIZE;
+        }
+
+        gmark += (gf_mark / count);
+        gspace += (gf_space / count);
+
+        gf_mark.reset();
+        gf_space.reset();
+    }
+
+    IDemodulator::stopADC();
+
+    gmark = 10.0f * log10f(gmark / AVG_SAMPLES);
+    gspace = 10.0f * log10f(gspace / AVG_SAMPLES);
+
+    auto result = gmark - gspace;
+
+    INFO("300 Twist = %d / 100 (%d - %d)", int(result * 100), int(gmark * 100),
+        int(gspace * 100));
+
+    TNC_DEBUG("exit Afsk300Demodulator::readTwist");
+    return result;
+}
+
+}} // mobilinkd::tnc
@@ -0,0 +1,177 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "Demodulator.hpp"
+#include "Afsk300Correlator.hpp"
+#include "AudioInput.hpp"
+#include "DigitalPLL.hpp"
+#include "HdlcDecoder.hpp"
+#include "KissHardware.hpp"
+#include "NRZI.hpp"
+#include "TimerAdjust.h"
+#include "TwistEstimator.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+namespace afsk300 {
+
+/**
+ * The receive chain for one tone offset: mark and space detectors, the
+ * symbol PLL, NRZI decoder and HDLC decoder.
+ */
+struct ToneDecoder
+{
+    ToneCorrelator mark_;
+    ToneCorrelator space_;
+    BaseDigitalPLL<float> pll_{SAMPLE_RATE, SYMBOL_RATE};
+    libafsk::NRZI nrzi_;
+    hdlc::NewDecoder hdlc_decoder_;
+    bool locked_{false};
+
+    void init(int32_t offset)
+    {
+        mark_.init(MARK_FREQ + offset);
+        space_.init(SPACE_FREQ + offset);
+        locked_ = false;
+    }
+
+    hdlc::IoFrame* operator()(int32_t sample, int32_t oldest)
+    {
+        bool bit = mark_(sample, oldest) > space_(sample, oldest);
+        auto pll = pll_(bit);
+        if (!pll.sample) return nullptr;
+
+        locked_ = pll.locked;
+        return hdlc_decoder_(nrzi_.decode(bit), locked_);
+    }
+
+    bool locked() const { return locked_; }
+
+    /// The correlators stay consistent with the sample history; only the
+    /// symbol timing and frame state are reset.
+    void reset()
+    {
+        pll_.reset();
+        hdlc_decoder_.reset();
+        locked_ = false;
+    }
+};
+
+} // afsk300
+
+/**
+ * 300 baud AFSK demodulator for HF packet (1600/1800Hz tones).
+ *
+ * The ADC runs at 9600 samples per second from the 72MHz clock, the same
+ * clock the AFSK300 modulator uses, so transmit and receive never disagree
+ * about HCLK after a half-duplex turnaround.  Each
+ * tone decoder uses a one-symbol correlator for each tone.  HF signals
+ * are often mistuned, so several decoders run in parallel, offset from
+ * the nominal tones.
+ */
+struct Afsk300Demodulator : IDemodulator
+{
+    static constexpr uint32_t ADC_BLOCK_SIZE = 96;
+    static_assert(audio::ADC_BUFFER_SIZE >= ADC_BLOCK_SIZE);
+
+    static constexpr uint32_t SAMPLE_RATE = afsk300::SAMPLE_RATE;
+    static constexpr uint32_t ADC_TIMER_PERIOD = 72000000 / SAMPLE_RATE;
+    static constexpr uint16_t VREF = 16383;
+
+    // Tone offsets in Hz.  The decoders are 50Hz apart, covering about
+    // +/-125Hz of mistuning.  The one-symbol correlators lose 1.4dB at
+    // 25Hz mistuning and 4.7dB at 50Hz (host/Afsk300Mistuning.cpp), so
+    // wider spacing would leave gaps.
+    static constexpr std::array<int16_t, 5> TONE_OFFSETS = {0, -50, 50, -100, 100};
+
+    std::array<afsk300::ToneDecoder, TONE_OFFSETS.size()> decoders_;
+    std::array<q15_t, afsk300::SAMPLES_PER_SYMBOL> history_;
+    uint8_t history_index_{0};
+    uint16_t last_fcs{0};
+    uint32_t last_counter{0};
+    uint32_t counter{0};
+    bool locked_{false};
+    TwistEstimator<ADC_BLOCK_SIZE, SAMPLE_RATE> twist_{afsk300::MARK_FREQ, afsk300::SPACE_FREQ};
+    TimerAdjust<ADC_TIMER_PERIOD, SAMPLE_RATE, 72000000 / 9375> adcTimerAdjust{&htim6};
+
+    virtual ~Afsk300Demodulator() {}
+    size_t get_adc_exponent() const override { return 2; }
+
+    void start() override
+    {
+        SysClock72();
+
+        for (size_t i = 0; i != decoders_.size(); ++i)
+        {
+            decoders_[i].init(TONE_OFFSETS[i]);
+        }
+        history_.fill(0);
+        history_index_ = 0;
+
+        last_fcs = 0;
+        last_counter = 0;
+        counter = 0;
+
+        passall(kiss::settings().options & KISS_OPTION_PASSALL);
+
+        ADC_ChannelConfTypeDef sConfig;
+
+        sConfig.Channel = AUDIO_IN;
+        sConfig.Rank = ADC_REGULAR_RANK_1;
+        sConfig.SingleDiff = ADC_SINGLE_ENDED;
+        sConfig.SamplingTime = ADC_SAMPLETIME_24CYCLES_5;
+        sConfig.OffsetNumber = ADC_OFFSET_NONE;
+        sConfig.Offset = 0;
+        if (HAL_ADC_ConfigChannel(&DEMODULATOR_ADC_HANDLE, &sConfig) != HAL_OK)
+            CxxErrorHandler();
+        mobilinkd::adcTimerAdjust = adcTimerAdjust;
+        startADC(ADC_TIMER_PERIOD - 1, ADC_BLOCK_SIZE, true,
+            audio::adc_oversampling(audio::adc_clock(), SAMPLE_RATE, sConfig.SamplingTime));
+    }
+
+    void stop() override
+    {
+        stopADC();
+        locked_ = false;
+    }
+
+    void reset() override
+    {
+        for (auto& decoder : decoders_) decoder.reset();
+        locked_ = false;
+    }
+
+    hdlc::IoFrame* operator()(const q15_t* samples) override;
+
+    float readTwist() override;
+
+    uint32_t readBatteryLevel() override
+    {
+        return readBattery();
+    }
+
+    bool locked() const override
+    {
+        return locked_;
+    }
+
+    size_t size() const override
+    {
+        return ADC_BLOCK_SIZE;
+    }
+
+    void passall(bool enabled) override
+    {
+        for (auto& decoder : decoders_)
+        {
+            decoder.hdlc_decoder_.setPassall(enabled);
+        }
+    }
+};
+
+}} // mobilinkd::tnc
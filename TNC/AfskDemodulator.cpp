@@ -34,13 +34,31 @@ hdlc::IoFrame* Demodulator::operator()(q15_t* samples, size_t len)
         if (pll.sample) {
             locked_ = pll.locked;
 
+            bool data = nrzi_.decode(bit);
+            auto frame = hdlc_decoder_(data, true);
+            bool fx25 = false;
+
+            // FX.25 runs on the same bits.  A codeword ends well after
+            // the AX.25 frame inside it; both cannot end on the same bit.
+            auto fx25_frame = fx25_decoder_(data);
+            if (fx25_frame) {
+                if (frame) {
+                    hdlc::release(fx25_frame);
+                } else {
+                    frame = fx25_frame;
+                    fx25 = true;
+                }
+            }
+
             // We will only ever get one frame because there are
             // not enough bits in a block for more than one.
-            if (result) {
-                auto tmp = hdlc_decoder_(nrzi_.decode(bit), true);
-                if (tmp) hdlc::release(tmp);
-            } else {
-                result = hdlc_decoder_(nrzi_.decode(bit), true);
+            if (frame) {
+                if (result) {
+                    hdlc::release(frame);
+                } else {
+                    result = frame;
+                    fx25_frame_ = fx25;
+                }
             }
         }
     }
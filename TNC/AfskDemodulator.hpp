@@ -9,6 +9,7 @@
 #include "HdlcDecoder.hpp"
 #include "Hysteresis.hpp"
 #include "FirFilter.hpp"
+#include "Fx25.hpp"
 #include "NRZI.hpp"
 
 #include "stm32l4xx_hal.h"
@@ -53,7 +54,9 @@ struct Demodulator {
     Q15FirFilter<ADC_BUFFER_SIZE, LPF_FILTER_LEN> lpf_filter_;
     libafsk::NRZI nrzi_;
     hdlc::NewDecoder hdlc_decoder_;
+    fx25::Decoder fx25_decoder_;
     bool locked_;
+    bool fx25_frame_{false};    ///< The last frame returned came from FX.25.
     q15_t buffer_[ADC_BUFFER_SIZE];
 
     Demodulator(size_t sample_rate, emphasis_filter_type& c)
@@ -69,6 +72,18 @@ struct Demodulator {
     hdlc::IoFrame* operator()(q15_t* samples, size_t len);
 
     bool locked() const {return locked_;}
+
+    /// Abandon the frame in progress and restart symbol timing.
+    void reset()
+    {
+        pll_.reset();
+        hdlc_decoder_.reset();
+        fx25_decoder_.reset();
+        locked_ = false;
+    }
+
+    /// True if the last frame returned was decoded from an FX.25 codeword.
+    bool fx25_frame() const {return fx25_frame_;}
 };
 
 
@@ -0,0 +1,173 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "AgcSupervisor.hpp"
+#include "AudioLevel.hpp"
+#include "KissHardware.hpp"
+#include "Log.h"
+
+#include "cmsis_os.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mobilinkd { namespace tnc { namespace audio {
+
+void AgcSupervisor::measure(const q15_t* filtered, size_t size)
+{
+    auto input = const_cast<q15_t*>(filtered);
+    q15_t vmin, vmax;
+    uint32_t index;
+    q63_t power;
+
+    arm_min_q15(input, size, &vmin, &index);
+    arm_max_q15(input, size, &vmax, &index);
+    arm_power_q15(input, size, &power);     // Sum of the squared samples.
+
+    int32_t peak = std::max<int32_t>(vmax, -int32_t(vmin));
+    peak_ = std::max<int32_t>(peak_, std::min<int32_t>(peak, 32767));
+    sum_squares_ += power;
+    count_ += size;
+}
+
+void AgcSupervisor::measure(const float* filtered, size_t size)
+{
+    float peak = 0.0f;
+    float power = 0.0f;
+    for (size_t i = 0; i != size; ++i)
+    {
+        peak = std::max(peak, std::fabs(filtered[i]));
+        power += filtered[i] * filtered[i];
+    }
+
+    peak_ = std::max<int32_t>(peak_, std::min(peak * 32768.0f, 32767.0f));
+    sum_squares_ += uint64_t(power * float(1 << 30));
+    count_ += size;
+}
+
+void AgcSupervisor::clear()
+{
+    peak_ = 0;
+    sum_squares_ = 0;
+    count_ = 0;
+    clipped_ = false;
+}
+
+void AgcSupervisor::vote(int direction)
+{
+    if (votes_ * direction < 0) votes_ = 0;
+    votes_ += direction;
+    if (std::abs(votes_) < VOTES) return;
+    votes_ = 0;
+
+    int current = kiss::settings().input_gain;
+    int gain = std::clamp(current + direction, MIN_GAIN, MAX_GAIN);
+    if (gain != current) gain_ = gain;
+}
+
+/**
+ * Vote on the levels of the frame just received, or of the locked period
+ * that ended without one.  Only a decoded frame can vote to raise the
+ * gain; a locked period without one may just be noise.  Demodulators which
+ * do not report their filter output (count_ == 0) can only vote to lower
+ * the gain, when the ADC clips.
+ *
+ * @param frame is true if a frame was decoded.
+ */
+void AgcSupervisor::evaluate(bool frame)
+{
+    TNC_DEBUG("AGC frame peak = %d, rms = %d, clipped = %d", int(peak_),
+        count_ ? int(sqrtf(float(sum_squares_) / count_)) : 0, int(clipped_));
+
+    if (clipped_ or peak_ >= CLIP_LEVEL)
+    {
+        vote(-1);
+    }
+    else if (!frame)
+    {
+        return;     // No evidence either way; keep the votes from frames.
+    }
+    else if (count_ != 0 and peak_ < PEAK_HEADROOM
+        and sum_squares_ < uint64_t(RMS_LOW * RMS_LOW) * count_)
+    {
+        vote(1);
+    }
+    else
+    {
+        votes_ = 0;
+    }
+}
+
+void AgcSupervisor::apply()
+{
+    auto& hardware = kiss::settings();
+
+    INFO("AGC input gain %d -> %d", int(hardware.input_gain), gain_);
+    set_input_gain(gain_);
+    hardware.input_gain = gain_;
+    hardware.update_crc();
+    gain_ = -1;
+
+    announce_ = true;
+    store_time_ = (osKernelSysTick() + STORE_DELAY) | 1;  // 0 is "none".
+}
+
+void AgcSupervisor::update(bool locked, bool frame)
+{
+    if (!(kiss::settings().options & KISS_OPTION_AGC))
+    {
+        clear();
+        votes_ = 0;
+        gain_ = -1;
+        was_locked_ = false;
+        frame_seen_ = false;
+        return;
+    }
+
+    if (level_tracker.vmin_ < ADC_CLIP_MARGIN
+        or level_tracker.vmax_ > ADC_FULL_SCALE - ADC_CLIP_MARGIN)
+    {
+        clipped_ = true;
+    }
+
+    if (frame)
+    {
+        evaluate(true);
+        frame_seen_ = true;
+    }
+    else if (was_locked_ and !locked and !frame_seen_)
+    {
+        // DCD dropped without a good frame.  Clipping is a common cause
+        // of CRC failures, so these levels can vote to lower the gain.
+        evaluate(false);
+    }
+
+    if (!locked) frame_seen_ = false;
+    was_locked_ = locked;
+
+    if (frame or !locked) clear();
+    if (!locked and gain_ >= 0) apply();
+}
+
+void AgcSupervisor::poll()
+{
+    if (announce_.exchange(false)) kiss::settings().announce_input_settings();
+
+    uint32_t due = store_time_;
+    if (due == 0 or int32_t(osKernelSysTick() - due) < 0) return;
+
+    // A later gain change pushes the write back.
+    if (store_time_.compare_exchange_strong(due, 0))
+    {
+        kiss::settings().update_crc();
+        kiss::settings().store();
+    }
+}
+
+AgcSupervisor& agcSupervisor()
+{
+    static AgcSupervisor instance;
+    return instance;
+}
+
+}}} // mobilinkd::tnc::audio
@@ -0,0 +1,85 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "arm_math.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc { namespace audio {
+
+/**
+ * Background input gain control.
+ *
+ * The demodulators report their first filter stage output with measure()
+ * and the demodulator task calls update() after each block.  The peak
+ * and RMS levels are accumulated over each received frame, along with
+ * whether the raw ADC samples reached either rail.  When DCD drops
+ * without a frame having been decoded, the levels from that locked period
+ * are checked for clipping, so clipping that corrupts every frame still
+ * lowers the gain; only decoded frames can raise it.  A frame that clipped
+ * votes to lower the gain by one step (6dB); a frame with a low RMS level
+ * and enough peak headroom for another 6dB votes to raise it.  VOTES
+ * consecutive frames must agree, and the gap between the two thresholds
+ * is wider than one step, so the gain does not hunt.
+ *
+ * Gain changes are only made while the demodulator is not locked, never
+ * in the middle of a frame.  The new setting is announced to the host and
+ * written to EEPROM from the IO event loop (poll()), once the gain has
+ * been stable for STORE_DELAY.
+ *
+ * Enabled by KISS_OPTION_AGC, which is off by default.
+ */
+struct AgcSupervisor
+{
+    static constexpr q15_t CLIP_LEVEL = 29205;      ///< -1dBFS filtered peak.
+    static constexpr q15_t PEAK_HEADROOM = 11627;   ///< -9dBFS; peak must be below to raise gain.
+    static constexpr q15_t RMS_LOW = 2068;          ///< -24dBFS.
+    static constexpr uint16_t ADC_FULL_SCALE = 16383;   ///< 14-bit samples.
+    static constexpr uint16_t ADC_CLIP_MARGIN = 64;
+    static constexpr int VOTES = 3;
+    static constexpr uint32_t STORE_DELAY = 60000;  ///< ms.
+    static constexpr int MIN_GAIN = 0;
+    static constexpr int MAX_GAIN = 4;
+
+    q15_t peak_{0};
+    uint64_t sum_squares_{0};
+    uint32_t count_{0};
+    bool clipped_{false};
+    bool was_locked_{false};        ///< DCD state from the previous block.
+    bool frame_seen_{false};        ///< A frame was decoded while locked.
+    int votes_{0};                  ///< > 0 to raise, < 0 to lower the gain.
+    int gain_{-1};                  ///< Gain to set between frames; -1 if none.
+
+    std::atomic<bool> announce_{false};
+    std::atomic<uint32_t> store_time_{0};   ///< osKernelSysTick() when due; 0 if none.
+
+    /// Accumulate the filtered samples for the current frame.
+    void measure(const q15_t* filtered, size_t size);
+    /// Float filter output, with 1.0 as full scale.
+    void measure(const float* filtered, size_t size);
+
+    /**
+     * Called by the demodulator task after each block is demodulated.
+     *
+     * @param locked is the demodulator lock (DCD) state.
+     * @param frame is true if a frame was returned for this block.
+     */
+    void update(bool locked, bool frame);
+
+    /// Called from the IO event loop to announce and store gain changes.
+    void poll();
+
+private:
+    void evaluate(bool frame);
+    void vote(int direction);
+    void apply();
+    void clear();
+};
+
+AgcSupervisor& agcSupervisor();
+
+}}} // mobilinkd::tnc::audio
@@ -3,8 +3,11 @@
 
 #include "AudioInput.hpp"
 #include "Afsk1200Demodulator.hpp"
+#include "Afsk300Demodulator.hpp"
 #include "Fsk9600Demodulator.hpp"
 #include "M17Demodulator.h"
+#include "Afsk1200M17Demodulator.hpp"
+#include "AgcSupervisor.hpp"
 #include "AudioLevel.hpp"
 #include "Log.h"
 #include "KissHardware.hpp"
@@ -15,6 +18,7 @@
 #include "DCD.h"
 #include "ModulatorTask.hpp"
 #include "TimerAdjust.h"
+#include "TwistEstimator.hpp"
 
 #include "arm_math.h"
 #include "stm32l4xx_hal.h"
@@ -36,26 +40,39 @@ void ADC_TIMER_PeriodElapsedCallback(void)
     if (mobilinkd::adcTimerAdjust) mobilinkd::adcTimerAdjust();
 }
 
-// DMA Conversion first half complete.
-extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef*) {
+namespace {
+
+/*
+ * Post the numbers of the blocks in one half of the DMA ring.  If an
+ * interrupt was missed, the numbers skip ahead to keep block % ADC_SLOTS
+ * equal to the slot, and the demodulator sees the gap.
+ */
+void post_adc_blocks(uint32_t half) {
     using namespace mobilinkd::tnc::audio;
 
-    auto block = adcPool.allocate();
-    if (!block) return;
-    memmove(block->buffer, adc_buffer, dma_transfer_size);
-    auto status = osMessagePut(adcInputQueueHandle, (uint32_t) block, 0);
-    if (status != osOK) adcPool.deallocate(block);
+    adc_timestamp[half] = DWT->CYCCNT;
+
+    uint32_t block = adc_sequence;
+    if ((block / (ADC_SLOTS / 2)) % 2 != half) block += ADC_SLOTS / 2;
+
+    for (uint32_t i = 0; i != ADC_SLOTS / 2; ++i, ++block) {
+        if (osMessagePut(adcInputQueueHandle, block, 0) != osOK) {
+            adc_stats.dropped += 1;
+        }
+    }
+    adc_sequence = block;
+}
+
+} // namespace
+
+// DMA Conversion first half complete.
+extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef*) {
+    post_adc_blocks(0);
 }
 
 // DMA Conversion second half complete.
 extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef*) {
-    using namespace mobilinkd::tnc::audio;
-
-    auto block = adcPool.allocate();
-    if (!block) return;
-    memmove(block->buffer, adc_buffer + half_buffer_size, dma_transfer_size);
-    auto status = osMessagePut(adcInputQueueHandle, (uint32_t) block, 0);
-    if (status != osOK) adcPool.deallocate(block);
+    post_adc_blocks(1);
 }
 
 extern "C" void HAL_ADC_ErrorCallback(ADC_HandleTypeDef* /* hadc */) {
@@ -70,7 +87,10 @@ extern "C" void startAudioInputTask(void const*) {
     using namespace mobilinkd::tnc::audio;
     TNC_DEBUG("startAudioInputTask");
 
-    adcPool.init();
+    // The cycle counter timestamps ADC blocks for the latency statistics.
+    // It is not reset; it is also the FreeRTOS run-time stats clock.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
     uint8_t adcState = mobilinkd::tnc::audio::IDLE;
 
@@ -108,11 +128,15 @@ extern "C" void startAudioInputTask(void const*) {
             break;
         case STREAM_AVERAGE_TWIST_LEVEL:
             TNC_DEBUG("STREAM_AVERAGE_TWIST_LEVEL");
-            // streamAverageInputTwist();
+            streamAverageInputTwist();
             break;
         case STREAM_INSTANT_TWIST_LEVEL:
             TNC_DEBUG("STREAM_INSTANT_TWIST_LEVEL");
-            // streamInstantInputTwist();
+            streamInstantInputTwist();
+            break;
+        case POLL_EQUALIZER:
+            TNC_DEBUG("POLL_EQUALIZER");
+            pollEqualizer();
             break;
         case AUTO_ADJUST_INPUT_LEVEL:
             TNC_DEBUG("AUTO_ADJUST_INPUT_LEVEL");
@@ -141,27 +165,94 @@ std::function<void(void)> adcTimerAdjust;
 
 namespace tnc { namespace audio {
 
-uint32_t adc_buffer[ADC_BUFFER_SIZE];               // Two samples per element.
-volatile uint32_t adc_block_size = ADC_BUFFER_SIZE;          // Based on demodulator.
-volatile uint32_t dma_transfer_size = adc_block_size * 2;    // Transfer size in bytes.
-volatile uint32_t half_buffer_size = adc_block_size / 2;     // Transfer size in words / 2.
-adc_pool_type adcPool;
+uint32_t adc_buffer[ADC_BUFFER_SIZE * ADC_SLOTS / 2];       // Two samples per element.
+volatile uint32_t adc_block_size = ADC_BUFFER_SIZE;            // Based on demodulator.
+volatile uint32_t dma_transfer_size = adc_block_size * ADC_SLOTS; // Transfer size in samples.
+volatile uint32_t adc_sequence = 0;
+volatile uint32_t adc_timestamp[2];
+AdcStats adc_stats;
 
+/**
+ * Set the block size for the next DMA transfer.  The DMA restarts at the
+ * first slot, so the block numbers skip ahead to the next multiple of
+ * ADC_SLOTS.
+ */
 void set_adc_block_size(uint32_t block_size)
 {
     adc_block_size = block_size;
-    dma_transfer_size = block_size * 2;
-    half_buffer_size = block_size / 2;
+    dma_transfer_size = block_size * ADC_SLOTS;
+    adc_sequence = (adc_sequence + ADC_SLOTS - 1) & ~(ADC_SLOTS - 1);
+}
+
+uint32_t adc_clock()
+{
+    return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC);
+}
+
+namespace {
+
+/**
+ * Track the queue depth, and check whether the DMA overwrote the block
+ * while it was being demodulated.
+ *
+ * @return false on an overrun.
+ */
+bool update_adc_stats(uint32_t block, uint32_t waiting)
+{
+    if (waiting > adc_stats.queue_high_water) {
+        adc_stats.queue_high_water = std::min<uint32_t>(waiting, 255);
+    }
+
+    uint32_t timestamp = adc_timestamp[(block / (ADC_SLOTS / 2)) % 2];
+    uint32_t now = DWT->CYCCNT;
+
+    // The DMA is filling the half of the ring after the last block posted.
+    // If that half holds this block's slot, it may have been overwritten.
+    if (adc_sequence - block > ADC_SLOTS / 2) {
+        adc_stats.overruns += 1;
+        return false;
+    }
+
+    uint32_t latency = (now - timestamp) / (SystemCoreClock / 1000000);
+    if (latency > adc_stats.max_latency) adc_stats.max_latency = latency;
+    return true;
+}
+
+/// STREAM_AVERAGE_TWIST_LEVEL or STREAM_INSTANT_TWIST_LEVEL while streaming.
+AdcState twist_stream = STOPPED;
+
+/**
+ * Send mark and space levels (dB * 256) as a POLL_INPUT_TWIST reply.
+ */
+void reply_twist(int16_t mark, int16_t space)
+{
+    uint8_t buffer[5];
+    buffer[0] = kiss::hardware::POLL_INPUT_TWIST;
+    buffer[1] = (mark >> 8) & 0xFF;
+    buffer[2] = mark & 0xFF;
+    buffer[3] = (space >> 8) & 0xFF;
+    buffer[4] = space & 0xFF;
+
+    ioport->write(buffer, 5, 6, 10);
+}
+
+void reply_twist(uint32_t levels)
+{
+    reply_twist(TwistMonitor::mark(levels), TwistMonitor::space(levels));
 }
 
-q15_t normalized[ADC_BUFFER_SIZE];
+} // namespace
 
 IDemodulator* getDemodulator()
 {
     constexpr auto mem_size = std::max({
         sizeof(Afsk1200Demodulator),
+        sizeof(Afsk300Demodulator),
+        sizeof(Fsk4800Demodulator),
         sizeof(Fsk9600Demodulator),
+        sizeof(Fsk19200Demodulator),
         sizeof(M17Demodulator),
+        sizeof(Afsk1200M17Demodulator),
     });
 
     using storage_t = std::aligned_storage<mem_size, 4>::type;
@@ -182,17 +273,30 @@ IDemodulator* getDemodulator()
         case kiss::Hardware::ModemType::AFSK1200:
             demod = new (&mem) Afsk1200Demodulator();
             break;
+        case kiss::Hardware::ModemType::AFSK300:
+            demod = new (&mem) Afsk300Demodulator();
+            break;
+        case kiss::Hardware::ModemType::FSK4800:
+            demod = new (&mem) Fsk4800Demodulator();
+            break;
         case kiss::Hardware::ModemType::FSK9600:
             demod = new (&mem) Fsk9600Demodulator();
             break;
+        case kiss::Hardware::ModemType::FSK19200:
+            demod = new (&mem) Fsk19200Demodulator();
+            break;
         case kiss::Hardware::ModemType::M17:
             demod = new (&mem) M17Demodulator();
             break;
+        case kiss::Hardware::ModemType::AFSK1200_M17:
+            demod = new (&mem) Afsk1200M17Demodulator();
+            break;
         default:
             ERROR("Invalid demodulator");
             CxxErrorHandler();
         }
         modem_type = kiss::settings().modem_type;
+        twistMonitor().reset();
     }
 
     return demod;
@@ -206,6 +310,10 @@ void demodulatorTask() {
     auto demodulator = getDemodulator();
 
     demodulator->start();
+    uint32_t twist_frames = twistMonitor().frames;
+
+    // Anything before this is left over from the last DMA transfer.
+    uint32_t expected = adc_sequence & ~(ADC_SLOTS - 1);
 
     while (true) {
         osEvent peek = osMessagePeek(audioInputQueueHandle, 0);
@@ -216,13 +324,24 @@ void demodulatorTask() {
             continue;
         }
 
-        auto block = (adc_pool_type::chunk_type*) evt.value.p;
-        auto samples = (int16_t*) block->buffer;
+        uint32_t block = evt.value.v;
+        if (int32_t(block - expected) < 0) continue;
+        if (block != expected) {
+            // Blocks were lost.  Do not decode a frame across the gap.
+            adc_stats.gaps += 1;
+            demodulator->reset();
+        }
+        expected = block + 1;
+
+        uint32_t waiting = osMessageWaiting(adcInputQueueHandle) + 1;
 
-        arm_offset_q15(samples, 0 - virtual_ground, normalized, demodulator->size());
-        adcPool.deallocate(block);
+        // The demodulator removes the virtual ground offset itself.
+        level_tracker(adc_slot(block), demodulator->size());
+        auto samples = reinterpret_cast<const q15_t*>(adc_slot(block));
+        auto frame = (*demodulator)(samples);
 
-        auto frame = (*demodulator)(normalized);
+        if (!update_adc_stats(block, waiting)) demodulator->reset();
+        agcSupervisor().update(demodulator->locked(), frame != nullptr);
         if (frame)
         {
             frame->source(frame->source() | hdlc::IoFrame::RF_DATA);
@@ -232,6 +351,13 @@ void demodulatorTask() {
             }
         }
 
+        if (twist_stream != STOPPED and twistMonitor().frames != twist_frames)
+        {
+            twist_frames = twistMonitor().frames;
+            reply_twist(twist_stream == STREAM_AVERAGE_TWIST_LEVEL ?
+                twistMonitor().average : twistMonitor().instant);
+        }
+
         if (demodulator->locked() xor dcd_status) {
             dcd_status = demodulator->locked();
             if (dcd_status) {
@@ -266,8 +392,6 @@ void streamLevels(uint8_t cmd) {
         osEvent peek = osMessagePeek(audioInputQueueHandle, 0);
         if (peek.status == osEventMessage) break;
 
-        uint32_t count = 0;
-        uint32_t accum = 0;
         uint16_t vmin = std::numeric_limits<uint16_t>::max();
         uint16_t vmax = std::numeric_limits<uint16_t>::min();
 
@@ -275,21 +399,13 @@ void streamLevels(uint8_t cmd) {
             osEvent evt = osMessageGet(adcInputQueueHandle, 1000);
             if (evt.status != osEventMessage) break;
 
-            count += demodulator->size();
-
-            auto block = (adc_pool_type::chunk_type*) evt.value.p;
-            auto start =  (uint16_t*) block->buffer;
-            auto end = start + demodulator->size();
-
-            vmin = std::min(vmin, *std::min_element(start, end));
-            vmax = std::max(vmax, *std::max_element(start, end));
-            accum = std::accumulate(start, end, accum);
-
-            adcPool.deallocate(block);
+            level_tracker(adc_slot(evt.value.v), demodulator->size());
+            vmin = std::min(vmin, level_tracker.vmin_);
+            vmax = std::max(vmax, level_tracker.vmax_);
         }
 
         uint16_t pp = (vmax - vmin) << audio_exponent;
-        uint16_t avg = (accum / count) << audio_exponent;
+        uint16_t avg = virtual_ground << audio_exponent;
         vmin <<= audio_exponent;
         vmax <<= audio_exponent;
 
@@ -316,10 +432,12 @@ levels_type readLevels(uint32_t)
     TNC_DEBUG("enter readLevels");
 
     // Return Vpp, Vavg, Vmin, Vmax as four 16-bit values, right justified.
+    // Vpp is the largest peak-to-peak level within a block, so that a DC
+    // level which is still settling does not add to it.  Vavg is the
+    // tracked DC level.
 
     uint32_t BLOCKS = 30;
-    uint32_t accum = 0;
-    uint32_t iaccum = 0;
+    uint16_t pp = 0;
     uint16_t vmin = std::numeric_limits<uint16_t>::max();
     uint16_t vmax = std::numeric_limits<uint16_t>::min();
 
@@ -332,19 +450,10 @@ levels_type readLevels(uint32_t)
         osEvent evt = osMessageGet(adcInputQueueHandle, osWaitForever);
         if (evt.status != osEventMessage) continue;
 
-        auto block = (adc_pool_type::chunk_type*) evt.value.p;
-        auto start =  (uint16_t*) block->buffer;
-        auto end = start + demodulator->size();
-
-        vmin = std::min(vmin, *std::min_element(start, end));
-        vmax = std::max(vmax, *std::max_element(start, end));
-        accum = std::accumulate(start, end, accum);
-
-        iaccum += (accum / demodulator->size());
-
-        adcPool.deallocate(block);
-
-        accum = 0;
+        level_tracker(adc_slot(evt.value.v), demodulator->size());
+        pp = std::max(pp, level_tracker.vpp());
+        vmin = std::min(vmin, level_tracker.vmin_);
+        vmax = std::max(vmax, level_tracker.vmax_);
     }
 
     demodulator->stop();
@@ -353,8 +462,7 @@ levels_type readLevels(uint32_t)
         CxxErrorHandler2(HAL_TIMEOUT);
     }
 
-    uint16_t pp = vmax - vmin;
-    uint16_t avg = iaccum / BLOCKS;
+    uint16_t avg = virtual_ground;
     INFO("exit readLevels");
 
     return levels_type(pp, avg, vmin, vmax);
@@ -419,14 +527,11 @@ void pollInputTwist()
           osEvent evt = osMessageGet(adcInputQueueHandle, osWaitForever);
           if (evt.status != osEventMessage) continue;
 
-          count += ADC_BUFFER_SIZE;
-
-          auto block = (adc_pool_type::chunk_type*) evt.value.p;
-          uint16_t* data =  (uint16_t*) block->buffer;
-          gf1200(data, ADC_BUFFER_SIZE);
-          gf2200(data, ADC_BUFFER_SIZE);
+          count += TWIST_SAMPLE_SIZE;
 
-          adcPool.deallocate(block);
+          uint16_t* data = adc_slot(evt.value.v);
+          gf1200(data, TWIST_SAMPLE_SIZE);
+          gf2200(data, TWIST_SAMPLE_SIZE);
       }
 
       g1200 += 10.0 * log10(gf1200);
@@ -441,19 +546,52 @@ void pollInputTwist()
     TNC_DEBUG("pollInputTwist: MARK=%d, SPACE=%d (x100)",
       int(g1200 * 100.0 / AVG_SAMPLES), int(g2200 * 100.0 / AVG_SAMPLES));
 
-    int16_t g1200i = int16_t(g1200 * 256 / AVG_SAMPLES);
-    int16_t g2200i = int16_t(g2200 * 256 / AVG_SAMPLES);
+    reply_twist(int16_t(g1200 * 256 / AVG_SAMPLES), int16_t(g2200 * 256 / AVG_SAMPLES));
 
-    uint8_t buffer[5];
-    buffer[0] = kiss::hardware::POLL_INPUT_TWIST;
-    buffer[1] = (g1200i >> 8) & 0xFF;
-    buffer[2] = g1200i & 0xFF;
-    buffer[3] = (g2200i >> 8) & 0xFF;
-    buffer[4] = g2200i & 0xFF;
+    TNC_DEBUG("exit pollInputTwist");
+}
 
-    ioport->write(buffer, 5, 6, 10);
+/*
+ * Reply to POLL_INPUT_TWIST with the twist measured by the running
+ * demodulator over the frames received so far, without interrupting it.
+ *
+ * @return false if no frames have been received since the modem was
+ *  started; the caller must then fall back to pollInputTwist().
+ */
+bool pollTwistEstimate()
+{
+    if (twistMonitor().frames == 0) return false;
 
-    TNC_DEBUG("exit pollInputTwist");
+    auto levels = twistMonitor().average.load();
+    TNC_DEBUG("pollTwistEstimate: MARK=%d, SPACE=%d (x256)",
+        TwistMonitor::mark(levels), TwistMonitor::space(levels));
+    reply_twist(levels);
+    return true;
+}
+
+/*
+ * Run the demodulator, sending the mark and space levels of each frame
+ * received (instant) or of all frames received (average) as they arrive.
+ */
+void streamInputTwist(AdcState state)
+{
+    twist_stream = state;
+    demodulatorTask();
+    twist_stream = STOPPED;
+}
+
+void streamAverageInputTwist()
+{
+    TNC_DEBUG("enter streamAverageInputTwist");
+    streamInputTwist(STREAM_AVERAGE_TWIST_LEVEL);
+    TNC_DEBUG("exit streamAverageInputTwist");
+}
+
+void streamInstantInputTwist()
+{
+    TNC_DEBUG("enter streamInstantInputTwist");
+    streamInputTwist(STREAM_INSTANT_TWIST_LEVEL);
+    TNC_DEBUG("exit streamInstantInputTwist");
 }
 
 void streamAmplifiedInputLevels() {
@@ -504,4 +642,26 @@ void pollBatteryLevel()
 }
 #endif
 
+/**
+ * Report the adaptive equalizer taps as big-endian Q14 values.  The reply
+ * is empty if the current demodulator has no equalizer.
+ */
+void pollEqualizer()
+{
+    constexpr size_t MAX_TAPS = 16;
+
+    int16_t taps[MAX_TAPS];
+    auto n = getDemodulator()->readEqualizer(taps, MAX_TAPS);
+
+    uint8_t data[1 + MAX_TAPS * 2];
+    data[0] = kiss::hardware::GET_EQUALIZER;
+    for (size_t i = 0; i != n; ++i)
+    {
+        data[1 + i * 2] = (taps[i] >> 8) & 0xFF;
+        data[2 + i * 2] = (taps[i] & 0xFF);
+    }
+
+    ioport->write(data, 1 + n * 2, 6, 10);
+}
+
 }}} // mobilinkd::tnc::audio
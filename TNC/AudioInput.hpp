@@ -3,8 +3,6 @@
 
 #pragma once
 
-#include "memory.hpp"
-
 #include "main.h"
 #include "stm32l4xx_hal.h"
 #include "cmsis_os.h"
@@ -86,21 +84,82 @@ enum AdcState {
     IDLE,                           // No DMA; sleep for 10ms
     POLL_TWIST_LEVEL,
     STREAM_AVERAGE_TWIST_LEVEL,
-    STREAM_INSTANT_TWIST_LEVEL
+    STREAM_INSTANT_TWIST_LEVEL,
+    POLL_EQUALIZER                  // Adaptive equalizer taps
 };
 
-const size_t ADC_BUFFER_SIZE = 384;
+const size_t ADC_BUFFER_SIZE = 384;   // Maximum samples per block.
+const size_t ADC_SLOTS = 8;           // Blocks in the DMA ring.
+static_assert((ADC_SLOTS & (ADC_SLOTS - 1)) == 0, "ADC_SLOTS must be a power of 2");
 extern uint32_t adc_buffer[];       // Two int16_t samples per element.
 extern volatile uint32_t adc_block_size;
 extern volatile uint32_t dma_transfer_size;
-extern volatile uint32_t half_buffer_size;
-
-// 3kB
-typedef memory::Pool<8, ADC_BUFFER_SIZE * 2> adc_pool_type;
-extern adc_pool_type adcPool;
+extern volatile uint32_t adc_sequence;          // Number of the next block.
+extern volatile uint32_t adc_timestamp[2];      // DWT cycle count when each half completed.
 
 void set_adc_block_size(uint32_t block_size);
 
+const uint32_t ADC_DEFAULT_OVERSAMPLING = 4; // 16x, as set up by MX_ADC1_Init().
+
+/**
+ * The ADC kernel clock.  HAL_ADC_MspInit() selects SYSCLK and MX_ADC1_Init()
+ * uses ADC_CLOCK_ASYNC_DIV1, so this follows SysClock48()/SysClock72().
+ * Call it after the demodulator has set the system clock.
+ */
+uint32_t adc_clock();
+
+/**
+ * Select the hardware oversampling ratio 2^n for a capture mode.  The ADC
+ * sums 2^n conversions for each TIM6 trigger and shifts the sum right by
+ * n - 2, so the samples stay 14 bits (get_adc_exponent() == 2) for any
+ * ratio from 4x to 256x.  Each doubling lowers the ADC noise floor by
+ * about 3dB without any CPU involvement.
+ *
+ * @param clock is the ADC clock, from adc_clock().
+ * @param sample_rate is the TIM6 trigger rate.
+ * @param sampling_time is the ADC_SAMPLETIME_* setting for the channel.
+ * @return the largest n for which the burst of conversions fits in 7/8
+ *  of the sample period, leaving room for TimerAdjust.
+ */
+constexpr uint32_t adc_oversampling(uint32_t clock, uint32_t sample_rate, uint32_t sampling_time)
+{
+    // Sampling time plus 12.5 clocks for a 12-bit conversion, rounded up.
+    constexpr uint32_t conversion_cycles[] = {15, 19, 25, 37, 60, 105, 260, 653};
+
+    uint32_t n = 8;
+    while (n > 2 and uint64_t(conversion_cycles[sampling_time & 7] << n) * sample_rate * 8 > uint64_t(clock) * 7) --n;
+    return n;
+}
+
+/**
+ * The ADC DMA runs continuously over a ring of ADC_SLOTS blocks of
+ * adc_block_size samples.  Blocks are numbered in the order they are
+ * filled.  The half and full transfer complete callbacks post the numbers
+ * of the ADC_SLOTS / 2 blocks just filled to the adcInputQueue; nothing
+ * is copied.  Readers use the samples in place and must be done with a
+ * block before the DMA comes back around to its slot, at least
+ * ADC_SLOTS / 2 block times after it was posted.
+ */
+inline uint16_t* adc_slot(uint32_t block)
+{
+    return reinterpret_cast<uint16_t*>(adc_buffer) + (block % ADC_SLOTS) * adc_block_size;
+}
+
+/**
+ * ADC and demodulator accounting, reported by GET_ADC_STATS.  These
+ * distinguish samples lost in the TNC from packets lost over the air.
+ */
+struct AdcStats
+{
+    uint32_t dropped;           ///< Blocks not posted because the queue was full.
+    uint32_t overruns;          ///< Blocks overwritten before demodulation finished.
+    uint32_t gaps;              ///< Demodulator resets due to lost blocks.
+    uint32_t max_latency;       ///< Worst time from DMA complete to demodulated (us).
+    uint8_t queue_high_water;   ///< Most blocks waiting in the adcInputQueue.
+};
+
+extern AdcStats adc_stats;
+
 /// Vpp, Vavg, Vmin, Vmax
 typedef std::tuple<uint16_t, uint16_t, uint16_t, uint16_t> levels_type;
 levels_type readLevels(uint32_t channel);
@@ -114,8 +173,10 @@ void pollBatteryLevel();
 void streamOutputLevels();
 void stop();
 void pollInputTwist();
+bool pollTwistEstimate();
 void streamAverageInputTwist();
 void streamInstantInputTwist();
+void pollEqualizer();
 
 }}} // mobilinkd::tnc::audio
 
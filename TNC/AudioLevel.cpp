@@ -29,6 +29,31 @@ namespace mobilinkd { namespace tnc { namespace audio {
 
 int16_t virtual_ground{0};
 float i_vgnd{0.0f};
+LevelTracker level_tracker;
+
+void LevelTracker::operator()(const uint16_t* samples, size_t size)
+{
+    auto input = reinterpret_cast<q15_t*>(const_cast<uint16_t*>(samples));
+    q15_t mean, vmin, vmax;
+    uint32_t index;
+
+    arm_mean_q15(input, size, &mean);
+    arm_min_q15(input, size, &vmin, &index);
+    arm_max_q15(input, size, &vmax, &index);
+    vmin_ = vmin;
+    vmax_ = vmax;
+
+    int32_t sample = int32_t(mean) << 8;
+    if (primed_) {
+        dc_ += (sample - dc_) >> DC_SHIFT;
+    } else {
+        dc_ = sample;
+        primed_ = true;
+    }
+
+    virtual_ground = (dc_ + 128) >> 8;
+    i_vgnd = 1.0f / virtual_ground;
+}
 
 void set_input_gain(int level)
 {
@@ -82,6 +107,9 @@ void set_input_gain(int level)
         CxxErrorHandler();
     if (HAL_OPAMP_Start(&hopamp1)!= HAL_OK)
         CxxErrorHandler();
+
+    // The DC level moves with the gain; start tracking it afresh.
+    level_tracker.reset();
 }
 
 int adjust_input_gain() __attribute__((noinline));
@@ -93,8 +121,9 @@ int adjust_input_gain() {
     int gain{0};
     uint16_t vpp, vavg, vmin, vmax;
 
+    // readLevels() reports the peak-to-peak level within each block, so
+    // the DC level does not need to settle first.
     set_input_gain(gain);
-    osDelay(1000);   // Need time for DC offset to settle.
 
     std::tie(vpp, vavg, vmin, vmax) = readLevels(AUDIO_IN);
     INFO("\nVpp = %" PRIu16 ", Vavg = %" PRIu16 "\n", vpp, vavg);
@@ -117,15 +146,11 @@ int adjust_input_gain() {
     else gain = 0;
 
     set_input_gain(gain);
-    osDelay(1000);   // Need time for DC offset to settle. (THIS NEEDS TO BE MUCH LONGER.)
 
     std::tie(vpp, vavg, vmin, vmax) = readLevels(AUDIO_IN);
     INFO("\nVpp = %" PRIu16 ", Vavg = %" PRIu16 "\n", vpp, vavg);
     INFO("\nVmin = %" PRIu16 ", Vmax = %" PRIu16 ", setting = %d\n", vmin, vmax, gain);
 
-    virtual_ground = vavg;
-    i_vgnd = 1.0 / virtual_ground;
-
     return gain;
 }
 
@@ -147,8 +172,8 @@ void autoAudioInputLevel()
 }
 
 /**
- * Set the audio input levels from the values stored in EEPROM.  Then
- * analyze the input levels to set the VGND level.
+ * Set the audio input levels from the values stored in EEPROM.  The VGND
+ * level starts at mid-scale and is tracked from the first ADC block.
  */
 void setAudioInputLevels()
 {
@@ -156,15 +181,8 @@ void setAudioInputLevels()
     INFO("Setting input gain: %d", kiss::settings().input_gain);
     set_input_gain(kiss::settings().input_gain);
 
-    osDelay(1000); // Delay for 5 seconds for DC level to settle.
-
-    uint16_t vpp, vavg, vmin, vmax;
-
-    std::tie(vpp, vavg, vmin, vmax) = readLevels(AUDIO_IN);
-    INFO("Vpp = %" PRIu16 ", Vavg = %" PRIu16, vpp, vavg);
-    INFO("Vmin = %" PRIu16 ", Vmax = %" PRIu16, vmin, vmax);
-    virtual_ground = vavg;
-    i_vgnd = 1.0 / virtual_ground;
+    virtual_ground = 8192;  // Mid-scale for 14-bit samples.
+    i_vgnd = 1.0f / virtual_ground;
 }
 
 std::array<int16_t, 128> log_volume;
@@ -204,7 +222,7 @@ void setAudioOutputLevel()
   } else {
       gpio::AUDIO_OUT_ATTEN::off();
   }
-  getModulator().set_gain(r);
+  setModulatorGain(r);
 }
 
 }}} // mobilinkd::tnc::audio
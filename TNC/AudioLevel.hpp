@@ -25,10 +25,39 @@ void init_log_volume();
 void autoAudioInputLevel();
 void setAudioInputLevels();
 void setAudioOutputLevel();
+void set_input_gain(int level);
 
 extern bool streamInputDCOffset;
 constexpr const uint16_t vref = 4095; // Must match ADC output (adjust when oversampling)
 extern int16_t virtual_ground;
 extern float i_vgnd;
 
+/**
+ * Running DC offset and level tracker for the raw ADC samples.  Each
+ * block read from the ADC ring is passed to it, and it keeps
+ * virtual_ground (and i_vgnd) at the running mean.  The offset follows
+ * the op amp and coupling capacitor as they settle after a gain change,
+ * and as the radio warms up, without stopping to measure it.
+ *
+ * The first block after reset() seeds the estimate; after that it moves
+ * with a time constant of 2^DC_SHIFT blocks (0.2-0.5s depending on the
+ * modem).
+ */
+struct LevelTracker
+{
+    static constexpr uint32_t DC_SHIFT = 7;
+
+    int32_t dc_{0};         ///< Running mean, Q8.
+    bool primed_{false};
+    uint16_t vmin_{0};      ///< Extremes of the last block.
+    uint16_t vmax_{0};
+
+    void reset() { primed_ = false; }
+    void operator()(const uint16_t* samples, size_t size);
+
+    uint16_t vpp() const { return vmax_ - vmin_; }
+};
+
+extern LevelTracker level_tracker;
+
 }}} // mobilinkd::tnc::audio
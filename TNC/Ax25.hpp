@@ -0,0 +1,77 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mobilinkd { namespace tnc { namespace ax25 {
+
+constexpr size_t ADDRESS_SIZE = 7;
+constexpr size_t MAX_DIGIS = 8;
+constexpr size_t MAX_ADDRESSES = MAX_DIGIS + 2;
+
+constexpr uint8_t H_BIT = 0x80;         ///< Has been repeated (C bit for dest/src).
+constexpr uint8_t SSID_MASK = 0x1E;
+constexpr uint8_t EXTENSION_BIT = 0x01;
+
+constexpr uint8_t UI = 0x03;
+constexpr uint8_t PID_NO_L3 = 0xF0;
+
+using address_type = std::array<uint8_t, ADDRESS_SIZE>;
+
+/**
+ * Convert a "CALL-SSID" string of at most @p size characters (it may be
+ * NUL terminated earlier) to an AX.25 address.
+ *
+ * @return false if the callsign is empty or invalid.
+ */
+inline bool to_address(const char* call, size_t size, address_type& address)
+{
+    size_t len = strnlen(call, size);
+    const char* dash = static_cast<const char*>(memchr(call, '-', len));
+    size_t call_len = dash ? dash - call : len;
+    if (call_len == 0 or call_len > 6) return false;
+
+    uint8_t ssid = 0;
+    if (dash)
+    {
+        if (dash + 1 == call + len) return false;
+        for (const char* c = dash + 1; c != call + len; ++c)
+        {
+            if (!isdigit(*c)) return false;
+            ssid = ssid * 10 + (*c - '0');
+            if (ssid > 15) return false;
+        }
+    }
+
+    for (size_t i = 0; i != 6; ++i)
+    {
+        char c = i < call_len ? toupper(call[i]) : ' ';
+        address[i] = c << 1;
+    }
+    address[6] = 0x60 | (ssid << 1);
+    return true;
+}
+
+/// Compare the callsign and SSID, ignoring the H/C and extension bits.
+inline bool same_call(const address_type& a, const address_type& b)
+{
+    return std::equal(a.begin(), a.begin() + 6, b.begin())
+        and (a[6] & SSID_MASK) == (b[6] & SSID_MASK);
+}
+
+/// True if @p address is a valid callsign other than NOCALL.
+inline bool is_station(const char* call, size_t size, address_type& address)
+{
+    address_type nocall;
+    to_address("NOCALL", 6, nocall);
+    return to_address(call, size, address) and not same_call(address, nocall);
+}
+
+}}} // mobilinkd::tnc::ax25
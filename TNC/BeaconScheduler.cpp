@@ -0,0 +1,215 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "BeaconScheduler.hpp"
+#include "Log.h"
+
+#include "stm32l4xx_hal.h"
+#include "cmsis_os.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern osMessageQId hdlcOutputQueueHandle;
+
+namespace mobilinkd { namespace tnc {
+
+namespace {
+
+bool push_address(hdlc::IoFrame* frame, ax25::address_type address, bool last)
+{
+    address[6] &= ~ax25::EXTENSION_BIT;
+    if (last) address[6] |= ax25::EXTENSION_BIT;
+    for (auto c : address)
+    {
+        if (!frame->push_back(c)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * Encode the beacon as a UI frame without FCS.
+ *
+ * @return the frame, or nullptr if the destination or path is invalid
+ *  or no frame is available.
+ */
+hdlc::IoFrame* BeaconScheduler::build_frame(const kiss::Beacon& beacon, const ax25::address_type& mycall)
+{
+    ax25::address_type dest;
+    if (!ax25::to_address(beacon.dest.data(), beacon.dest.size(), dest))
+    {
+        ERROR("Invalid beacon destination");
+        return nullptr;
+    }
+    dest[6] |= ax25::H_BIT;     // Command frame.
+
+    // Path is a comma separated list of up to MAX_DIGIS addresses.
+    std::array<ax25::address_type, ax25::MAX_DIGIS> path;
+    size_t count = 0;
+    auto first = reinterpret_cast<const char*>(beacon.path);
+    auto last = first + strnlen(first, sizeof(beacon.path));
+    while (first != last)
+    {
+        auto comma = std::find(first, last, ',');
+        while (first != comma and *first == ' ') ++first;
+        if (first != comma)
+        {
+            if (count == path.size() or !ax25::to_address(first, comma - first, path[count]))
+            {
+                ERROR("Invalid beacon path");
+                return nullptr;
+            }
+            ++count;
+        }
+        first = comma == last ? last : comma + 1;
+    }
+
+    auto frame = hdlc::ioFramePool().acquire();
+    if (!frame) return nullptr;
+
+    bool ok = push_address(frame, dest, false) and push_address(frame, mycall, count == 0);
+    for (size_t i = 0; ok and i != count; ++i) ok = push_address(frame, path[i], i == count - 1);
+    ok = ok and frame->push_back(ax25::UI) and frame->push_back(ax25::PID_NO_L3);
+
+    auto text = beacon.text;
+    auto text_end = text + strnlen(reinterpret_cast<const char*>(text), sizeof(beacon.text));
+    for (; ok and text != text_end; ++text) ok = frame->push_back(*text);
+
+    if (!ok)
+    {
+        hdlc::release(frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+uint32_t BeaconScheduler::jitter(uint32_t range)
+{
+    // xorshift32; only needs to differ between stations and slots.
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return range ? random_ % range : 0;
+}
+
+void BeaconScheduler::schedule(size_t index, uint32_t delay)
+{
+    auto& slot = slots_[index];
+    slot.due = now_ + std::max(delay, uint32_t(1));
+    wheel_[slot.due & (WHEEL_SIZE - 1)] |= (1 << index);
+}
+
+/**
+ * Rebuild the cached frames after a settings change.  Slots which were
+ * already running keep their due time unless the interval got shorter;
+ * new slots start after the startup delay plus a random stagger.
+ */
+void BeaconScheduler::configure(const kiss::Hardware& hardware)
+{
+    if (!configured_) random_ = (HAL_GetUIDw0() ^ osKernelSysTick()) | 1;
+
+    checksum_ = hardware.checksum;
+    configured_ = true;
+
+    ax25::address_type mycall;
+    bool station = ax25::is_station(hardware.mycall.data(), hardware.mycall.size(), mycall);
+
+    wheel_.fill(0);
+    for (size_t i = 0; i != slots_.size(); ++i)
+    {
+        auto& slot = slots_[i];
+        auto& beacon = hardware.beacons[i];
+        bool running = slot.frame != nullptr;
+
+        if (slot.frame) hdlc::release(slot.frame);
+        slot.frame = nullptr;
+
+        if (!station or beacon.seconds == 0) continue;
+        slot.frame = build_frame(beacon, mycall);
+        if (!slot.frame) continue;
+
+        uint32_t remaining = slot.due - now_;
+        if (running and int32_t(remaining) > 0 and remaining <= beacon.seconds)
+        {
+            schedule(i, remaining);
+        }
+        else
+        {
+            schedule(i, STARTUP_DELAY + jitter(std::min<uint32_t>(beacon.seconds, WHEEL_SIZE)));
+        }
+        INFO("Beacon %d every %d seconds", int(i), int(beacon.seconds));
+    }
+}
+
+void BeaconScheduler::send(size_t index)
+{
+    auto cached = slots_[index].frame;
+
+    auto frame = hdlc::ioFramePool().acquire();
+    if (!frame) return;
+
+    for (auto c : *cached)
+    {
+        if (!frame->push_back(c))
+        {
+            hdlc::release(frame);
+            return;
+        }
+    }
+
+    TNC_DEBUG("Sending beacon %d", int(index));
+    if (osMessagePut(hdlcOutputQueueHandle, reinterpret_cast<uint32_t>(frame), 0) != osOK)
+    {
+        ERROR("Failed to write beacon to TX queue");
+        hdlc::release(frame);
+    }
+}
+
+void BeaconScheduler::poll()
+{
+    auto& hardware = kiss::settings();
+
+    uint32_t ticks = osKernelSysTick();
+    uint32_t elapsed = (ticks - tick_) / 1000;
+    tick_ += elapsed * 1000;
+
+    if (!configured_ or hardware.checksum != checksum_)
+    {
+        now_ += elapsed;
+        configure(hardware);
+        return;
+    }
+
+    if (elapsed == 0) return;
+
+    // Visit each bucket for the seconds passed, at most one turn of the
+    // wheel.  Slots in a bucket may be due on a later turn.
+    uint32_t now = now_ + elapsed;
+    uint32_t second = now_ + 1;
+    if (elapsed > WHEEL_SIZE) second = now - WHEEL_SIZE + 1;
+    now_ = now;
+
+    for (; second != now + 1; ++second)
+    {
+        auto& bucket = wheel_[second & (WHEEL_SIZE - 1)];
+        for (size_t i = 0; bucket != 0 and i != slots_.size(); ++i)
+        {
+            if (!(bucket & (1 << i)) or int32_t(slots_[i].due - now) > 0) continue;
+            bucket &= ~(1 << i);
+            send(i);
+
+            uint32_t seconds = hardware.beacons[i].seconds;
+            schedule(i, seconds - jitter(std::min(MAX_JITTER, seconds / 10) + 1));
+        }
+    }
+}
+
+BeaconScheduler& beaconScheduler()
+{
+    static BeaconScheduler instance;
+    return instance;
+}
+
+}} // mobilinkd::tnc
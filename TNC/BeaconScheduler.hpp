@@ -0,0 +1,70 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "Ax25.hpp"
+#include "HdlcFrame.hpp"
+#include "KissHardware.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * Transmits the beacons stored in the KISS settings without host
+ * involvement.
+ *
+ * Each configured beacon slot is encoded once into a cached UI frame
+ * (MYCALL > dest, path, text), which is rebuilt only when the settings
+ * checksum changes.  A copy of the cached image is queued for transmission
+ * when the slot is due.
+ *
+ * Due times are kept in a hashed timing wheel with one second buckets, so
+ * poll() only looks at the slots in the buckets for the seconds that have
+ * passed.  Slots are staggered at startup and each interval is shortened
+ * by a random amount so that stations (and slots) with the same interval
+ * do not stay synchronized.
+ */
+struct BeaconScheduler
+{
+    static constexpr size_t WHEEL_SIZE = 64;        ///< Seconds; power of 2.
+    static constexpr uint32_t STARTUP_DELAY = 30;   ///< Seconds before the first beacon.
+    static constexpr uint32_t MAX_JITTER = 30;      ///< Seconds.
+
+    static_assert((WHEEL_SIZE & (WHEEL_SIZE - 1)) == 0, "WHEEL_SIZE must be a power of 2");
+    static_assert(kiss::NUMBER_OF_BEACONS <= 8, "wheel buckets are uint8_t bitmaps");
+
+    struct Slot
+    {
+        hdlc::IoFrame* frame{nullptr};  ///< Cached frame image, without FCS.
+        uint32_t due{0};                ///< Seconds.
+    };
+
+    std::array<Slot, kiss::NUMBER_OF_BEACONS> slots_;
+    std::array<uint8_t, WHEEL_SIZE> wheel_{};   ///< Bitmap of slots per bucket.
+    uint32_t tick_{0};                          ///< osKernelSysTick() at now_.
+    uint32_t now_{0};                           ///< Last second processed.
+    uint16_t checksum_{0};
+    uint32_t random_{0};
+    bool configured_{false};
+
+    /**
+     * Called from the IO event loop.  Cheap when no second boundary has
+     * passed since the last call.
+     */
+    void poll();
+
+private:
+    void configure(const kiss::Hardware& hardware);
+    void schedule(size_t index, uint32_t delay);
+    void send(size_t index);
+    uint32_t jitter(uint32_t range);
+    static hdlc::IoFrame* build_frame(const kiss::Beacon& beacon, const ax25::address_type& mycall);
+};
+
+BeaconScheduler& beaconScheduler();
+
+}} // mobilinkd::tnc
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
 #include <cstddef>
 #include <limits>
@@ -17,12 +18,19 @@
 
 namespace mobilinkd {
 
+/**
+ * Sync word correlator.  FloatType may be a floating point type or a
+ * fixed-point (q15) integer type.  With an integer sample type the
+ * correlation is accumulated in 32 bits and the signal level is tracked
+ * with integer arithmetic; only limit() returns a float.
+ */
 template <typename FloatType, size_t Symbols, size_t SamplesPerSymbol>
 struct Correlator
 {
     static constexpr size_t SYMBOLS = Symbols;
     static constexpr size_t SAMPLES_PER_SYMBOL = SamplesPerSymbol;
     using value_type = FloatType;
+    using accum_type = std::conditional_t<std::is_floating_point_v<FloatType>, FloatType, int32_t>;
     using buffer_t = std::array<FloatType, SYMBOLS * SAMPLES_PER_SYMBOL>;
     using sync_t = std::array<int8_t, SYMBOLS>;
     using sample_filter_t = tnc::IirFilter<3>;
@@ -43,17 +51,32 @@ struct Correlator
     sample_filter_t sample_filter{b, a};
     std::array<int, SYMBOLS> tmp;
 
-    void sample(float value)
+    // Fixed-point equivalent of the IIR above: two cascaded single-pole
+    // low-pass filters (alpha = 1/64) on the sample magnitude, in Q8.
+    static constexpr int ENVELOPE_SHIFT = 6;
+    static constexpr int ENVELOPE_FRAC_BITS = 8;
+    std::array<int32_t, 2> envelope_ = {0, 0};
+
+    void sample(value_type value)
     {
-        limit_ = sample_filter(std::abs(value));
+        if constexpr (std::is_floating_point_v<value_type>)
+        {
+            limit_ = sample_filter(std::abs(value));
+        }
+        else
+        {
+            int32_t level = std::abs(int32_t(value)) << ENVELOPE_FRAC_BITS;
+            envelope_[0] += (level - envelope_[0]) >> ENVELOPE_SHIFT;
+            envelope_[1] += (envelope_[0] - envelope_[1]) >> ENVELOPE_SHIFT;
+        }
         buffer_[buffer_pos_] = value;
         prev_buffer_pos_ = buffer_pos_;
         if (++buffer_pos_ == buffer_.size()) buffer_pos_ = 0;
     }
 
-    float correlate(sync_t sync)
+    accum_type correlate(sync_t sync)
     {
-        float result = 0.f;
+        accum_type result = 0;
         size_t pos = prev_buffer_pos_ + SAMPLES_PER_SYMBOL;
 
         for (size_t i = 0; i != sync.size(); ++i)
@@ -66,7 +89,14 @@ struct Correlator
     }
 
 
-    float limit() const {return limit_;}
+    float limit() const
+    {
+        if constexpr (std::is_floating_point_v<value_type>)
+            return limit_;
+        else
+            return envelope_[1] * (1.f / (1 << ENVELOPE_FRAC_BITS));
+    }
+
     uint8_t index() const {return prev_buffer_pos_ % SAMPLES_PER_SYMBOL;}
 
     /**
@@ -139,7 +169,8 @@ struct SyncWord
     using value_type = typename Correlator::value_type;
 
     using buffer_t = std::array<int8_t, SYMBOLS>;
-    using sample_buffer_t = std::array<value_type, SAMPLES_PER_SYMBOL>;
+    // Correlation values are kept as float regardless of the sample type.
+    using sample_buffer_t = std::array<float, SAMPLES_PER_SYMBOL>;
 
     buffer_t sync_word_;
     sample_buffer_t samples_;
@@ -155,19 +186,33 @@ struct SyncWord
     {}
 
     float triggered(Correlator& correlator)
+    {
+        return triggered(correlator, correlator.correlate(sync_word_));
+    }
+
+    /**
+     * Apply the trigger thresholds to a correlation value that has
+     * already been computed for this sync word, for example by the
+     * SyncCorrelator.
+     */
+    float triggered(Correlator& correlator, float value)
     {
         float limit_1 = correlator.limit() * magnitude_1_;
         float limit_2 = correlator.limit() * magnitude_2_;
-        auto value = correlator.correlate(sync_word_);
 
         return (value > limit_1 || value < limit_2) ? value : 0.0;
     }
 
     uint8_t operator()(Correlator& correlator)
     {
-        auto value = triggered(correlator);
+        return (*this)(correlator, correlator.correlate(sync_word_));
+    }
+
+    uint8_t operator()(Correlator& correlator, float correlation)
+    {
+        auto value = triggered(correlator, correlation);
 
-        value_type peak_value = 0;
+        float peak_value = 0;
 
         if (std::abs(value) > 0.0)
         {
@@ -218,6 +263,98 @@ struct SyncWord
 
 namespace m17 {
 
+/*
+ * The M17 receive chain sample type.  Building with M17_FIXED_POINT
+ * selects the q15 matched filter and an integer correlator.
+ */
+#if defined(M17_FIXED_POINT)
+using Correlator = ::mobilinkd::Correlator<int16_t, 8, 10>;
+#else
 using Correlator = ::mobilinkd::Correlator<float, 8, 10>;
+#endif
+
+/**
+ * Correlate all of the M17 sync words against the correlator buffer in a
+ * single pass.  Each sync word is 8 symbols of +/-3, so the correlation
+ * is 3 times the signed sum of the samples at the current sample index.
+ * The samples are gathered once and combined pairwise; every sync word
+ * is then built from the same pair sums and differences using only adds
+ * and subtracts.  The inverted sync words are the negated results.
+ *
+ * The values returned are identical to Correlator::correlate() for the
+ * corresponding SyncWord.
+ */
+struct SyncCorrelator
+{
+    enum Pattern : uint8_t { PREAMBLE, LSF, PACKET, EOT, PATTERNS };
+
+    using value_type = Correlator::accum_type;
+    using result_t = std::array<value_type, PATTERNS>;
+
+    static_assert(Correlator::SYMBOLS == 8, "M17 sync words are 8 symbols");
+
+    result_t values_;
+
+    const result_t& operator()(const Correlator& correlator)
+    {
+        constexpr size_t SPS = Correlator::SAMPLES_PER_SYMBOL;
+        constexpr size_t SIZE = Correlator::SYMBOLS * SPS;
+
+        std::array<value_type, Correlator::SYMBOLS> x;
+        size_t pos = correlator.prev_buffer_pos_ + SPS;
+        for (auto& v : x)
+        {
+            if (pos >= SIZE) pos -= SIZE;
+            v = correlator.buffer_[pos];
+            pos += SPS;
+        }
+
+        value_type s01 = x[0] + x[1], d01 = x[0] - x[1];
+        value_type s23 = x[2] + x[3], d23 = x[2] - x[3];
+        value_type s45 = x[4] + x[5], d45 = x[4] - x[5];
+        value_type s67 = x[6] + x[7], d67 = x[6] - x[7];
+
+        value_type s0123 = s01 + s23;
+
+        // +3,-3,+3,-3,+3,-3,+3,-3
+        values_[PREAMBLE] = (d01 + d23) + (d45 + d67);
+        // +3,+3,+3,+3,-3,-3,+3,-3
+        values_[LSF] = s0123 - s45 + d67;
+        // +3,-3,+3,+3,-3,-3,-3,-3
+        values_[PACKET] = d01 + s23 - (s45 + s67);
+        // +3,+3,+3,+3,+3,+3,-3,+3
+        values_[EOT] = s0123 + s45 - d67;
+
+        for (auto& v : values_) v *= 3;
+
+        return values_;
+    }
+
+    value_type operator[](Pattern pattern) const
+    {
+        return values_[pattern];
+    }
+
+    /**
+     * Return the strongest correlation of the last pass, and its index.
+     * The index is (2 * Pattern) for the sync word and (2 * Pattern + 1)
+     * for its inverse.  The value returned is always the signed
+     * correlation value.
+     */
+    std::tuple<value_type, uint8_t> best() const
+    {
+        value_type best_value = 0;
+        uint8_t best_index = 0;
+        for (uint8_t i = 0; i != PATTERNS; ++i)
+        {
+            if (std::abs(values_[i]) > std::abs(best_value))
+            {
+                best_value = values_[i];
+                best_index = i * 2 + (best_value < 0);
+            }
+        }
+        return std::make_tuple(best_value, best_index);
+    }
+};
 
 }} // mobilinkd::m17
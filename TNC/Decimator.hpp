@@ -0,0 +1,213 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/*
+ * Decimation and resampling kernels for capturing audio above the
+ * demodulator sample rate.  These have no CMSIS or HAL dependencies so
+ * that they can be built and tested on the host.
+ */
+
+/**
+ * Decimate by 2 with a half-band FIR filter.  Every other tap of a
+ * half-band filter is zero and the centre tap is 0.5, so only the N
+ * non-zero taps on one side are stored and each output costs N
+ * multiply-accumulates (the symmetric pairs are pre-added).
+ *
+ * @tparam BLOCK_SIZE is the number of input samples per call.
+ * @tparam N is the number of non-zero taps on each side of the centre;
+ *  the filter length is 4 * N - 1.
+ */
+template <size_t BLOCK_SIZE, size_t N>
+struct HalfBandDecimator
+{
+    static_assert(BLOCK_SIZE % 2 == 0, "block size must be even");
+
+    static constexpr size_t FILTER_SIZE = 4 * N - 1;
+    static constexpr size_t OUTPUT_SIZE = BLOCK_SIZE / 2;
+
+    std::array<int16_t, N> taps_;   ///< Q15, outermost first.
+    int16_t state_[BLOCK_SIZE + FILTER_SIZE - 1] = {};
+    int16_t output_[OUTPUT_SIZE];
+
+    HalfBandDecimator(const std::array<int16_t, N>& taps)
+    : taps_(taps)
+    {}
+
+    const int16_t* operator()(const int16_t* input)
+    {
+        std::copy(input, input + BLOCK_SIZE, state_ + FILTER_SIZE - 1);
+
+        for (size_t i = 0; i != OUTPUT_SIZE; ++i)
+        {
+            const int16_t* x = state_ + 2 * i + 1;
+            int32_t acc = int32_t(x[FILTER_SIZE / 2]) << 14;
+            for (size_t k = 0; k != N; ++k)
+            {
+                acc += int32_t(taps_[k]) * (int32_t(x[2 * k]) + x[FILTER_SIZE - 1 - 2 * k]);
+            }
+            acc = (acc + (1 << 14)) >> 15;
+            output_[i] = std::clamp<int32_t>(acc, INT16_MIN, INT16_MAX);
+        }
+
+        std::copy(state_ + BLOCK_SIZE, state_ + BLOCK_SIZE + FILTER_SIZE - 1, state_);
+        return output_;
+    }
+};
+
+/**
+ * Cascaded integrator-comb decimator.  N integrators run at the input
+ * rate and N combs (differential delay 1) at the output rate, with no
+ * multiplies.  The DC gain of R^N is removed by a shift, so R must be a
+ * power of 2.  The passband droop is not compensated; it is small when
+ * the signal bandwidth is well below the output Nyquist frequency.
+ *
+ * Intermediate values wrap modulo 2^32, which is correct for a CIC filter
+ * as long as the output fits in 16 + N * log2(R) <= 32 bits.
+ */
+template <size_t R, size_t N>
+struct CicDecimator
+{
+    static_assert(R > 1 and (R & (R - 1)) == 0, "R must be a power of 2");
+
+    static constexpr size_t log2(size_t x) { return x == 1 ? 0 : 1 + log2(x / 2); }
+    static constexpr size_t SHIFT = N * log2(R);
+    static_assert(16 + SHIFT <= 32, "CIC register growth exceeds 32 bits");
+
+    std::array<uint32_t, N> integrator_{};
+    std::array<uint32_t, N> comb_{};
+    size_t phase_{0};
+
+    /**
+     * Decimate @p size input samples.  The phase is carried across calls,
+     * so @p size need not be a multiple of R.
+     *
+     * @return the number of samples written to @p output.
+     */
+    size_t operator()(const int16_t* input, size_t size, int16_t* output)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i != size; ++i)
+        {
+            uint32_t x = uint32_t(int32_t(input[i]));
+            for (auto& integrator : integrator_)
+            {
+                integrator += x;
+                x = integrator;
+            }
+            if (++phase_ != R) continue;
+            phase_ = 0;
+
+            for (auto& comb : comb_)
+            {
+                uint32_t y = x - comb;
+                comb = x;
+                x = y;
+            }
+            output[count++] = int16_t(int32_t(x) >> SHIFT);
+        }
+        return count;
+    }
+};
+
+/**
+ * Resample by L/M with a polyphase FIR filter.  The prototype low-pass
+ * filter (L * TAPS long, Hann windowed sinc) runs at L times the input
+ * rate; only the phase needed for each output sample is computed, so each
+ * output costs TAPS multiply-accumulates.
+ *
+ * Each phase is normalized to a DC gain of exactly 1, so raw ADC samples
+ * can be resampled with their DC offset (virtual ground) intact.  This
+ * requires the input to be within 0-16383 (14-bit samples) to avoid
+ * overflow.
+ *
+ * @tparam BLOCK_SIZE is the number of input samples per call.
+ * @tparam L is the interpolation factor.
+ * @tparam M is the decimation factor.
+ * @tparam TAPS is the number of taps per phase.
+ */
+template <size_t BLOCK_SIZE, size_t L, size_t M, size_t TAPS>
+struct RationalResampler
+{
+    static constexpr size_t MAX_OUTPUT_SIZE = (BLOCK_SIZE * L + M - 1) / M;
+
+    std::array<std::array<int16_t, TAPS>, L> taps_;    ///< Q15, per phase, newest sample first.
+    int16_t state_[BLOCK_SIZE + TAPS - 1] = {};
+    size_t phase_{0};
+
+    /**
+     * @param cutoff is the low-pass cutoff as a fraction of the input
+     *  sample rate.  It must be below 0.5 * min(1, L / M).
+     */
+    RationalResampler(float cutoff)
+    {
+        constexpr size_t FILTER_SIZE = L * TAPS;
+        constexpr float PI = 3.14159265358979f;
+        const float fc = cutoff / L;    // Relative to the upsampled rate.
+
+        for (size_t p = 0; p != L; ++p)
+        {
+            std::array<float, TAPS> h;
+            float sum = 0.0f;
+            for (size_t k = 0; k != TAPS; ++k)
+            {
+                float n = float(p + k * L) - float(FILTER_SIZE - 1) / 2.0f;
+                float sinc = n == 0.0f ? 2.0f * fc : std::sin(2.0f * PI * fc * n) / (PI * n);
+                float window = 0.5f - 0.5f * std::cos(2.0f * PI * (p + k * L + 0.5f) / FILTER_SIZE);
+                h[k] = sinc * window;
+                sum += h[k];
+            }
+
+            // Round to Q15 and put the rounding error in the largest tap.
+            int32_t total = 0;
+            size_t largest = 0;
+            for (size_t k = 0; k != TAPS; ++k)
+            {
+                taps_[p][k] = int16_t(std::lround(h[k] / sum * 32768.0f));
+                total += taps_[p][k];
+                if (taps_[p][k] > taps_[p][largest]) largest = k;
+            }
+            taps_[p][largest] += 32768 - total;
+        }
+    }
+
+    /**
+     * Resample one block.  The phase is carried across calls, so the
+     * number of output samples varies by one from block to block.
+     *
+     * @param output must have room for MAX_OUTPUT_SIZE samples.
+     * @return the number of samples written to @p output.
+     */
+    size_t operator()(const int16_t* input, int16_t* output)
+    {
+        std::copy(input, input + BLOCK_SIZE, state_ + TAPS - 1);
+
+        size_t count = 0;
+        for (size_t i = 0; i != BLOCK_SIZE; ++i)
+        {
+            const int16_t* x = state_ + TAPS - 1 + i;  // Newest sample.
+            for (; phase_ < L; phase_ += M)
+            {
+                const auto& h = taps_[phase_];
+                int32_t acc = 0;
+                for (size_t k = 0; k != TAPS; ++k) acc += int32_t(h[k]) * x[-int(k)];
+                output[count++] = int16_t((acc + (1 << 14)) >> 15);
+            }
+            phase_ -= L;
+        }
+
+        std::copy(state_ + BLOCK_SIZE, state_ + BLOCK_SIZE + TAPS - 1, state_);
+        return count;
+    }
+};
+
+}} // mobilinkd::tnc
@@ -2,26 +2,66 @@
 // All rights reserved.
 
 #include "Demodulator.hpp"
+#include "GPIO.hpp"
+#include "Log.h"
+#include "power.h"
 
 namespace mobilinkd { namespace tnc {
 
+namespace {
+
+const uint32_t OVERSAMPLING_RATIO[] = {
+    0, ADC_OVERSAMPLING_RATIO_2, ADC_OVERSAMPLING_RATIO_4,
+    ADC_OVERSAMPLING_RATIO_8, ADC_OVERSAMPLING_RATIO_16,
+    ADC_OVERSAMPLING_RATIO_32, ADC_OVERSAMPLING_RATIO_64,
+    ADC_OVERSAMPLING_RATIO_128, ADC_OVERSAMPLING_RATIO_256
+};
+
+const uint32_t RIGHT_BIT_SHIFT[] = {
+    0, 0, ADC_RIGHTBITSHIFT_NONE, ADC_RIGHTBITSHIFT_1, ADC_RIGHTBITSHIFT_2,
+    ADC_RIGHTBITSHIFT_3, ADC_RIGHTBITSHIFT_4, ADC_RIGHTBITSHIFT_5,
+    ADC_RIGHTBITSHIFT_6
+};
+
+/**
+ * Set the hardware oversampling ratio to 2^n, keeping 14-bit samples.
+ * The ADC must be stopped.  The ADC is only re-initialized when the
+ * ratio changes.
+ */
+void set_oversampling(uint32_t n)
+{
+    auto& oversampling = DEMODULATOR_ADC_HANDLE.Init.Oversampling;
+    if (oversampling.Ratio == OVERSAMPLING_RATIO[n]) return;
+
+    oversampling.Ratio = OVERSAMPLING_RATIO[n];
+    oversampling.RightBitShift = RIGHT_BIT_SHIFT[n];
+    if (HAL_ADC_Init(&DEMODULATOR_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
+    INFO("ADC oversampling = %d", 1 << n);
+}
+
+} // namespace
+
 /**
- * Start the ADC DMA transfer.  The block size is equal to the number of
- * 32-bit elements in the buffer.  This is also equal to the number of
- * 16-bit elements in each DMA "half complete" transfer.  Each DMA transfer
- * results in block_size * 2 bytes being transferred.
+ * Start the ADC DMA transfer.  The block size is the number of 16-bit
+ * samples in each slot of the DMA ring buffer.  The circular DMA transfer
+ * covers all audio::ADC_SLOTS slots, so each "half complete" interrupt
+ * marks ADC_SLOTS / 2 blocks as ready.
  *
- * We must bear in mind that the DMA buffer size is expressed in DWORDs,
- * the DMA transfer size is expressed in WORDs, and the memory copy operation
- * in BYTEs.
+ * We must bear in mind that the DMA buffer is declared in DWORDs and
+ * the DMA transfer size is expressed in WORDs.
  *
  * @param period
  * @param block_size
+ * @param interrupt enables the TIM6 update interrupt.
+ * @param oversampling is the log2 hardware oversampling ratio, normally
+ *  from audio::adc_oversampling(), in the range 2-8.
  */
-void IDemodulator::startADC(uint32_t period, uint32_t block_size, bool interrupt)
+void IDemodulator::startADC(uint32_t period, uint32_t block_size, bool interrupt,
+    uint32_t oversampling)
 {
     HAL_StatusTypeDef status;
 
+    set_oversampling(oversampling);
     audio::set_adc_block_size(block_size);
 
     __HAL_TIM_SET_AUTORELOAD(&htim6, period);
@@ -49,5 +89,90 @@ void IDemodulator::stopADC()
     INFO("IDemodulator::stopADC");
 }
 
+/**
+ * Measure the battery voltage with the battery ADC, using TIM6 as the
+ * ADC timer.  The demodulator ADC must be stopped.
+ *
+ * @return the battery voltage in mV.
+ */
+uint32_t IDemodulator::readBattery()
+{
+#if defined(STM32L4P5xx) || defined(STM32L4Q5xx)
+    return read_battery_level();
+#elif !(defined(NUCLEOTNC))
+    TNC_DEBUG("enter IDemodulator::readBattery");
+
+    constexpr uint16_t VREF = 16383;
+
+    ADC_ChannelConfTypeDef sConfig;
+
+    sConfig.Channel = ADC_CHANNEL_VREFINT;
+    sConfig.Rank = ADC_REGULAR_RANK_1;
+    sConfig.SingleDiff = ADC_SINGLE_ENDED;
+    sConfig.SamplingTime = ADC_SAMPLETIME_247CYCLES_5;
+    sConfig.OffsetNumber = ADC_OFFSET_NONE;
+    sConfig.Offset = 0;
+    if (HAL_ADC_ConfigChannel(&BATTERY_ADC_HANDLE, &sConfig) != HAL_OK)
+        CxxErrorHandler();
+
+    htim6.Init.Period = 48000;
+    if (HAL_TIM_Base_Init(&htim6) != HAL_OK) CxxErrorHandler();
+
+    if (HAL_TIM_Base_Start(&htim6) != HAL_OK)
+        CxxErrorHandler();
+
+    if (HAL_ADC_Start(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
+    if (HAL_ADC_PollForConversion(&BATTERY_ADC_HANDLE, 3) != HAL_OK) CxxErrorHandler();
+    auto vrefint = HAL_ADC_GetValue(&BATTERY_ADC_HANDLE);
+    if (HAL_ADC_Stop(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
+
+    // Disable battery charging while measuring battery voltage.
+    auto usb_ce = gpio::USB_CE::get();
+    gpio::USB_CE::on();
+
+    gpio::BAT_DIVIDER::off();
+    DELAY(1);
+
+    sConfig.Channel = BATTERY_ADC_CHANNEL;
+    if (HAL_ADC_ConfigChannel(&BATTERY_ADC_HANDLE, &sConfig) != HAL_OK)
+        CxxErrorHandler();
+
+    uint32_t vbat = 0;
+    if (HAL_ADC_Start(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
+    for (size_t i = 0; i != 8; ++i)
+    {
+        if (HAL_ADC_PollForConversion(&BATTERY_ADC_HANDLE, 1) != HAL_OK) CxxErrorHandler();
+        vbat += HAL_ADC_GetValue(&BATTERY_ADC_HANDLE);
+    }
+
+    vbat /= 8;
+
+    if (HAL_ADC_Stop(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
+    if (HAL_TIM_Base_Stop(&htim6) != HAL_OK)
+        CxxErrorHandler();
+
+    gpio::BAT_DIVIDER::on();
+
+    // Restore battery charging state.
+    if (!usb_ce) gpio::USB_CE::off();
+
+    INFO("Vref = %lu", vrefint);
+    INFO("Vbat = %lu (raw)", vbat);
+
+    // Order of operations is important to avoid underflow.
+    vbat *= 6600;
+    vbat /= (VREF + 1);
+
+    uint32_t vref = ((vrefint * 3300) + (VREF / 2)) / VREF;
+
+    INFO("Vref = %lumV", vref);
+    INFO("Vbat = %lumV", vbat);
+
+    TNC_DEBUG("exit IDemodulator::readBattery");
+    return vbat;
+#else
+    return 0;
+#endif
+}
 
 }} // mobilinkd::tnc
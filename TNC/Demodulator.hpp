@@ -22,6 +22,18 @@ struct IDemodulator
 {
     virtual void start() = 0;
     virtual void stop() = 0;
+
+    /**
+     * Abandon any frame in progress and restart symbol timing.  Called
+     * when ADC blocks have been lost, so that a frame is not decoded
+     * across the gap.
+     */
+    virtual void reset() = 0;
+    /**
+     * Demodulate one block of raw ADC samples, read in place from the DMA
+     * ring buffer.  The demodulator removes audio::virtual_ground in its
+     * first filter stage.
+     */
     virtual hdlc::IoFrame* operator()(const q15_t* samples) = 0;
     virtual float readTwist() = 0;
     virtual uint32_t readBatteryLevel() = 0;
@@ -41,11 +53,27 @@ struct IDemodulator
      */
     virtual void passall(bool enabled) = 0;
 
+    /**
+     * Copy the adaptive equalizer taps (Q14) into @p taps.
+     *
+     * @return the number of taps copied; 0 if the demodulator does not
+     *  have an equalizer.
+     */
+    virtual size_t readEqualizer(int16_t* taps, size_t size) const
+    {
+        (void) taps;
+        (void) size;
+        return 0;
+    }
+
     virtual ~IDemodulator() {}
 
-    static void startADC(uint32_t period, uint32_t block_size, bool interrupt = true);
+    static void startADC(uint32_t period, uint32_t block_size, bool interrupt = true,
+        uint32_t oversampling = audio::ADC_DEFAULT_OVERSAMPLING);
 
     static void stopADC();
+
+    static uint32_t readBattery();
 };
 
 }} // mobilinkd::tnc
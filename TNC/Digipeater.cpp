@@ -0,0 +1,253 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "Digipeater.hpp"
+#include "Log.h"
+
+#include "cmsis_os.h"
+
+#include <algorithm>
+#include <cctype>
+
+extern osMessageQId hdlcOutputQueueHandle;
+
+namespace mobilinkd { namespace tnc {
+
+using ax25::H_BIT;
+using ax25::SSID_MASK;
+using ax25::EXTENSION_BIT;
+using ax25::to_address;
+using ax25::same_call;
+
+/**
+ * Copy the address field into path_.
+ *
+ * @return true if the frame has at least one digipeater address.
+ */
+bool Digipeater::parse_path(hdlc::IoFrame* frame, size_t size)
+{
+    count_ = 0;
+    header_size_ = 0;
+
+    auto it = frame->begin();
+    for (size_t i = 0; i != size; ++i, ++it)
+    {
+        auto& address = path_[count_];
+        address[i % ADDRESS_SIZE] = *it;
+        if (i % ADDRESS_SIZE != ADDRESS_SIZE - 1) continue;
+
+        ++count_;
+        if (address[6] & EXTENSION_BIT)
+        {
+            header_size_ = i + 1;
+            return count_ > 2 and header_size_ < size;
+        }
+        if (count_ == MAX_ADDRESSES) return false;
+    }
+    return false;
+}
+
+void Digipeater::insert(size_t index, const address_type& address)
+{
+    std::copy_backward(path_.begin() + index, path_.begin() + count_,
+        path_.begin() + count_ + 1);
+    path_[index] = address;
+    ++count_;
+}
+
+void Digipeater::erase(size_t first, size_t last)
+{
+    std::copy(path_.begin() + last, path_.begin() + count_, path_.begin() + first);
+    count_ -= last - first;
+}
+
+/**
+ * Try to match the alias to the digipeater address at @p index, updating
+ * the path on success.
+ */
+bool Digipeater::match_alias(const kiss::Alias& alias, size_t index, const address_type& mycall)
+{
+    auto& digi = path_[index];
+
+    if (alias.hops == 0)
+    {
+        address_type address;
+        if (!to_address(alias.call.data(), alias.call.size(), address)) return false;
+        if (!same_call(digi, address)) return false;
+        if (alias.insert_id) digi = mycall;
+        digi[6] |= H_BIT;
+        return true;
+    }
+
+    // WIDEn-N: the alias, the digit n and SSID N, with 0 < N <= n <= hops.
+    size_t len = strnlen(alias.call.data(), alias.call.size());
+    if (len == 0 or len > 5) return false;
+    for (size_t i = 0; i != len; ++i)
+    {
+        if ((digi[i] >> 1) != toupper(alias.call[i])) return false;
+    }
+    for (size_t i = len + 1; i != 6; ++i)
+    {
+        if ((digi[i] >> 1) != ' ') return false;
+    }
+    int n = (digi[len] >> 1) - '0';
+    if (n < 1 or n > 7 or n > alias.hops) return false;
+    uint8_t hops = (digi[6] & SSID_MASK) >> 1;
+    if (hops == 0 or hops > n) return false;
+
+    --hops;
+    digi[6] = (digi[6] & ~SSID_MASK) | (hops << 1);
+    if (hops == 0) digi[6] |= H_BIT;
+
+    if (alias.insert_id)
+    {
+        address_type id = mycall;
+        id[6] |= H_BIT;
+        if (count_ < MAX_ADDRESSES) insert(index, id);
+        else if (hops == 0) digi = id;
+    }
+    return true;
+}
+
+/**
+ * Update the path for the next unused hop.
+ *
+ * @return false if this station should not digipeat the frame.
+ */
+bool Digipeater::rewrite_path(const kiss::Hardware& hardware, const address_type& mycall)
+{
+    size_t next = 2;
+    while (next != count_ and (path_[next][6] & H_BIT)) ++next;
+    if (next == count_) return false;
+
+    if (same_call(path_[next], mycall))
+    {
+        path_[next][6] |= H_BIT;
+        return true;
+    }
+
+    for (auto& alias : hardware.aliases)
+    {
+        if (!alias.set or !alias.use) continue;
+        if (match_alias(alias, next, mycall)) return true;
+    }
+
+    // Preemptive aliases may match a later hop, removing those before it.
+    for (size_t i = next + 1; i < count_; ++i)
+    {
+        for (auto& alias : hardware.aliases)
+        {
+            if (!alias.set or !alias.use or !alias.preempt) continue;
+            if (match_alias(alias, i, mycall))
+            {
+                erase(next, i);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Check the digipeat history for the packet, ignoring the path, and add
+ * it if not found.
+ */
+bool Digipeater::is_duplicate(hdlc::IoFrame* frame, size_t size, uint32_t window)
+{
+    // FNV-1a over the destination, source and everything after the path.
+    uint32_t hash = 2166136261u;
+    auto update = [&hash](uint8_t c) { hash = (hash ^ c) * 16777619u; };
+
+    for (size_t i = 0; i != 2; ++i)
+    {
+        std::for_each(path_[i].begin(), path_[i].begin() + 6, update);
+        update(path_[i][6] & SSID_MASK);
+    }
+    auto it = frame->begin();
+    std::advance(it, header_size_);
+    for (size_t i = header_size_; i != size; ++i) update(*it++);
+
+    uint32_t now = osKernelSysTick();
+    for (auto& entry : history_)
+    {
+        if (entry.hash == hash and now - entry.time < window) return true;
+    }
+
+    history_[history_index_] = {hash, now};
+    history_index_ = (history_index_ + 1) % HISTORY_SIZE;
+    return false;
+}
+
+/**
+ * Build the frame to transmit from the new path and the rest of the
+ * received frame, without its FCS.
+ */
+hdlc::IoFrame* Digipeater::build_frame(hdlc::IoFrame* frame, size_t size)
+{
+    auto result = hdlc::ioFramePool().acquire();
+    if (!result) return nullptr;
+
+    for (size_t i = 0; i != count_; ++i)
+    {
+        auto& address = path_[i];
+        for (size_t j = 0; j != ADDRESS_SIZE - 1; ++j) result->push_back(address[j]);
+        uint8_t ssid = address[6] & ~EXTENSION_BIT;
+        if (i == count_ - 1) ssid |= EXTENSION_BIT;
+        result->push_back(ssid);
+    }
+
+    auto it = frame->begin();
+    std::advance(it, header_size_);
+    for (size_t i = header_size_; i != size; ++i)
+    {
+        if (!result->push_back(*it++))
+        {
+            hdlc::release(result);
+            return nullptr;
+        }
+    }
+
+    return result;
+}
+
+void Digipeater::operator()(hdlc::IoFrame* frame)
+{
+    auto& hardware = kiss::settings();
+
+    if (std::none_of(std::begin(hardware.aliases), std::end(hardware.aliases),
+        [](const kiss::Alias& alias) { return alias.set and alias.use; }))
+    {
+        return;
+    }
+
+    if (!frame->ok() or frame->size() < 2) return;
+
+    // Digipeating requires a callsign for identification.
+    address_type mycall;
+    if (!ax25::is_station(hardware.mycall.data(), hardware.mycall.size(), mycall)) return;
+
+    const size_t size = frame->size() - 2;  // Without the FCS.
+    if (!parse_path(frame, size)) return;
+    if (same_call(path_[1], mycall)) return;    // Our own packet.
+    if (!rewrite_path(hardware, mycall)) return;
+    if (is_duplicate(frame, size, hardware.dedupe_seconds * 1000)) return;
+
+    auto digi = build_frame(frame, size);
+    if (!digi) return;
+
+    TNC_DEBUG("Digipeating frame");
+    if (osMessagePut(hdlcOutputQueueHandle, reinterpret_cast<uint32_t>(digi), 0) != osOK)
+    {
+        ERROR("Failed to write digipeated frame to TX queue");
+        hdlc::release(digi);
+    }
+}
+
+Digipeater& digipeater()
+{
+    static Digipeater instance;
+    return instance;
+}
+
+}} // mobilinkd::tnc
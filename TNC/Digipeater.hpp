@@ -0,0 +1,69 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "Ax25.hpp"
+#include "HdlcFrame.hpp"
+#include "KissHardware.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * APRS digipeater driven by the alias table in the KISS settings.
+ *
+ * Aliases with hops == 0 are matched exactly (e.g. "RELAY" or
+ * "GATE-1").  Aliases with hops > 0 are WIDEn-N style aliases; "WIDE"
+ * with hops = 2 matches WIDE1-1, WIDE2-1 and WIDE2-2 and decrements N.
+ * insert_id adds (or substitutes) MYCALL in the path for tracing.
+ * preempt allows the alias to match past unused hops in the path, which
+ * are then removed.  The station's own callsign is always digipeated
+ * when any alias is in use.
+ *
+ * The same packet (source, destination and information field) is only
+ * digipeated once within the dedupe window.
+ */
+struct Digipeater
+{
+    static constexpr size_t ADDRESS_SIZE = ax25::ADDRESS_SIZE;
+    static constexpr size_t MAX_ADDRESSES = ax25::MAX_ADDRESSES;
+    static constexpr size_t HISTORY_SIZE = 16;
+
+    using address_type = ax25::address_type;
+
+    struct History
+    {
+        uint32_t hash;
+        uint32_t time;      ///< osKernelSysTick() when digipeated.
+    };
+
+    std::array<address_type, MAX_ADDRESSES> path_;
+    size_t count_{0};       ///< Number of addresses in path_.
+    size_t header_size_{0}; ///< Size of the received address field.
+    std::array<History, HISTORY_SIZE> history_{};
+    size_t history_index_{0};
+
+    /**
+     * Examine a valid frame received over RF.  If it should be digipeated,
+     * a copy with the path updated is queued for transmission.  The frame
+     * itself is not modified.
+     */
+    void operator()(hdlc::IoFrame* frame);
+
+private:
+    bool parse_path(hdlc::IoFrame* frame, size_t size);
+    bool rewrite_path(const kiss::Hardware& hardware, const address_type& mycall);
+    bool match_alias(const kiss::Alias& alias, size_t index, const address_type& mycall);
+    bool is_duplicate(hdlc::IoFrame* frame, size_t size, uint32_t window);
+    hdlc::IoFrame* build_frame(hdlc::IoFrame* frame, size_t size);
+    void insert(size_t index, const address_type& address);
+    void erase(size_t first, size_t last);
+};
+
+Digipeater& digipeater();
+
+}} // mobilinkd::tnc
@@ -81,6 +81,17 @@ struct BaseDigitalPLL
 	{}
 
 	result_type operator()(bool input)
+	{
+		return (*this)(input, 0);
+	}
+
+	/**
+	 * Clock in one sample.  @p frac is the fraction of a sample period
+	 * before this sample at which the transition occurred, when it is
+	 * known (for example by interpolating the zero crossing).  This keeps
+	 * the timing error measurement accurate at low sample rates.
+	 */
+	result_type operator()(bool input, float_type frac)
 	{
 		sample_ = false;
 		
@@ -95,7 +106,7 @@ struct BaseDigitalPLL
             // Force lock off when no stimulus is present (squelch closed).
             const float_type adjust = bits_ > 16 ? 5.0 : 0.0;
 
-            const float_type offset = count_ / bits_;
+            const float_type offset = (count_ - frac) / bits_;
             const float_type jitter = loop_filter_(offset);
             const float_type abs_offset = std::abs(offset) + adjust;
 			jitter_ = lock_filter_(abs_offset);
@@ -123,6 +134,15 @@ struct BaseDigitalPLL
 	bool sample() const {
 		return sample_;
 	}
+
+	/// Restart symbol timing, e.g. after a gap in the input.
+	void reset()
+	{
+		last_ = false;
+		count_ = 0;
+		sample_ = false;
+		bits_ = 1;
+	}
 };
 
 typedef BaseDigitalPLL<double> DigitalPLL;
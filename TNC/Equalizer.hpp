@@ -0,0 +1,102 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "arm_math.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * Fractionally-spaced adaptive FIR equalizer for binary baseband signals,
+ * adapted with decision-directed sign-sign LMS.
+ *
+ * Taps are Q14 (16384 = 1.0).  The centre tap is fixed at unity to anchor
+ * the gain; only the other taps adapt.  The decision is the sign of the
+ * output scaled by the average output magnitude at the sample points.
+ *
+ * The filter runs a block at a time.  The caller calls adapt() at the
+ * symbol sample points with the index of the sample in the block last
+ * filtered.  When adapt() is not called the taps are frozen.
+ */
+template <size_t BLOCK_SIZE, size_t TAPS>
+struct SignLmsEqualizer
+{
+    static_assert(TAPS % 2 == 1, "equalizer must have an odd number of taps");
+    static_assert(BLOCK_SIZE >= TAPS - 1);
+
+    static constexpr size_t CENTER = TAPS / 2;
+    static constexpr int16_t UNITY = 16384;
+    static constexpr int16_t STEP = 4;              // ~2.4e-4
+    static constexpr int16_t TAP_LIMIT = UNITY / 2;
+
+    using taps_type = std::array<int16_t, TAPS>;
+
+    taps_type taps_;
+    std::array<q15_t, BLOCK_SIZE + TAPS - 1> history_;  // Last TAPS-1 inputs then the block.
+    std::array<q15_t, BLOCK_SIZE> output_;
+    int32_t level_ = 0;
+
+    SignLmsEqualizer()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        taps_.fill(0);
+        taps_[CENTER] = UNITY;
+        history_.fill(0);
+        level_ = 0;
+    }
+
+    const q15_t* operator()(const q15_t* input)
+    {
+        std::copy(history_.end() - (TAPS - 1), history_.end(), history_.begin());
+        std::copy(input, input + BLOCK_SIZE, history_.begin() + (TAPS - 1));
+
+        for (size_t i = 0; i != BLOCK_SIZE; ++i)
+        {
+            const q15_t* x = &history_[i];  // Oldest sample first.
+            int32_t acc = 0;
+            for (size_t k = 0; k != TAPS; ++k)
+            {
+                acc += int32_t(taps_[TAPS - 1 - k]) * x[k];
+            }
+            acc >>= 14;
+            output_[i] = std::min<int32_t>(std::max<int32_t>(acc, -32768), 32767);
+        }
+        return output_.data();
+    }
+
+    /**
+     * Adapt the taps using the output at @p index in the last block as the
+     * symbol sample.
+     */
+    void adapt(size_t index)
+    {
+        int32_t y = output_[index];
+        level_ += (std::abs(y) - level_) >> 4;
+
+        int32_t error = (y >= 0 ? level_ : -level_) - y;
+        if (error == 0) return;
+
+        // x[TAPS - 1 - k] is the input sample multiplied by taps_[k].
+        const q15_t* x = &history_[index];
+        for (size_t k = 0; k != TAPS; ++k)
+        {
+            if (k == CENTER) continue;
+            int16_t step = ((error > 0) == (x[TAPS - 1 - k] >= 0)) ? STEP : -STEP;
+            taps_[k] = std::min<int16_t>(std::max<int16_t>(taps_[k] + step, -TAP_LIMIT), TAP_LIMIT);
+        }
+    }
+
+    const taps_type& taps() const { return taps_; }
+};
+
+}} // mobilinkd::tnc
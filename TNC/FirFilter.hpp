@@ -109,6 +109,63 @@ struct Q15FirFilter {
         arm_fir_fast_q15(&instance, const_cast<q15_t*>(input), filter_output, BLOCK_SIZE);
         return filter_output;
     }
+
+    /**
+     * Filter a block of raw ADC samples.  The virtual ground offset is
+     * removed as the samples are written directly into the filter state,
+     * where arm_fir_fast_q15 would otherwise copy them; its own copy of the
+     * input is then in place.
+     */
+    q15_t* filter_adc(const q15_t* input)
+    {
+        q15_t* head = filter_state + FILTER_SIZE - 1;
+        arm_offset_q15(const_cast<q15_t*>(input), -audio::virtual_ground, head, BLOCK_SIZE);
+        arm_fir_fast_q15(&instance, head, filter_output, BLOCK_SIZE);
+        return filter_output;
+    }
+};
+
+/**
+ * Decimating q15 FIR filter.  Only every DECIMATION'th output sample is
+ * computed, so the cost is FILTER_SIZE / DECIMATION multiply-accumulates
+ * per input sample, the same as a polyphase decimator.  The taps must
+ * band-limit the signal to below the output Nyquist frequency.
+ */
+template <size_t BLOCK_SIZE, size_t FILTER_SIZE, size_t DECIMATION>
+struct Q15FirDecimator {
+    static_assert(BLOCK_SIZE % DECIMATION == 0, "block size must be a multiple of the decimation factor");
+
+    static constexpr size_t OUTPUT_SIZE = BLOCK_SIZE / DECIMATION;
+
+    const q15_t* filter_taps = nullptr;
+    q15_t filter_state[BLOCK_SIZE + FILTER_SIZE - 1];
+    q15_t filter_output[OUTPUT_SIZE];
+    arm_fir_decimate_instance_q15 instance;
+
+    Q15FirDecimator()
+    {}
+
+    void init(const q15_t* taps)
+    {
+        filter_taps = taps;
+        arm_fir_decimate_init_q15(&instance, FILTER_SIZE, DECIMATION,
+            const_cast<q15_t*>(filter_taps), filter_state, BLOCK_SIZE);
+    }
+
+    q15_t* filter(const q15_t* input)
+    {
+        arm_fir_decimate_fast_q15(&instance, const_cast<q15_t*>(input), filter_output, BLOCK_SIZE);
+        return filter_output;
+    }
+
+    /// Filter a block of raw ADC samples; see Q15FirFilter::filter_adc().
+    q15_t* filter_adc(const q15_t* input)
+    {
+        q15_t* head = filter_state + FILTER_SIZE - 1;
+        arm_offset_q15(const_cast<q15_t*>(input), -audio::virtual_ground, head, BLOCK_SIZE);
+        arm_fir_decimate_fast_q15(&instance, head, filter_output, BLOCK_SIZE);
+        return filter_output;
+    }
 };
 
 }} // mobilinkd::tnc
@@ -2,6 +2,7 @@
 // All rights reserved.
 
 #include "Fsk9600Demodulator.hpp"
+#include "AgcSupervisor.hpp"
 #include "Goertzel.h"
 #include "AudioInput.hpp"
 #include "GPIO.hpp"
@@ -10,42 +11,106 @@
 
 namespace mobilinkd { namespace tnc {
 
-hdlc::IoFrame* Fsk9600Demodulator::operator()(const q15_t* samples)
+/**
+ * Merge a frame from one of the sampling phases into the result.  The
+ * same frame decoded by more than one phase is suppressed by comparing
+ * its FCS with the last frame delivered, as done for the AFSK demodulators.
+ * Only one frame is returned per block.  A frame with a good FCS replaces
+ * a result with a bad one (passed by passall).
+ */
+template <uint32_t BAUD_RATE, uint32_t SAMPLES_PER_SYMBOL>
+hdlc::IoFrame* FskDemodulator<BAUD_RATE, SAMPLES_PER_SYMBOL>::merge(hdlc::IoFrame* frame, hdlc::IoFrame* result)
+{
+    if (!frame) return result;
+
+    if (result and frame->ok() and not result->ok())
+    {
+        hdlc::release(result);
+        last_fcs_ = frame->fcs();
+        last_counter_ = counter_;
+        return frame;
+    }
+
+    if (!result and (frame->fcs() != last_fcs_ or counter_ > last_counter_ + 2))
+    {
+        last_fcs_ = frame->fcs();
+        last_counter_ = counter_;
+        return frame;
+    }
+
+    hdlc::release(frame);
+    return result;
+}
+
+template <uint32_t BAUD_RATE, uint32_t SAMPLES_PER_SYMBOL>
+hdlc::IoFrame* FskDemodulator<BAUD_RATE, SAMPLES_PER_SYMBOL>::operator()(const q15_t* samples)
 {
-    hdlc::IoFrame* result = nullptr;
+    // A bad frame from the last block, if the late phase had not yet
+    // decoded the last bit.
+    hdlc::IoFrame* result = held_;
+    held_ = nullptr;
 
-    auto filtered = demod_filter.filter(const_cast<q15_t* >(samples));
+    auto bandpass = demod_filter.filter_adc(samples);
+    audio::agcSupervisor().measure(bandpass, DEMOD_BLOCK_SIZE);
+    auto filtered = equalizer_(bandpass);
 
-    for (size_t i = 0; i != ADC_BLOCK_SIZE; ++i)
+    ++counter_;
+
+    for (size_t i = 0; i != DEMOD_BLOCK_SIZE; ++i)
     {
         auto sample = filtered[i];
+        auto prev_sample = last_sample_;
 
         bool bit = sample >= 0;
-        auto pll = pll_(bit);
+
+        // The late phase samples one sample after the PLL sample point.
+        if (late_pending_)
+        {
+            result = merge(decoders_[LATE](bit, locked_), result);
+            late_pending_ = false;
+        }
+
+        // With only a few samples per symbol, interpolate the zero crossing
+        // to give the PLL sub-sample timing.
+        float frac = 0.0f;
+        if (bit != (prev_sample >= 0))
+        {
+            frac = float(sample) / float(sample - prev_sample);
+        }
+        last_sample_ = sample;
+
+        auto pll = pll_(bit, frac);
 
         if (pll.sample)
         {
             locked_ = pll.locked;
 
+            // Train the equalizer on the flags between frames while the
+            // PLL is locked.  It is frozen during frames and without DCD.
+            if (locked_ and not decoders_[ON_TIME].hdlc_decoder_.active()
+                and not il2p_decoder_.active())
+            {
+                equalizer_.adapt(i);
+            }
+
             // We will only ever get one frame because there are
             // not enough bits in a block for more than one.
-            if (result) {
-                auto tmp = hdlc_decoder_(nrzi_.decode(lfsr_(bit)), locked_);
-                if (tmp) hdlc::release(tmp);
-            } else {
-                result = hdlc_decoder_(nrzi_.decode(lfsr_(bit)), locked_);
+            auto frame = decoders_[ON_TIME](bit, locked_);
 #ifdef KISS_LOGGING
-                if (result) {
-                    INFO("samples = %ld, mean = %d, dev = %d",
-                        snr_.samples, int(snr_.mean), int(snr_.stdev()));
-                    INFO("SNR = %dmB", int(snr_.SNR() * 100.0f));
-                    snr_.reset();
-                }
-#endif
+            if (frame) {
+                INFO("samples = %ld, mean = %d, dev = %d",
+                    snr_.samples, int(snr_.mean), int(snr_.stdev()));
+                INFO("SNR = %dmB", int(snr_.SNR() * 100.0f));
+                snr_.reset();
             }
+#endif
+            result = merge(frame, result);
+
+            result = merge(decoders_[EARLY](prev_sample >= 0, locked_), result);
+            late_pending_ = true;
 
 #ifdef KISS_LOGGING
-            if (hdlc_decoder_.active())
+            if (decoders_[ON_TIME].hdlc_decoder_.active())
             {
                 if (!decoding_)
                 {
@@ -60,6 +125,16 @@ hdlc::IoFrame* Fsk9600Demodulator::operator()(const q15_t* samples)
         }
 
     }
+
+    // Give the late phase a chance to replace a bad frame ending on the
+    // last sample of the block.
+    if (result and late_pending_ and not result->ok())
+    {
+        held_ = result;
+        result = nullptr;
+    }
+
+    twist_(samples, locked_, result != nullptr);
     return result;
 }
 
@@ -67,20 +142,24 @@ hdlc::IoFrame* Fsk9600Demodulator::operator()(const q15_t* samples)
  * Return twist as a the difference in dB between mark and space.  The
  * expected values are about 0dB for discriminator output and about 5.5dB
  * for de-emphasized audio.
+ *
+ * The tones are measured at 1/80 and 1/2 of the baud rate (120Hz and
+ * 4800Hz at 9600 baud).
  */
-float Fsk9600Demodulator::readTwist()
+template <uint32_t BAUD_RATE, uint32_t SAMPLES_PER_SYMBOL>
+float FskDemodulator<BAUD_RATE, SAMPLES_PER_SYMBOL>::readTwist()
 {
-    TNC_DEBUG("enter Fsk9600Demodulator::readTwist");
+    TNC_DEBUG("enter FskDemodulator::readTwist");
 
     float g120 = 0.0f;
     float g4800 = 0.0f;
 
-    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf120(120.0, 0);
-    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf4800(4800.0, 0);
+    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf120(BAUD_RATE / 80.0, 0);
+    GoertzelFilter<ADC_BLOCK_SIZE, SAMPLE_RATE> gf4800(BAUD_RATE / 2.0, 0);
 
-    const uint32_t AVG_SAMPLES = 160;
+    const uint32_t AVG_SAMPLES = 160 * BAUD_RATE / 9600;
 
-    startADC(416, ADC_BLOCK_SIZE);
+    startADC(ADC_TIMER_PERIOD - 1, ADC_BLOCK_SIZE);
 
     for (uint32_t i = 0; i != AVG_SAMPLES; ++i)
     {
@@ -91,13 +170,10 @@ float Fsk9600Demodulator::readTwist()
             if (evt.status != osEventMessage)
                 continue;
 
-            auto block = (audio::adc_pool_type::chunk_type*) evt.value.p;
-            uint16_t* data = (uint16_t*) block->buffer;
+            uint16_t* data = audio::adc_slot(evt.value.v);
             gf120(data, ADC_BLOCK_SIZE);
             gf4800(data, ADC_BLOCK_SIZE);
 
-            audio::adcPool.deallocate(block);
-
             count += ADC_BLOCK_SIZE;
         }
 
@@ -115,92 +191,18 @@ float Fsk9600Demodulator::readTwist()
 
     auto result = g120 - g4800;
 
-    INFO("9600 Twist = %d / 100 (%d - %d)", int(result * 100), int(g120 * 100),
-        int(g4800 * 100));
+    INFO("%lu Twist = %d / 100 (%d - %d)", BAUD_RATE, int(result * 100),
+        int(g120 * 100), int(g4800 * 100));
 
-    TNC_DEBUG("exit Fsk9600Demodulator::readTwist");
+    TNC_DEBUG("exit FskDemodulator::readTwist");
     return result;
 }
 
-uint32_t Fsk9600Demodulator::readBatteryLevel()
-{
-#if defined(STM32L4P5xx) || defined(STM32L4Q5xx)
-    return read_battery_level();
-#elif !(defined(NUCLEOTNC))
-    TNC_DEBUG("enter Fsk9600Demodulator::readBatteryLevel");
-
-    ADC_ChannelConfTypeDef sConfig;
-
-    sConfig.Channel = ADC_CHANNEL_VREFINT;
-    sConfig.Rank = ADC_REGULAR_RANK_1;
-    sConfig.SingleDiff = ADC_SINGLE_ENDED;
-    sConfig.SamplingTime = ADC_SAMPLETIME_247CYCLES_5;
-    sConfig.OffsetNumber = ADC_OFFSET_NONE;
-    sConfig.Offset = 0;
-    if (HAL_ADC_ConfigChannel(&BATTERY_ADC_HANDLE, &sConfig) != HAL_OK)
-        CxxErrorHandler();
-
-    htim6.Init.Period = 48000;
-    if (HAL_TIM_Base_Init(&htim6) != HAL_OK) CxxErrorHandler();
-
-    if (HAL_TIM_Base_Start(&htim6) != HAL_OK)
-        CxxErrorHandler();
-
-    if (HAL_ADC_Start(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
-    if (HAL_ADC_PollForConversion(&BATTERY_ADC_HANDLE, 3) != HAL_OK) CxxErrorHandler();
-    auto vrefint = HAL_ADC_GetValue(&BATTERY_ADC_HANDLE);
-    if (HAL_ADC_Stop(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
-
-    // Disable battery charging while measuring battery voltage.
-    auto usb_ce = gpio::USB_CE::get();
-    gpio::USB_CE::on();
-
-    gpio::BAT_DIVIDER::off();
-    DELAY(1);
-
-    sConfig.Channel = BATTERY_ADC_CHANNEL;
-    if (HAL_ADC_ConfigChannel(&BATTERY_ADC_HANDLE, &sConfig) != HAL_OK)
-        CxxErrorHandler();
-
-    uint32_t vbat = 0;
-    if (HAL_ADC_Start(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
-    for (size_t i = 0; i != 8; ++i)
-    {
-        if (HAL_ADC_PollForConversion(&BATTERY_ADC_HANDLE, 1) != HAL_OK) CxxErrorHandler();
-        vbat += HAL_ADC_GetValue(&BATTERY_ADC_HANDLE);
-    }
-
-    vbat /= 8;
-
-    if (HAL_ADC_Stop(&BATTERY_ADC_HANDLE) != HAL_OK) CxxErrorHandler();
-    if (HAL_TIM_Base_Stop(&htim6) != HAL_OK)
-        CxxErrorHandler();
-
-    gpio::BAT_DIVIDER::on();
-
-    // Restore battery charging state.
-    if (!usb_ce) gpio::USB_CE::off();
-
-    INFO("Vref = %lu", vrefint);
-    INFO("Vbat = %lu (raw)", vbat);
-
-    // Order of operations is important to avoid underflow.
-    vbat *= 6600;
-    vbat /= (VREF + 1);
-
-    uint32_t vref = ((vrefint * 3300) + (VREF / 2)) / VREF;
-
-    INFO("Vref = %lumV", vref)
-    INFO("Vbat = %lumV", vbat);
-
-    TNC_DEBUG("exit Fsk9600Demodulator::readBatteryLevel");
-    return vbat;
-#else
-    return 0;
-#endif
-}
+template struct FskDemodulator<4800>;
+template struct FskDemodulator<9600>;
+template struct FskDemodulator<19200>;
 
-const Fsk9600Demodulator::bpf_bank_type Fsk9600Demodulator::bpf_bank = {{
+const FskDemodulatorBase::bpf_bank_type FskDemodulatorBase::bpf_bank = {{
     // -3dB, gain = 0.251188643150958, actual = -1.67dB
     {{
             0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
@@ -7,62 +7,129 @@
 #include "AudioLevel.hpp"
 #include "AudioInput.hpp"
 #include "DigitalPLL.hpp"
-#include "NRZI.hpp"
+#include "FskClock.hpp"
+#include "Equalizer.hpp"
+#include "Fsk9600PhaseDecoder.hpp"
 #include "HdlcDecoder.hpp"
+#include "Il2p.hpp"
 #include "KissHardware.hpp"
 #include "StandardDeviation.hpp"
 #include "TimerAdjust.h"
+#include "TwistEstimator.hpp"
 
 namespace mobilinkd { namespace tnc {
 
-struct Descrambler
-{
-    uint32_t state{0};
-
-    bool operator()(bool bit)
-    {
-        bool result = (bit ^ (state >> 16) ^ (state >> 11)) & 1;
-        state = ((state << 1) | (bit & 1)) & 0x1FFFF;
-        return result;
-    }
-};
-
-struct Fsk9600Demodulator : IDemodulator
+/**
+ * Parts of the FSK demodulator that do not depend on the baud rate.
+ *
+ * The band filters are designed for 20 ADC samples per symbol.  Their
+ * response is relative to the baud rate, so one bank serves every rate
+ * as long as the ADC runs at 20 samples per symbol.
+ */
+struct FskDemodulatorBase : IDemodulator
 {
     static constexpr size_t FILTER_TAP_NUM = 92;
+    static constexpr uint32_t BPF_SAMPLES_PER_SYMBOL = FSK_ADC_SAMPLES_PER_SYMBOL;
     static constexpr uint32_t ADC_BLOCK_SIZE = 384;
     static_assert(audio::ADC_BUFFER_SIZE >= ADC_BLOCK_SIZE);
 
-    static constexpr uint32_t SAMPLE_RATE = 192000;
     static constexpr uint16_t VREF = 16383;
 
     using bpf_coeffs_type = std::array<int16_t, FILTER_TAP_NUM>;
     using bpf_bank_type = std::array<bpf_coeffs_type, 13>;
-    using audio_filter_t = Q15FirFilter<ADC_BLOCK_SIZE, FILTER_TAP_NUM>;
 
     static const bpf_bank_type bpf_bank;
 
+    uint32_t readBatteryLevel() override
+    {
+        return readBattery();
+    }
+
+    size_t size() const override
+    {
+        return ADC_BLOCK_SIZE;
+    }
+};
+
+/**
+ * G3RUH-compatible FSK demodulator.
+ *
+ * @tparam BAUD_RATE is the symbol rate.
+ * @tparam SAMPLES_PER_SYMBOL is the sample rate, in samples per symbol,
+ *  after the band filter decimates the ADC samples.  It must be 5, 10
+ *  or 20.
+ *
+ * The ADC sample rate, timer period, decimation, equalizer length and PLL
+ * rates are all derived from these at compile time.
+ */
+template <uint32_t BAUD_RATE, uint32_t SAMPLES_PER_SYMBOL = 5>
+struct FskDemodulator : FskDemodulatorBase
+{
+    static constexpr uint32_t SAMPLE_RATE = BAUD_RATE * BPF_SAMPLES_PER_SYMBOL;
+
+    // Shared with the modulator; 48MHz for 19200 baud.
+    static constexpr uint32_t SYSCLK = fsk_system_clock(BAUD_RATE);
+    static_assert(SYSCLK % SAMPLE_RATE == 0, "No system clock for this baud rate");
+    static constexpr uint32_t ADC_TIMER_PERIOD = SYSCLK / SAMPLE_RATE;
+
+    // The band filter decimates to SAMPLES_PER_SYMBOL before the PLL and
+    // slicer.  The bpf_bank filter stop bands start at 5/4 of the baud
+    // rate, below the Nyquist rate at 5 samples per symbol.
+    static_assert(BPF_SAMPLES_PER_SYMBOL % SAMPLES_PER_SYMBOL == 0);
+    static constexpr uint32_t DECIMATION = BPF_SAMPLES_PER_SYMBOL / SAMPLES_PER_SYMBOL;
+    static_assert(DECIMATION <= 4, "Too few samples per symbol for the band filter");
+    static_assert(ADC_BLOCK_SIZE % DECIMATION == 0);
+    static constexpr uint32_t DEMOD_SAMPLE_RATE = SAMPLE_RATE / DECIMATION;
+    static constexpr uint32_t DEMOD_BLOCK_SIZE = ADC_BLOCK_SIZE / DECIMATION;
+
+    using audio_filter_t = Q15FirDecimator<ADC_BLOCK_SIZE, FILTER_TAP_NUM, DECIMATION>;
+
+    // The equalizer spans 2 symbols.
+    static constexpr size_t EQUALIZER_TAPS = SAMPLES_PER_SYMBOL * 2 + 1;
+    using equalizer_t = SignLmsEqualizer<DEMOD_BLOCK_SIZE, EQUALIZER_TAPS>;
+
+    // The bits are decoded at three sampling phases: at the PLL sample
+    // point, and one sample early and late, recovering frames lost to
+    // timing jitter.
+    enum Phase { ON_TIME, EARLY, LATE, SAMPLING_PHASES };
+
     audio_filter_t demod_filter;
-    BaseDigitalPLL<float> pll_{192000,9600};
+    equalizer_t equalizer_;
+    BaseDigitalPLL<float> pll_{DEMOD_SAMPLE_RATE, BAUD_RATE};
+    q15_t last_sample_{0};
     bool locked_{false};
-    Descrambler lfsr_;
-    libafsk::NRZI nrzi_;
-    hdlc::NewDecoder hdlc_decoder_;
+    bool late_pending_{false};
+    std::array<Fsk9600PhaseDecoder, SAMPLING_PHASES> decoders_;
+    il2p::Decoder il2p_decoder_;    // IL2P is decoded only at the on-time phase.
+    hdlc::IoFrame* held_{nullptr};  // Bad-FCS frame waiting for the late phase.
+    uint16_t last_fcs_{0};
+    uint32_t last_counter_{0};
+    uint32_t counter_{0};
     StandardDeviation snr_;
     bool decoding_{false};
-    TimerAdjust<375, 192000, 7680> adcTimerAdjust{&htim6};
+    // Twist is measured at 1/16 and 1/2 of the baud rate.  (The 1/80 used
+    // by readTwist() falls in the DC bin of a demodulator block.)
+    TwistEstimator<ADC_BLOCK_SIZE, SAMPLE_RATE> twist_{BAUD_RATE / 16.0f, BAUD_RATE / 2.0f};
 
-    virtual ~Fsk9600Demodulator() {}
+    virtual ~FskDemodulator() {}
     size_t get_adc_exponent() const override { return 2; }
 
     void start() override
     {
-        SysClock72();
+        if constexpr (SYSCLK == 72000000) SysClock72();
+        else SysClock48();
 
         auto const& bpf_coeffs = bpf_bank[kiss::settings().rx_twist + 3];
         const q15_t* bpf = bpf_coeffs.data();
         demod_filter.init(bpf);
         passall(kiss::settings().options & KISS_OPTION_PASSALL);
+        last_fcs_ = 0;
+        last_counter_ = 0;
+        counter_ = 0;
+        late_pending_ = false;
+
+        il2p_decoder_.reset();
+        decoders_[ON_TIME].il2p_decoder_ = kiss::settings().il2p() ? &il2p_decoder_ : nullptr;
 
         ADC_ChannelConfTypeDef sConfig;
 
@@ -75,40 +142,72 @@ struct Fsk9600Demodulator : IDemodulator
         if (HAL_ADC_ConfigChannel(&DEMODULATOR_ADC_HANDLE, &sConfig) != HAL_OK)
             CxxErrorHandler();
 
-        audio::virtual_ground = 8192;
-
         mobilinkd::adcTimerAdjust = nullptr;
 
-        startADC(374, ADC_BLOCK_SIZE, false);
+        startADC(ADC_TIMER_PERIOD - 1, ADC_BLOCK_SIZE, false,
+            audio::adc_oversampling(audio::adc_clock(), SAMPLE_RATE, sConfig.SamplingTime));
     }
 
     void stop() override
     {
         stopADC();
         mobilinkd::adcTimerAdjust = nullptr;
+        release_held();
         locked_ = false;
     }
 
-    float readTwist() override;
+    void reset() override
+    {
+        pll_.reset();
+        for (auto& decoder : decoders_) decoder.reset();
+        il2p_decoder_.reset();
+        release_held();
+        late_pending_ = false;
+        locked_ = false;
+    }
 
-    uint32_t readBatteryLevel() override;
+    void release_held()
+    {
+        if (held_) hdlc::release(held_);
+        held_ = nullptr;
+    }
+
+    float readTwist() override;
 
     hdlc::IoFrame* operator()(const q15_t* samples) override;
 
+    hdlc::IoFrame* merge(hdlc::IoFrame* frame, hdlc::IoFrame* result);
+
     bool locked() const override
     {
         return locked_;
     }
 
-    size_t size() const override
+    /**
+     * Only the on-time decoder passes frames with bad CRCs.  The other
+     * phases exist only to recover valid frames, and a valid frame from
+     * any phase replaces a bad one.
+     */
+    void passall(bool enabled) override
     {
-        return ADC_BLOCK_SIZE;
+        decoders_[ON_TIME].hdlc_decoder_.setPassall(enabled);
     }
 
-    void passall(bool enabled) override
+    size_t readEqualizer(int16_t* taps, size_t size) const override
     {
-        hdlc_decoder_.setPassall(enabled);
+        auto n = std::min(size, EQUALIZER_TAPS);
+        std::copy_n(equalizer_.taps().begin(), n, taps);
+        return n;
     }
 };
 
+// The template members are defined and instantiated in Fsk9600Demodulator.cpp.
+extern template struct FskDemodulator<4800>;
+extern template struct FskDemodulator<9600>;
+extern template struct FskDemodulator<19200>;
+
+using Fsk4800Demodulator = FskDemodulator<4800>;
+using Fsk9600Demodulator = FskDemodulator<9600>;
+using Fsk19200Demodulator = FskDemodulator<19200>;
+
 }} // mobilinkd::tnc
@@ -6,7 +6,8 @@
 
 namespace mobilinkd { namespace tnc {
 
-void Fsk9600Modulator::init(const kiss::Hardware& hw)
+template <uint32_t BAUD_RATE, uint8_t UPSAMPLE>
+void FskModulator<BAUD_RATE, UPSAMPLE>::init(const kiss::Hardware& hw)
 {
     for (auto& x : buffer_) x = 2048;
 
@@ -15,9 +16,10 @@ void Fsk9600Modulator::init(const kiss::Hardware& hw)
 
     state = State::STOPPED;
 
-    // Configure 72MHz clock for 96ksps.
-    SysClock72();
-    __HAL_TIM_SET_AUTORELOAD(&htim7, 749);
+    // Configure the clock for BAUD_RATE * UPSAMPLE sps.
+    if constexpr (SYSCLK == 72000000) SysClock72();
+    else SysClock48();
+    __HAL_TIM_SET_AUTORELOAD(&htim7, DAC_TIMER_PERIOD - 1);
     __HAL_TIM_SET_PRESCALER(&htim7, 0);
 
     mobilinkd::dacTimerAdjust = dacTimerAdjust;
@@ -36,24 +38,69 @@ void Fsk9600Modulator::init(const kiss::Hardware& hw)
 
     if (HAL_DAC_SetValue(&hdac1, DAC_CHANNEL_1, DAC_ALIGN_12B_R, 2048) != HAL_OK) CxxErrorHandler();
     if (HAL_DAC_Start(&hdac1, DAC_CHANNEL_1) != HAL_OK) CxxErrorHandler();
-    INFO("Fsk9600Modulator::init");
+    INFO("FskModulator::init %lu baud", BAUD_RATE);
 }
 
-void Fsk9600Modulator::fill(uint16_t* buffer, uint8_t bits)
+/**
+ * Compute the samples for one symbol period directly from the Gaussian
+ * filter.  This matches arm_fir_interpolate_f32 evaluated for a single
+ * input symbol, with symbols of +/-UPSAMPLE (or 0 when not valid).  Bit
+ * i of @p history is the symbol i symbols ago.
+ */
+template <uint32_t BAUD_RATE, uint8_t UPSAMPLE>
+void FskModulator<BAUD_RATE, UPSAMPLE>::compute_symbol(uint16_t* buffer, uint8_t history, uint8_t valid,
+    uint16_t volume)
 {
-    HAL_IWDG_Refresh(&hiwdg);
-
-    for (uint8_t i = 0; i != BLOCKSIZE; ++i) {
-        symbols[i] = (bits & 0x80 ? UPSAMPLE : -UPSAMPLE);
-        bits <<= 1;
+    for (uint8_t phase = 0; phase != UPSAMPLE; ++phase)
+    {
+        float sample = 0.0f;
+        for (uint8_t i = 0; i != SPAN; ++i)
+        {
+            if (!(valid & (1 << i))) continue;
+            float symbol = (history & (1 << i)) ? UPSAMPLE : -UPSAMPLE;
+            sample += symbol * gaussian[(SPAN - i) * UPSAMPLE - 1 - phase];
+        }
+        buffer[phase] = adjust_level(sample, volume);
     }
+}
 
-    arm_fir_interpolate_f32(&fir_interpolator, symbols.data(), tmp, BLOCKSIZE);
+/**
+ * Build the pulse and contribution tables for @p volume.  The tables must
+ * not be the ones the DAC interrupt is using.
+ */
+template <uint32_t BAUD_RATE, uint8_t UPSAMPLE>
+void FskModulator<BAUD_RATE, UPSAMPLE>::update_pulse_table(Tables& tables, uint16_t volume)
+{
+    for (uint8_t history = 0; history != tables.pulse.size(); ++history)
+    {
+        compute_symbol(tables.pulse[history].data(), history, SPAN_MASK, volume);
+    }
 
-    for (uint8_t i = 0; i != TRANSFER_LEN; ++i)
+    // The same scaling as adjust_level(), without the offset.
+    const float scale = float(UPSAMPLE) * volume / 10 * (1 << CONTRIBUTION_FRAC_BITS);
+    for (uint8_t i = 0; i != SPAN; ++i)
     {
-        buffer[i] = adjust_level(tmp[i]);
+        for (uint8_t phase = 0; phase != UPSAMPLE; ++phase)
+        {
+            tables.contribution[i][phase] =
+                std::lround(gaussian[(SPAN - i) * UPSAMPLE - 1 - phase] * scale);
+        }
     }
 }
 
+template <uint32_t BAUD_RATE, uint8_t UPSAMPLE>
+void FskModulator<BAUD_RATE, UPSAMPLE>::fill(uint16_t* buffer, uint8_t bits)
+{
+    HAL_IWDG_Refresh(&hiwdg);
+
+    for (uint8_t i = 0; i != BLOCKSIZE; ++i) {
+        fill_symbol(buffer + i * UPSAMPLE, bits & 0x80, true);
+        bits <<= 1;
+    }
+}
+
+template struct FskModulator<4800>;
+template struct FskModulator<9600>;
+template struct FskModulator<19200>;
+
 }} // mobilinkd::tnc
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "AudioInput.hpp"
+#include "FskClock.hpp"
 #include "Modulator.hpp"
 #include "TimerAdjust.h"
 
@@ -12,6 +13,7 @@
 
 #include <array>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 
@@ -76,12 +78,39 @@ struct Scrambler
         state = ((state << 1) | result) & 0x1FFFF;
         return result;
     }
+
+    /**
+     * Scramble the low @p count bits of @p bits, MSB first, in one step.
+     * The shortest feedback path is 12 bits, so up to 12 output bits
+     * depend only on the existing state.
+     */
+    uint32_t operator()(uint32_t bits, uint8_t count)
+    {
+        uint32_t shifted = state << count;
+        uint32_t result = (bits ^ (shifted >> 12) ^ (shifted >> 17)) & ((1u << count) - 1);
+        state = (shifted | result) & 0x1FFFF;
+        return result;
+    }
 };
 
-struct Fsk9600Modulator : Modulator
+/**
+ * G3RUH-compatible FSK modulator.
+ *
+ * @tparam BAUD_RATE is the symbol rate.
+ * @tparam UPSAMPLE is the number of DAC samples per symbol.
+ *
+ * The DAC sample rate, timer period and Gaussian pulse shape are derived
+ * from these at compile time.
+ */
+template <uint32_t BAUD_RATE, uint8_t UPSAMPLE = FSK_DAC_SAMPLES_PER_SYMBOL>
+struct FskModulator : Modulator
 {
+    static constexpr uint32_t SAMPLE_RATE = BAUD_RATE * UPSAMPLE;
+    // The same clock as the demodulator; see fsk_system_clock().
+    static constexpr uint32_t SYSCLK = fsk_system_clock(BAUD_RATE);
+    static_assert(SYSCLK % SAMPLE_RATE == 0, "No DAC timer period for this baud rate");
+    static constexpr uint32_t DAC_TIMER_PERIOD = SYSCLK / SAMPLE_RATE;
 
-    static constexpr uint8_t UPSAMPLE = 10;
     static constexpr uint8_t BLOCKSIZE = 8;
     static constexpr uint8_t NSYMS = 5;
     static constexpr uint8_t TRANSFER_LEN = BLOCKSIZE * UPSAMPLE;
@@ -89,18 +118,51 @@ struct Fsk9600Modulator : Modulator
 
     static constexpr auto gaussian = gaussian_filter<1, UPSAMPLE, NSYMS>(0.5);
 
-    static constexpr uint32_t STATE_SIZE = (gaussian.size() / UPSAMPLE) + BLOCKSIZE - 1;
-    // Number of bits to flush the FIR filter.
-    static constexpr uint8_t FLUSH_LEN = 1;
+    // Number of symbols that contribute to each output sample.
+    static constexpr uint8_t SPAN = gaussian.size() / UPSAMPLE;
+    static constexpr uint8_t SPAN_MASK = (1 << SPAN) - 1;
     static constexpr uint16_t VREF = 4095;
 
     enum class Level { ZERO, HIGH, LOW };
     enum class State { STOPPED, STARTING, RUNNING, STOPPING };
 
-    arm_fir_interpolate_instance_f32 fir_interpolator;
-    std::array<float, STATE_SIZE> fir_state;
-    std::array<float, BLOCKSIZE> symbols;
-    float tmp[TRANSFER_LEN];
+    /*
+     * The output for one symbol period is a function of the last SPAN
+     * symbols.  The table holds the DAC samples, level-adjusted, for every
+     * SPAN-bit history.
+     *
+     * At the start and end of a transmission some of the history is zero
+     * symbols.  Those samples are summed from the contribution table,
+     * which holds the level-adjusted contribution of a high symbol at each
+     * position, in DAC steps with CONTRIBUTION_FRAC_BITS of fraction.  A
+     * low symbol contributes the negative and a zero symbol nothing.  A
+     * full (history, valid) table would be 4096 entries.
+     *
+     * The tables are read from the DAC DMA interrupt, so there are two
+     * sets.  set_gain() builds the spare set in task context and posts it
+     * in pending_tables_.  The interrupt switches active_tables_ to it at
+     * the start of the next half block, so a level change takes effect
+     * while transmitting (e.g. during a calibration tone).
+     */
+    static constexpr int CONTRIBUTION_FRAC_BITS = 8;
+    using pulse_table_type = std::array<std::array<uint16_t, UPSAMPLE>, 1 << SPAN>;
+    using contribution_table_type = std::array<std::array<int32_t, UPSAMPLE>, SPAN>;
+
+    struct Tables
+    {
+        pulse_table_type pulse;
+        contribution_table_type contribution;
+    };
+
+    std::array<Tables, 2> tables_;
+    std::atomic<Tables*> active_tables_{&tables_[0]};   // Changed only by swap_tables().
+    std::atomic<Tables*> pending_tables_{nullptr};      // Written only by set_gain().
+
+    // Symbol history, newest in bit 0 (1 = high).  A symbol is only
+    // valid (non-zero) if its bit in history_valid_ is set.  Zero symbols
+    // occur only at the start and end of a transmission.
+    uint8_t history_ = 0;
+    uint8_t history_valid_ = 0;
 
     osMessageQId dacOutputQueueHandle_{0};
     PTT* ptt_{nullptr};
@@ -112,17 +174,16 @@ struct Fsk9600Modulator : Modulator
     uint8_t input_buffer_;
     int8_t input_index_ = 0;
     int8_t stop_count_ = 0;
-    TimerAdjust<750, 96000, 7680> dacTimerAdjust{&htim7};
+    // The MSI clock in PLL mode is 107ppm fast (SYSCLK / 9375).
+    TimerAdjust<DAC_TIMER_PERIOD, SAMPLE_RATE, SYSCLK / 9375> dacTimerAdjust{&htim7};
 
-    Fsk9600Modulator(osMessageQId queue, PTT* ptt)
+    FskModulator(osMessageQId queue, PTT* ptt)
     : dacOutputQueueHandle_(queue), ptt_(ptt)
     {
-        arm_fir_interpolate_init_f32(
-            &fir_interpolator, UPSAMPLE, gaussian.size(),
-            (float32_t*) gaussian.data(), fir_state.data(), BLOCKSIZE);
+        update_pulse_table(tables_[0], volume_);
     }
 
-    ~Fsk9600Modulator() override {}
+    ~FskModulator() override {}
 
     void init(const kiss::Hardware& hw) override;
 
@@ -133,7 +194,7 @@ struct Fsk9600Modulator : Modulator
         HAL_TIM_Base_Stop(&htim7);
         ptt_->off();
         mobilinkd::dacTimerAdjust = nullptr;
-        INFO("Fsk9600Modulator::deinit");
+        INFO("FskModulator::deinit");
     }
 
     void set_gain(uint16_t level) override
@@ -141,6 +202,17 @@ struct Fsk9600Modulator : Modulator
         auto v = std::max<uint16_t>(256, level);
         v = std::min<uint16_t>(4096, v);
         volume_ = v;
+
+        // Reclaim the spare set if the interrupt has not picked it up yet.
+        // Otherwise the spare is whichever set is not active; with nothing
+        // pending the interrupt will not change active_tables_.
+        auto spare = pending_tables_.exchange(nullptr);
+        if (spare == nullptr)
+        {
+            spare = (active_tables_.load() == &tables_[0]) ? &tables_[1] : &tables_[0];
+        }
+        update_pulse_table(*spare, v);
+        pending_tables_.store(spare);
     }
 
     void set_ptt(PTT* ptt) override
@@ -158,10 +230,9 @@ struct Fsk9600Modulator : Modulator
 
     void send(uint8_t bit) override
     {
-        auto scrambled = lfsr(bit);
-
+        // Bits are scrambled a block at a time when the block is queued.
         input_buffer_ <<= 1;
-        input_buffer_ |= scrambled;
+        input_buffer_ |= (bit & 1);
 
         switch (state)
         {
@@ -172,6 +243,10 @@ struct Fsk9600Modulator : Modulator
             HAL_RCCEx_DisableLSCO();
 #endif
             osMessagePut(audioInputQueueHandle, tnc::audio::IDLE, osWaitForever);
+            // The DAC interrupt is idle only once fully stopped.
+            if (state == State::STOPPED) swap_tables();
+            history_ = 0;
+            history_valid_ = 0;
             fill_empty(buffer_.data());
             fill_empty(buffer_.data() + TRANSFER_LEN);
             ptt_->on();
@@ -181,7 +256,7 @@ struct Fsk9600Modulator : Modulator
         case State::STARTING:
             input_index_ += 1;
             if (input_index_ == BLOCKSIZE) {
-                osMessagePut(dacOutputQueueHandle_, input_buffer_, osWaitForever);
+                osMessagePut(dacOutputQueueHandle_, lfsr(input_buffer_, BLOCKSIZE), osWaitForever);
                 state = State::RUNNING;
                 input_index_ = 0;
             }
@@ -189,7 +264,7 @@ struct Fsk9600Modulator : Modulator
        case State::RUNNING:
            input_index_ += 1;
             if (input_index_ == BLOCKSIZE) {
-                osMessagePut(dacOutputQueueHandle_, input_buffer_, osWaitForever);
+                osMessagePut(dacOutputQueueHandle_, lfsr(input_buffer_, BLOCKSIZE), osWaitForever);
                 input_index_ = 0;
             }
             break;
@@ -202,21 +277,25 @@ struct Fsk9600Modulator : Modulator
 
     void fill_first(uint8_t bits) override
     {
+        swap_tables();
         fill(buffer_.data(), bits);
     }
 
     void fill_last(uint8_t bits) override
     {
+        swap_tables();
         fill(buffer_.data() + TRANSFER_LEN, bits);
     }
 
     void empty_first() override
     {
+        swap_tables();
         empty(buffer_.data());
     }
 
     void empty_last() override
     {
+        swap_tables();
         empty(buffer_.data() + TRANSFER_LEN);
     }
 
@@ -231,34 +310,22 @@ struct Fsk9600Modulator : Modulator
         case State::RUNNING:
             // Flush the input buffer. Because of bit-stuffing, the transmit
             // data is not byte-aligned.
-            input_buffer_ <<= (8 - input_index_);
+            input_buffer_ = lfsr(input_buffer_, input_index_) << (8 - input_index_);
 
             for (uint8_t i = 0; i != BLOCKSIZE; ++i) {
-                symbols[i] = i < input_index_ ? (input_buffer_ & 0x80 ? UPSAMPLE : -UPSAMPLE) : 0.0;
+                fill_symbol(buffer + i * UPSAMPLE, input_buffer_ & 0x80, i < input_index_);
                 input_buffer_ <<= 1;
             }
 
-            arm_fir_interpolate_f32(&fir_interpolator, symbols.data(), tmp, BLOCKSIZE);
-
-            for (uint8_t i = 0; i != TRANSFER_LEN; ++i)
-            {
-                buffer[i] = adjust_level(tmp[i]);
-            }
-
             input_index_ = 0;
             stop_count_ = 0;
 
             state = State::STOPPING;
             break;
         case State::STOPPING:
-            // Flush the FIR filter.
-            symbols.fill(0.0f);
-
-            arm_fir_interpolate_f32(&fir_interpolator, symbols.data(), tmp, BLOCKSIZE);
-
-            for (uint8_t i = 0; i != TRANSFER_LEN; ++i)
-            {
-                buffer[i] = adjust_level(tmp[i]);
+            // Flush the pulse-shaping filter.
+            for (uint8_t i = 0; i != BLOCKSIZE; ++i) {
+                fill_symbol(buffer + i * UPSAMPLE, false, false);
             }
 
             if (++stop_count_ == 5)
@@ -285,14 +352,14 @@ struct Fsk9600Modulator : Modulator
 #if defined(KISS_LOGGING) && defined(HAVE_LSCO)
             HAL_RCCEx_EnableLSCO(RCC_LSCOSOURCE_LSE);
 #endif
-        INFO("Fsk9600Modulator::abort");
+        INFO("FskModulator::abort");
         // Drain the queue.
         while (osMessageGet(dacOutputQueueHandle_, 0).status == osEventMessage);
     }
 
     float bits_per_ms() const override
     {
-        return 9.6f;
+        return BAUD_RATE / 1000.0f;
     }
 
 private:
@@ -322,9 +389,9 @@ private:
             DAC_ALIGN_12B_R);
     }
 
-    uint16_t adjust_level(float sample) const
+    static uint16_t adjust_level(float sample, uint16_t volume)
     {
-        sample *= volume_;
+        sample *= volume;
         sample /= 10;
         sample += 2048;
         if (sample > 4095) sample = 4095;
@@ -334,6 +401,51 @@ private:
 
     void fill(uint16_t* buffer, uint8_t bits);
 
+    static void update_pulse_table(Tables& tables, uint16_t volume);
+
+    static void compute_symbol(uint16_t* buffer, uint8_t history, uint8_t valid, uint16_t volume);
+
+    /**
+     * Switch to the tables posted by set_gain(), if any.  Called at the
+     * start of each half block from the DAC interrupt, and from send()
+     * when the interrupt is idle.
+     */
+    void swap_tables()
+    {
+        auto pending = pending_tables_.exchange(nullptr);
+        if (pending != nullptr) active_tables_.store(pending);
+    }
+
+    /**
+     * Shift one symbol into the history and write its UPSAMPLE samples.
+     * Uses the pulse table unless some of the history is zero symbols, in
+     * which case the samples are summed from the contribution table.
+     */
+    void fill_symbol(uint16_t* buffer, bool bit, bool valid)
+    {
+        history_ = ((history_ << 1) | bit) & SPAN_MASK;
+        history_valid_ = ((history_valid_ << 1) | valid) & SPAN_MASK;
+
+        const auto& tables = *active_tables_.load(std::memory_order_relaxed);
+
+        if (__builtin_expect(history_valid_ == SPAN_MASK, 1)) {
+            std::copy(tables.pulse[history_].begin(), tables.pulse[history_].end(), buffer);
+            return;
+        }
+
+        for (uint8_t phase = 0; phase != UPSAMPLE; ++phase)
+        {
+            int32_t sample = 2048 << CONTRIBUTION_FRAC_BITS;
+            for (uint8_t i = 0; i != SPAN; ++i)
+            {
+                if (!(history_valid_ & (1 << i))) continue;
+                auto c = tables.contribution[i][phase];
+                sample += (history_ & (1 << i)) ? c : -c;
+            }
+            buffer[phase] = std::clamp<int32_t>(sample >> CONTRIBUTION_FRAC_BITS, 0, VREF);
+        }
+    }
+
     [[gnu::noinline]]
     void fill_empty(uint16_t* buffer)
     {
@@ -345,4 +457,13 @@ private:
 
 };
 
+// The template members are defined and instantiated in Fsk9600Modulator.cpp.
+extern template struct FskModulator<4800>;
+extern template struct FskModulator<9600>;
+extern template struct FskModulator<19200>;
+
+using Fsk4800Modulator = FskModulator<4800>;
+using Fsk9600Modulator = FskModulator<9600>;
+using Fsk19200Modulator = FskModulator<19200>;
+
 }} // mobilinkd::tnc
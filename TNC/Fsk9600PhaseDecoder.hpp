@@ -0,0 +1,142 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "HdlcDecoder.hpp"
+#include "Il2p.hpp"
+
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * G3RUH descrambler (x^17 + x^12 + 1) fused with the NRZI decoder.  The
+ * received bits are kept in a 64-bit history, newest in bit 0.  Each
+ * descrambled bit is the received bit XORed with the bits received 12 and
+ * 17 bits earlier; it is then NRZI decoded: 1 if it equals the previous
+ * descrambled bit, 0 if it differs.  Up to 32 bits can be decoded at once.
+ */
+struct BlockDescrambler
+{
+    uint64_t history_{0};
+
+    void push(bool bit)
+    {
+        history_ = (history_ << 1) | bit;
+    }
+
+    /// @return the newest bit, descrambled (bit 0) and NRZI decoded (bit 1).
+    uint32_t last() const
+    {
+        uint32_t x = uint32_t(history_);
+        uint32_t d = x ^ (x >> 12) ^ (x >> 17);
+        return (d & 1) | ((~(d ^ (d >> 1)) & 1) << 1);
+    }
+
+    /**
+     * @return the newest @p count bits (1-32), descrambled and NRZI
+     *  decoded, oldest in bit count - 1.
+     */
+    uint32_t operator()(uint8_t count) const
+    {
+        uint64_t d = history_ ^ (history_ >> 12) ^ (history_ >> 17);
+        uint32_t mask = count == 32 ? 0xFFFFFFFF : (1u << count) - 1;
+        return ~uint32_t(d ^ (d >> 1)) & mask;
+    }
+};
+
+/**
+ * The bit-level receive chain for one sampling phase.  The HDLC decoder
+ * is run in batches of up to 32 bits.  A batch is ended early by anything
+ * that can change the decoder state (the last eight bits are a flag or an
+ * abort, or the lock state changes) so that hdlc_decoder_.active() is up
+ * to date after every bit, and each bit is decoded with its own lock
+ * state.  The idle decoder ignores unlocked bits, so its shift register
+ * does not match the last eight bits received until eight bits after a
+ * lock change; those bits are decoded one at a time.
+ *
+ * If il2p_decoder_ is set, each descrambled bit is also passed to the IL2P
+ * decoder, which does not use NRZI.
+ */
+struct Fsk9600PhaseDecoder
+{
+    BlockDescrambler descrambler_;
+    hdlc::NewDecoder hdlc_decoder_;
+    il2p::Decoder* il2p_decoder_{nullptr};
+    uint8_t count_{0};          // Bits in the current batch.
+    uint8_t decoded_{0};        // The last eight NRZI decoded bits.
+    uint8_t settle_{0};         // Bits to decode singly after a lock change.
+    bool locked_{false};        // Lock state for the current batch.
+
+    void reset()
+    {
+        hdlc_decoder_.reset();
+        count_ = 0;
+        decoded_ = 0;
+        settle_ = 0;
+    }
+
+    hdlc::IoFrame* operator()(bool bit, bool locked)
+    {
+        hdlc::IoFrame* result = nullptr;
+
+        if (locked != locked_)
+        {
+            if (count_ != 0) result = flush();
+            locked_ = locked;
+            settle_ = 8;
+        }
+
+        descrambler_.push(bit);
+        auto last = descrambler_.last();
+        decoded_ = (decoded_ << 1) | (last >> 1);
+        ++count_;
+
+        if (settle_ != 0) --settle_;
+
+        if (count_ == 32 or settle_ != 0 or (decoded_ & 0xFE) == 0x7E)
+        {
+            auto frame = flush();
+            if (frame)
+            {
+                if (result) hdlc::release(frame);
+                else result = frame;
+            }
+        }
+
+        if (il2p_decoder_)
+        {
+            auto frame = (*il2p_decoder_)(last & 1);
+            if (frame)
+            {
+                if (result) hdlc::release(frame);
+                else result = frame;
+            }
+        }
+
+        return result;
+    }
+
+private:
+
+    /**
+     * Run the HDLC decoder over the current batch.  A batch ends at the
+     * first flag after a frame, so it holds the end of at most one frame.
+     */
+    hdlc::IoFrame* flush()
+    {
+        auto decoded = descrambler_(count_);
+
+        hdlc::IoFrame* result = nullptr;
+        for (int i = count_ - 1; i >= 0; --i)
+        {
+            auto frame = hdlc_decoder_((decoded >> i) & 1, locked_);
+            if (frame) result = frame;
+        }
+        count_ = 0;
+        return result;
+    }
+};
+
+}} // mobilinkd::tnc
@@ -0,0 +1,33 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+constexpr uint32_t FSK_ADC_SAMPLES_PER_SYMBOL = 20;    ///< Band filter input rate.
+constexpr uint32_t FSK_DAC_SAMPLES_PER_SYMBOL = 10;
+
+/**
+ * System clock for the G3RUH FSK modem at @p baud_rate.  The demodulator
+ * sets it each time it starts, including after every half-duplex
+ * transmission, and the modulator's DAC timer period is only right for
+ * the clock it was derived from, so both must use this.
+ *
+ * 72MHz unless it cannot be divided down to both the ADC and DAC sample
+ * rates (e.g. 384ksps for 19200 baud), otherwise 48MHz.
+ */
+constexpr uint32_t fsk_system_clock(uint32_t baud_rate)
+{
+    constexpr uint32_t SYSCLK72 = 72000000;
+    if (SYSCLK72 % (baud_rate * FSK_ADC_SAMPLES_PER_SYMBOL) == 0
+        and SYSCLK72 % (baud_rate * FSK_DAC_SAMPLES_PER_SYMBOL) == 0)
+    {
+        return SYSCLK72;
+    }
+    return 48000000;
+}
+
+}} // mobilinkd::tnc
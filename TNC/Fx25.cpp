@@ -0,0 +1,169 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "Fx25.hpp"
+#include "ReedSolomon.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace mobilinkd { namespace tnc { namespace fx25 {
+
+const Tag* find_tag(uint64_t bits)
+{
+    for (auto& tag : TAGS)
+    {
+        if (__builtin_popcountll(bits ^ tag.value) <= MAX_TAG_ERRORS) return &tag;
+    }
+    return nullptr;
+}
+
+const Tag* select_tag(size_t size, uint8_t parity)
+{
+    // Within each parity size the tags are in descending codeword size.
+    const Tag* result = nullptr;
+    for (auto& tag : TAGS)
+    {
+        if (tag.parity == parity and tag.data >= size) result = &tag;
+    }
+    return result;
+}
+
+namespace {
+
+/**
+ * The codes are all shortened from RS(255, 255 - parity).  As in Dire
+ * Wolf, the data is followed by zeros up to the full block length and the
+ * parity is computed over the whole block, so the zeros are the lowest
+ * order data coefficients rather than the highest.  They are not sent.
+ */
+template <size_t NROOTS>
+void encode_block(const Tag& tag, uint8_t* codeword)
+{
+    constexpr size_t K = MAX_CODEWORD - NROOTS;
+    std::fill(codeword + tag.data, codeword + K, 0);
+    std::array<uint8_t, NROOTS> parity;
+    ReedSolomon<NROOTS>::encode(codeword, K, parity.data());
+    std::copy(parity.begin(), parity.end(), codeword + tag.data);
+}
+
+template <size_t NROOTS>
+int decode_block(const Tag& tag, uint8_t* codeword)
+{
+    constexpr size_t K = MAX_CODEWORD - NROOTS;
+    if (tag.size != MAX_CODEWORD)
+    {
+        std::copy_backward(codeword + tag.data, codeword + tag.size, codeword + MAX_CODEWORD);
+        std::fill(codeword + tag.data, codeword + K, 0);
+    }
+    int result = ReedSolomon<NROOTS>::decode(codeword, MAX_CODEWORD);
+
+    // A correction in the zero fill means the decoder found the wrong
+    // codeword.
+    if (result > 0 and std::any_of(codeword + tag.data, codeword + K,
+        [](uint8_t x){ return x != 0; })) return -1;
+    return result;
+}
+
+} // namespace
+
+void encode(const Tag& tag, uint8_t* codeword)
+{
+    switch (tag.parity)
+    {
+    case 16:
+        encode_block<16>(tag, codeword);
+        break;
+    case 32:
+        encode_block<32>(tag, codeword);
+        break;
+    case 64:
+        encode_block<64>(tag, codeword);
+        break;
+    }
+}
+
+int decode(const Tag& tag, uint8_t* codeword)
+{
+    switch (tag.parity)
+    {
+    case 16:
+        return decode_block<16>(tag, codeword);
+    case 32:
+        return decode_block<32>(tag, codeword);
+    case 64:
+        return decode_block<64>(tag, codeword);
+    default:
+        return -1;
+    }
+}
+
+hdlc::IoFrame* Decoder::operator()(bool bit)
+{
+    switch (state_)
+    {
+    case State::SEARCH:
+        tag_bits_ = (tag_bits_ >> 1) | (uint64_t(bit) << 63);
+        tag_ = find_tag(tag_bits_);
+        if (tag_)
+        {
+            state_ = State::RECEIVE;
+            codeword_.fill(0);
+            index_ = 0;
+            bits_ = 0;
+        }
+        break;
+    case State::RECEIVE:
+        codeword_[index_] |= (bit << bits_);
+        if (++bits_ == 8)
+        {
+            bits_ = 0;
+            if (++index_ == tag_->size)
+            {
+                state_ = State::SEARCH;
+                tag_bits_ = 0;
+                return decode_frame();
+            }
+        }
+        break;
+    }
+    return nullptr;
+}
+
+/**
+ * Correct the codeword and run the data bytes through an HDLC decoder
+ * to recover the AX.25 frame.
+ */
+hdlc::IoFrame* Decoder::decode_frame()
+{
+    int corrected = decode(*tag_, codeword_.data());
+    if (corrected < 0)
+    {
+        TNC_DEBUG("FX.25 uncorrectable (RS(%d,%d))", tag_->size, tag_->data);
+        return nullptr;
+    }
+
+    hdlc::IoFrame* result = nullptr;
+    for (size_t i = 0; i != tag_->data and !result; ++i)
+    {
+        uint8_t byte = codeword_[i];
+        for (size_t j = 0; j != 8 and !result; ++j)
+        {
+            result = hdlc_decoder_(byte & 1, true);
+            byte >>= 1;
+        }
+    }
+
+    // Return the decoder to its initial state, releasing any partial frame.
+    if (hdlc_decoder_.packet) hdlc::release(hdlc_decoder_.packet);
+    hdlc_decoder_ = hdlc::NewDecoder();
+
+    if (result)
+    {
+        TNC_DEBUG("FX.25 RS(%d,%d) corrected %d", tag_->size, tag_->data, corrected);
+    }
+
+    return result;
+}
+
+}}} // mobilinkd::tnc::fx25
@@ -0,0 +1,111 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "HdlcDecoder.hpp"
+#include "HdlcFrame.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc { namespace fx25 {
+
+/**
+ * FX.25 wraps a complete, bit-stuffed AX.25 frame (flags included) in a
+ * Reed-Solomon codeword, preceded by a 64-bit correlation tag which
+ * identifies the code.  The tag and codeword are sent LSB first, after
+ * the preamble flags.  Receivers which do not understand FX.25 see the
+ * AX.25 frame between noise.
+ */
+struct Tag
+{
+    uint64_t value;
+    uint8_t size;       ///< Codeword size (data + parity).
+    uint8_t data;       ///< Data bytes.
+    uint8_t parity;     ///< Parity bytes (RS roots).
+};
+
+constexpr std::array<Tag, 11> TAGS = {{
+    {0xB74DB7DF8A532F3E, 255, 239, 16},
+    {0x26FF60A600CC8FDE, 144, 128, 16},
+    {0xC7DC0508F3D9B09E,  80,  64, 16},
+    {0x8F056EB4369660EE,  48,  32, 16},
+    {0x6E260B1AC5835FAE, 255, 223, 32},
+    {0xFF94DC634F1CFF4E, 160, 128, 32},
+    {0x1EB7B9CDBC09C00E,  96,  64, 32},
+    {0xDBF869BD2DBB1776,  64,  32, 32},
+    {0x3ADB0C13DEAE2836, 255, 191, 64},
+    {0xAB69DB6A543188D6, 192, 128, 64},
+    {0x4A4ABEC4A724B796, 128,  64, 64},
+}};
+
+/// Correlation tags are accepted with up to this many bit errors.
+constexpr int MAX_TAG_ERRORS = 8;
+
+constexpr size_t MAX_CODEWORD = 255;
+
+/**
+ * @return the tag matching @p bits (the last 64 bits received, the
+ *  newest in the MSB), or nullptr.
+ */
+const Tag* find_tag(uint64_t bits);
+
+/**
+ * @return the smallest code with @p parity parity bytes which holds
+ *  @p size data bytes, or nullptr if there is none.
+ */
+const Tag* select_tag(size_t size, uint8_t parity);
+
+/**
+ * Write the parity for the tag's code after the data in @p codeword.
+ * The buffer must hold MAX_CODEWORD bytes; the bytes after the codeword
+ * are used as scratch.
+ */
+void encode(const Tag& tag, uint8_t* codeword);
+
+/**
+ * Correct the codeword (data then parity, as sent) in place.  The buffer
+ * must hold MAX_CODEWORD bytes.  Only the data bytes are valid afterwards.
+ *
+ * @return the number of bytes corrected or -1 if uncorrectable.
+ */
+int decode(const Tag& tag, uint8_t* codeword);
+
+/**
+ * FX.25 receiver.  It runs alongside the HDLC decoder on the same NRZI
+ * decoded bits, searching for correlation tags.  After a tag, it collects
+ * the codeword, corrects it, and decodes the AX.25 frame inside.
+ */
+struct Decoder
+{
+    enum class State { SEARCH, RECEIVE };
+
+    State state_{State::SEARCH};
+    uint64_t tag_bits_{0};
+    const Tag* tag_{nullptr};
+    std::array<uint8_t, MAX_CODEWORD> codeword_;
+    uint16_t index_{0};
+    uint8_t bits_{0};
+    hdlc::NewDecoder hdlc_decoder_;
+
+    hdlc::IoFrame* operator()(bool bit);
+
+    bool active() const { return state_ != State::SEARCH; }
+
+    /// Abandon any codeword in progress.
+    void reset()
+    {
+        state_ = State::SEARCH;
+        tag_bits_ = 0;
+        index_ = 0;
+        bits_ = 0;
+        hdlc_decoder_.reset();
+    }
+
+private:
+    hdlc::IoFrame* decode_frame();
+};
+
+}}} // mobilinkd::tnc::fx25
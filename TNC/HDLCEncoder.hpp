@@ -13,11 +13,15 @@
 #include "KissHardware.hpp"
 #include "AudioInput.hpp"
 #include "DCD.h"
+#include "Fx25.hpp"
+#include "Il2p.hpp"
 
 #include "main.h"
 
 #include <cmsis_os.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 
 namespace mobilinkd { namespace tnc { namespace hdlc {
@@ -53,6 +57,7 @@ struct Encoder : public ::mobilinkd::Encoder
     Modulator* modulator_;
     volatile bool running_;
     bool send_delay_;   // Avoid sending the preamble for back-to-back frames.
+    std::array<uint8_t, fx25::MAX_CODEWORD> codeword_;  // FX.25 codeword or IL2P block.
 
     Encoder(osMessageQId input)
     : tx_delay_(kiss::settings().txdelay), tx_tail_(kiss::settings().txtail)
@@ -69,7 +74,10 @@ struct Encoder : public ::mobilinkd::Encoder
         send_delay_ = true;
         while (running_) {
             state_ = state_type::STATE_IDLE;
-            osEvent evt = osMessageGet(input_, osWaitForever);
+            // Leave the frame queued if it is for the other transmit context.
+            osEvent evt = osMessagePeek(input_, osWaitForever);
+            if (evt.status == osEventMessage && txModemSwitch(evt.value.p)) return;
+            evt = osMessageGet(input_, osWaitForever);
             if (evt.status == osEventMessage) {
                 if (evt.value.p == nullptr) return;
                 tx_delay_ = kiss::settings().txdelay;
@@ -81,11 +89,12 @@ struct Encoder : public ::mobilinkd::Encoder
                 process(frame);
                 // See if we have back-to-back frames.
                 evt = osMessagePeek(input_, 0);
-                if (evt.status != osEventMessage) {
+                bool other = evt.status == osEventMessage && txModemSwitch(evt.value.p);
+                if (evt.status != osEventMessage || other) {
                     send_raw(IDLE);
                     send_raw(IDLE);
                     send_delay_ = true;
-                    if (!duplex_) {
+                    if (!duplex_ and !other) {
                       osMessagePut(audioInputQueueHandle, audio::DEMODULATOR,
                         osWaitForever);
                     }
@@ -200,7 +209,17 @@ struct Encoder : public ::mobilinkd::Encoder
     void process(IoFrame* frame) {
         ones_ = 0;      // Reset the ones count for each frame.
 
-        frame->add_fcs();
+        // IL2P has its own error detection; the FCS is not sent.
+        const bool il2p = kiss::settings().il2p();
+        if (!il2p) frame->add_fcs();
+
+        // Build the FX.25 codeword first; this may take a few ms.
+        const fx25::Tag* fx25_tag = nullptr;
+        auto fx25_parity = kiss::settings().fx25_parity();
+        if (fx25_parity and (kiss::settings().modem_type == kiss::Hardware::ModemType::AFSK1200
+            or kiss::settings().modem_type == kiss::Hardware::ModemType::AFSK1200_M17)) {
+            fx25_tag = fx25_encode(frame, fx25_parity);
+        }
 
         if (send_delay_) {
             if (not do_csma()) {
@@ -210,17 +229,124 @@ struct Encoder : public ::mobilinkd::Encoder
             if (!duplex_) {
                 osMessagePut(audioInputQueueHandle, audio::IDLE, osWaitForever);
             }
-            send_delay();
+            if (il2p) send_il2p_delay();
+            else send_delay();
             send_delay_ = false;
-        } else {
+        } else if (!il2p) {
             send_raw(FLAG);
         }
 
-        for (auto c : *frame) send(c);
+        if (il2p) {
+            il2p_send(frame);
+        } else if (fx25_tag) {
+            // The codeword holds the stuffed frame and its flags.
+            for (size_t i = 0; i != 8; ++i) send_raw(fx25_tag->value >> (i * 8));
+            for (size_t i = 0; i != fx25_tag->size; ++i) send_raw(codeword_[i]);
+        } else {
+            for (auto c : *frame) send(c);
+        }
         release(frame);
         send_tail();
     }
 
+    /**
+     * Bit-stuff the frame, with opening and closing flags, into the FX.25
+     * buffer, padded with flags, and append the Reed-Solomon parity.
+     *
+     * @return the FX.25 tag for the code used, or nullptr if the frame is
+     *  too large for FX.25.
+     */
+    const fx25::Tag* fx25_encode(IoFrame* frame, uint8_t parity) {
+        codeword_.fill(0);
+        const size_t capacity = fx25::MAX_CODEWORD * 8;
+        size_t pos = 0;
+        int ones = 0;
+
+        auto put = [this, &pos, capacity](uint8_t bit) {
+            if (pos == capacity) return false;
+            codeword_[pos >> 3] |= bit << (pos & 7);
+            ++pos;
+            return true;
+        };
+
+        for (size_t i = 0; i != 8; ++i) put((FLAG >> i) & 1);
+        for (auto c : *frame) {
+            for (size_t i = 0; i != 8; ++i) {
+                uint8_t bit = (c >> i) & 1;
+                if (!put(bit)) return nullptr;
+                if (bit) {
+                    if (++ones == 5) {
+                        if (!put(0)) return nullptr;
+                        ones = 0;
+                    }
+                } else {
+                    ones = 0;
+                }
+            }
+        }
+        for (size_t i = 0; i != 8; ++i) if (!put((FLAG >> i) & 1)) return nullptr;
+
+        auto tag = fx25::select_tag((pos + 7) / 8, parity);
+        if (!tag) return nullptr;
+
+        // Fill the rest of the data with flags, continuing the bit pattern.
+        for (size_t i = 0; pos != tag->data * 8u; ++i) put((FLAG >> (i & 7)) & 1);
+
+        fx25::encode(*tag, codeword_.data());
+        return tag;
+    }
+
+    /**
+     * Send the frame as an IL2P packet: the sync word, the header block
+     * and the payload blocks.  Each block is scrambled and then has its
+     * parity appended.
+     */
+    void il2p_send(IoFrame* frame) {
+        const bool max_fec = kiss::settings().framing() == kiss::hardware::FRAMING_IL2P_MAX_FEC;
+
+        std::array<uint8_t, il2p::AX25_HEADER_SIZE> ax25;
+        const size_t size = frame->size();
+        auto it = frame->begin();
+        std::copy_n(it, std::min(size, ax25.size()), ax25.begin());
+
+        il2p::Header header;
+        if (!il2p::encode_header(ax25.data(), size, max_fec, header)) {
+            ERROR("Frame too large for IL2P (%d bytes)", int(size));
+            return;
+        }
+
+        send_msb(il2p::SYNC_WORD >> 16);
+        send_msb(il2p::SYNC_WORD >> 8);
+        send_msb(il2p::SYNC_WORD);
+
+        std::copy(header.data.begin(), header.data.end(), codeword_.begin());
+        il2p_send_block(il2p::HEADER_SIZE, il2p::HEADER_PARITY);
+
+        auto layout = il2p::layout(header.payload_size, max_fec);
+        std::advance(it, header.payload_offset);
+        for (size_t i = 0; i != layout.count; ++i) {
+            auto data_size = layout.data_size(i);
+            for (size_t j = 0; j != data_size; ++j) codeword_[j] = *it++;
+            il2p_send_block(data_size, layout.parity);
+        }
+    }
+
+    void il2p_send_block(size_t size, uint8_t parity) {
+        il2p::scramble(codeword_.data(), size);
+        il2p::encode_block(codeword_.data(), size, parity);
+        for (size_t i = 0; i != size + parity; ++i) send_msb(codeword_[i]);
+    }
+
+    /// IL2P preamble.  The receiver looks only for the sync word.
+    void send_il2p_delay() {
+        const size_t tmp = tx_delay_ * 1.25 * modulator_->bits_per_ms();
+
+        INFO("Sending %u IL2P preamble bytes", tmp);
+        for (size_t i = 0; i != tmp; i++) {
+            send_msb(il2p::PREAMBLE);
+        }
+    }
+
     void send_delay() {
         const size_t tmp = tx_delay_ * 1.25 * modulator_->bits_per_ms();
 
@@ -243,6 +369,14 @@ struct Encoder : public ::mobilinkd::Encoder
         send_raw(FLAG);
     }
 
+    // IL2P sends bytes MSB first, without NRZI.
+    void send_msb(uint8_t byte) {
+        for (size_t i = 0; i != 8; i++) {
+            modulator_->send((byte & 0x80) != 0);
+            byte <<= 1;
+        }
+    }
+
     // No bit stuffing for PREAMBLE and TAIL
     void send_raw(uint8_t byte) {
         for (size_t i = 0; i != 8; i++) {
@@ -2,7 +2,6 @@
 // All rights reserved.
 
 #include "HdlcDecoder.hpp"
-#include "GPIO.hpp"
 #include "Log.h"
 
 namespace mobilinkd { namespace tnc { namespace hdlc {
@@ -73,6 +73,19 @@ struct NewDecoder
     {
         return state != State::IDLE;
     }
+
+    /// Abandon any frame in progress, e.g. after a gap in the input.
+    void reset()
+    {
+        if (packet) release(packet);
+        packet = nullptr;
+        state = State::IDLE;
+        buffer = 0;
+        bits = 0;
+        report_bits = 0;
+        ones = 0;
+        flag = false;
+    }
 };
 
 }}} // mobilinkd::tnc::hdlc
@@ -66,7 +66,7 @@ private:
 
         checksum ^= 0xFFFF;  // Compliment
         checksum <<= 16;     // Shift
-        asm volatile("rbit %0, %0" : "+r" (checksum)); // Reverse
+        checksum = __RBIT(checksum);  // Reverse
         uint16_t result = checksum & 0xFFFF;
         TNC_DEBUG("CRC = %hx", result);
         return result;
@@ -162,21 +162,17 @@ public:
     static constexpr uint16_t capacity() { return SIZE; }
 
     frame_type* acquire() {
-        frame_type* result = nullptr;
-        auto x = taskENTER_CRITICAL_FROM_ISR();
-        if (!free_list_.empty()) {
-            result = &free_list_.front();
-            free_list_.pop_front();
-        }
-        taskEXIT_CRITICAL_FROM_ISR(x);
+        memory::CriticalSection critical;
+        if (free_list_.empty()) return nullptr;
+        frame_type* result = &free_list_.front();
+        free_list_.pop_front();
         return result;
     }
 
     void release(frame_type* frame) {
         frame->clear();
-        auto x = taskENTER_CRITICAL_FROM_ISR();
+        memory::CriticalSection critical;
         free_list_.push_back(*frame);
-        taskEXIT_CRITICAL_FROM_ISR(x);
     }
 };
 
@@ -7,7 +7,10 @@
 #include "PortInterface.h"
 #include "PortInterface.hpp"
 #include "main.h"
+#include "AgcSupervisor.hpp"
 #include "AudioInput.hpp"
+#include "BeaconScheduler.hpp"
+#include "Digipeater.hpp"
 #include "HdlcFrame.hpp"
 #include "Kiss.hpp"
 #include "KissHardware.hpp"
@@ -74,6 +77,9 @@ void startIOEventTask(void const*)
             HAL_IWDG_Refresh(&hiwdg); // Refresh IWDG in IO loop (primary refresh).
         }
 
+        beaconScheduler().poll();
+        audio::agcSupervisor().poll();
+
         if (evt.status != osEventMessage)
             continue;
 
@@ -95,10 +101,10 @@ void startIOEventTask(void const*)
                 TNC_DEBUG("Button Up");
                 break;
             case CMD_SET_PTT_SIMPLEX:
-                getModulator().set_ptt(&simplexPtt);
+                setPtt(PTT::SIMPLEX);
                 break;
             case CMD_SET_PTT_MULTIPLEX:
-                getModulator().set_ptt(&multiplexPtt);
+                setPtt(PTT::MULTIPLEX);
                 break;
             case CMD_RESTORE_SYSCLK:
                 // Not appicable to NucleoTNC
@@ -118,6 +124,7 @@ void startIOEventTask(void const*)
         {
             TNC_DEBUG("RF frame");
             frame->source(frame->source() & 0x70);
+            digipeater()(frame);
             if (!ioport->write(frame, frame->size() + 100))
             {
                 ERROR("Timed out sending frame");
@@ -0,0 +1,501 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "Il2p.hpp"
+#include "ReedSolomon.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace mobilinkd { namespace tnc { namespace il2p {
+
+namespace {
+
+// The IL2P codes use generator roots alpha^0 ... alpha^(NROOTS - 1).
+template <size_t NROOTS>
+using Codec = ReedSolomon<NROOTS, 0>;
+
+constexpr uint16_t TX_LFSR_INIT = 0x00F;
+constexpr uint16_t RX_LFSR_INIT = 0x1F0;
+
+// x^9 + x^4 + 1.  The scrambler output lags its input by 5 bits.
+bool scramble_bit(bool in, uint16_t& state)
+{
+    bool out = ((state >> 4) ^ state) & 1;
+    state = ((((in ^ state) & 1) << 9) | (state ^ ((state & 1) << 4))) >> 1;
+    return out;
+}
+
+bool descramble_bit(bool in, uint16_t& state)
+{
+    bool out = (in ^ state) & 1;
+    state = ((state >> 1) | (in << 8)) ^ (in << 3);
+    return out;
+}
+
+/*
+ * Type 1 header fields other than the callsigns and SSIDs are spread over
+ * bits 6 and 7 of the header bytes, MSB first, ending at lsb_index.
+ */
+void set_field(uint8_t* header, int bit, int lsb_index, int width, uint32_t value)
+{
+    for (int i = 0; i != width; ++i, value >>= 1)
+    {
+        if (value & 1) header[lsb_index - i] |= (1 << bit);
+    }
+}
+
+uint32_t get_field(const uint8_t* header, int bit, int lsb_index, int width)
+{
+    uint32_t result = 0;
+    for (int i = width - 1; i >= 0; --i)
+    {
+        result = (result << 1) | ((header[lsb_index - i] >> bit) & 1);
+    }
+    return result;
+}
+
+void set_ui(uint8_t* h, uint32_t value) { set_field(h, 6, 0, 1, value); }
+void set_pid(uint8_t* h, uint32_t value) { set_field(h, 6, 4, 4, value); }
+void set_control(uint8_t* h, uint32_t value) { set_field(h, 6, 11, 7, value); }
+void set_fec_level(uint8_t* h, uint32_t value) { set_field(h, 7, 0, 1, value); }
+void set_header_type(uint8_t* h, uint32_t value) { set_field(h, 7, 1, 1, value); }
+void set_payload_size(uint8_t* h, uint32_t value) { set_field(h, 7, 11, 10, value); }
+
+uint32_t get_ui(const uint8_t* h) { return get_field(h, 6, 0, 1); }
+uint32_t get_pid(const uint8_t* h) { return get_field(h, 6, 4, 4); }
+uint32_t get_control(const uint8_t* h) { return get_field(h, 6, 11, 7); }
+uint32_t get_fec_level(const uint8_t* h) { return get_field(h, 7, 0, 1); }
+uint32_t get_header_type(const uint8_t* h) { return get_field(h, 7, 1, 1); }
+uint32_t get_payload_size(const uint8_t* h) { return get_field(h, 7, 11, 10); }
+
+// AX.25 PID for each IL2P PID code.  Codes 0 and 1 mark S and U frames;
+// zero entries cannot be translated.
+constexpr std::array<uint8_t, 16> PID_TABLE = {
+    0x00, 0x00, 0x20, 0x01, 0x06, 0x07, 0x08, 0xCC,
+    0xCD, 0xCE, 0xCF, 0xF0, 0x00, 0x00, 0x00, 0x00
+};
+
+constexpr uint8_t PID_S_FRAME = 0;
+constexpr uint8_t PID_U_FRAME = 1;
+
+// AX.25 U frame control fields (P/F clear) for each IL2P opcode.
+constexpr std::array<uint8_t, 8> U_OPCODES = {
+    0x2F,   // SABM
+    0x43,   // DISC
+    0x0F,   // DM
+    0x63,   // UA
+    0x87,   // FRMR
+    0x03,   // UI
+    0xAF,   // XID
+    0xE3    // TEST
+};
+
+constexpr uint8_t OPCODE_UI = 5;
+
+constexpr size_t AX25_ADDRESS_SIZE = 7;
+constexpr size_t AX25_MIN_SIZE = AX25_ADDRESS_SIZE * 2 + 1;
+
+int encode_pid(uint8_t pid)
+{
+    for (size_t i = 2; i != PID_TABLE.size(); ++i)
+    {
+        if (PID_TABLE[i] != 0 and PID_TABLE[i] == pid) return i;
+    }
+    return -1;
+}
+
+/**
+ * Compress the addresses, control and PID into a type 1 header.  This is
+ * possible only for modulo 8 frames with no digipeaters, translatable
+ * PIDs and callsigns using upper case letters and digits.
+ */
+bool encode_type1(const uint8_t* ax25, size_t size, Header& header)
+{
+    if (size < AX25_MIN_SIZE) return false;
+    if (!(ax25[13] & 1)) return false;  // Digipeaters.
+
+    auto h = header.data.data();
+
+    for (size_t i = 0; i != 6; ++i)
+    {
+        uint8_t dest = ax25[i] >> 1;
+        uint8_t src = ax25[i + AX25_ADDRESS_SIZE] >> 1;
+        if (dest < 0x20 or dest > 0x5F or src < 0x20 or src > 0x5F) return false;
+        h[i] = dest - 0x20;
+        h[i + 6] = src - 0x20;
+    }
+    h[12] = (((ax25[6] >> 1) & 0x0F) << 4) | ((ax25[13] >> 1) & 0x0F);
+
+    // AX.25 v2 command/response bits.  Version 1 frames are sent as type 0.
+    bool dest_c = ax25[6] & 0x80;
+    bool src_c = ax25[13] & 0x80;
+    if (dest_c == src_c) return false;
+    bool command = dest_c;
+
+    uint8_t control = ax25[14];
+    uint8_t pf = (control >> 4) & 1;
+    uint8_t nr = control >> 5;
+    size_t offset = AX25_MIN_SIZE;
+
+    if ((control & 1) == 0)
+    {
+        // I frame.
+        if (!command or size == AX25_MIN_SIZE) return false;
+        int pid = encode_pid(ax25[15]);
+        if (pid < 0) return false;
+        set_pid(h, pid);
+        set_control(h, (pf << 6) | (nr << 3) | ((control >> 1) & 7));
+        ++offset;
+    }
+    else if ((control & 3) == 1)
+    {
+        // S frame.
+        set_pid(h, PID_S_FRAME);
+        set_control(h, (pf << 6) | (nr << 3) | (command << 2) | ((control >> 2) & 3));
+    }
+    else
+    {
+        // U frame.
+        auto it = std::find(U_OPCODES.begin(), U_OPCODES.end(), control & ~0x10);
+        if (it == U_OPCODES.end()) return false;
+        uint8_t opcode = it - U_OPCODES.begin();
+
+        if (opcode == OPCODE_UI)
+        {
+            if (size == AX25_MIN_SIZE) return false;
+            int pid = encode_pid(ax25[15]);
+            if (pid < 0) return false;
+            set_ui(h, 1);
+            set_pid(h, pid);
+            ++offset;
+        }
+        else
+        {
+            set_pid(h, PID_U_FRAME);
+        }
+        set_control(h, (pf << 6) | (opcode << 3) | (command << 2));
+    }
+
+    header.payload_offset = offset;
+    header.payload_size = size - offset;
+    return true;
+}
+
+} // namespace
+
+void scramble(uint8_t* data, size_t size)
+{
+    uint16_t state = TX_LFSR_INIT;
+    uint8_t out = 0;
+    int out_bits = -5;      // The first 5 output bits are discarded.
+    size_t out_index = 0;
+
+    // Each output byte is written only after the input byte at the same
+    // position has been read, so this works in place.
+    auto put = [&](bool bit) {
+        if (out_bits < 0)
+        {
+            ++out_bits;
+            return;
+        }
+        out = (out << 1) | bit;
+        if (++out_bits == 8)
+        {
+            data[out_index++] = out;
+            out_bits = 0;
+        }
+    };
+
+    for (size_t i = 0; i != size; ++i)
+    {
+        uint8_t byte = data[i];
+        for (size_t j = 0; j != 8; ++j)
+        {
+            put(scramble_bit(byte & 0x80, state));
+            byte <<= 1;
+        }
+    }
+
+    // Flush the last 5 bits out of the scrambler.
+    for (size_t j = 0; j != 5; ++j) put(scramble_bit(0, state));
+}
+
+void descramble(uint8_t* data, size_t size)
+{
+    uint16_t state = RX_LFSR_INIT;
+
+    for (size_t i = 0; i != size; ++i)
+    {
+        uint8_t byte = data[i];
+        uint8_t out = 0;
+        for (size_t j = 0; j != 8; ++j)
+        {
+            out = (out << 1) | descramble_bit(byte & 0x80, state);
+            byte <<= 1;
+        }
+        data[i] = out;
+    }
+}
+
+void encode_block(uint8_t* block, size_t size, uint8_t parity)
+{
+    switch (parity)
+    {
+    case 2:
+        Codec<2>::encode(block, size, block + size);
+        break;
+    case 4:
+        Codec<4>::encode(block, size, block + size);
+        break;
+    case 6:
+        Codec<6>::encode(block, size, block + size);
+        break;
+    case 8:
+        Codec<8>::encode(block, size, block + size);
+        break;
+    case 16:
+        Codec<16>::encode(block, size, block + size);
+        break;
+    }
+}
+
+int decode_block(uint8_t* block, size_t size, uint8_t parity)
+{
+    switch (parity)
+    {
+    case 2:
+        return Codec<2>::decode(block, size);
+    case 4:
+        return Codec<4>::decode(block, size);
+    case 6:
+        return Codec<6>::decode(block, size);
+    case 8:
+        return Codec<8>::decode(block, size);
+    case 16:
+        return Codec<16>::decode(block, size);
+    default:
+        return -1;
+    }
+}
+
+Layout layout(size_t payload_size, bool max_fec)
+{
+    Layout result;
+    if (payload_size == 0) return result;
+
+    const size_t max_block = max_fec ? 239 : 247;
+    size_t count = (payload_size + max_block - 1) / max_block;
+    size_t small_size = payload_size / count;
+
+    result.count = count;
+    result.large_count = payload_size - count * small_size;
+    result.large_size = small_size + 1;
+
+    if (max_fec) result.parity = 16;
+    else if (small_size <= 61) result.parity = 2;
+    else if (small_size <= 123) result.parity = 4;
+    else if (small_size <= 185) result.parity = 6;
+    else result.parity = 8;
+
+    return result;
+}
+
+bool encode_header(const uint8_t* ax25, size_t size, bool max_fec, Header& header)
+{
+    header.data.fill(0);
+    header.max_fec = max_fec;
+
+    bool type1 = encode_type1(ax25, size, header);
+    if (!type1)
+    {
+        // Type 0: the whole frame is the payload.
+        header.data.fill(0);
+        header.payload_offset = 0;
+        header.payload_size = size;
+    }
+
+    if (header.payload_size > MAX_PAYLOAD) return false;
+
+    auto h = header.data.data();
+    set_fec_level(h, max_fec);
+    set_header_type(h, type1);
+    set_payload_size(h, header.payload_size);
+    return true;
+}
+
+bool decode_header(const uint8_t* h, hdlc::IoFrame* frame, Header& header)
+{
+    std::copy_n(h, HEADER_SIZE, header.data.begin());
+    header.max_fec = get_fec_level(h);
+    header.payload_size = get_payload_size(h);
+    header.payload_offset = 0;
+
+    if (!get_header_type(h)) return true;
+
+    uint8_t control = get_control(h);
+    uint8_t pid = get_pid(h);
+    uint8_t pf = (control >> 6) & 1;
+    bool command = true;
+    uint8_t ax25_control;
+    uint8_t ax25_pid = 0;
+
+    if (get_ui(h))
+    {
+        command = (control >> 2) & 1;
+        ax25_control = U_OPCODES[OPCODE_UI] | (pf << 4);
+        ax25_pid = PID_TABLE[pid];
+        if (ax25_pid == 0) return false;
+    }
+    else if (pid == PID_S_FRAME)
+    {
+        command = (control >> 2) & 1;
+        ax25_control = (((control >> 3) & 7) << 5) | (pf << 4) | ((control & 3) << 2) | 1;
+    }
+    else if (pid == PID_U_FRAME)
+    {
+        command = (control >> 2) & 1;
+        ax25_control = U_OPCODES[(control >> 3) & 7] | (pf << 4);
+    }
+    else
+    {
+        ax25_control = (((control >> 3) & 7) << 5) | (pf << 4) | ((control & 7) << 1);
+        ax25_pid = PID_TABLE[pid];
+        if (ax25_pid == 0) return false;
+    }
+
+    for (size_t i = 0; i != 6; ++i) frame->push_back(((h[i] & 0x3F) + 0x20) << 1);
+    frame->push_back(0x60 | ((h[12] >> 4) << 1) | (command << 7));
+    for (size_t i = 6; i != 12; ++i) frame->push_back(((h[i] & 0x3F) + 0x20) << 1);
+    frame->push_back(0x61 | ((h[12] & 0x0F) << 1) | (!command << 7));
+    frame->push_back(ax25_control);
+    if (ax25_pid) frame->push_back(ax25_pid);
+
+    header.payload_offset = frame->size();
+    return true;
+}
+
+void Decoder::reset()
+{
+    if (frame_) hdlc::release(frame_);
+    frame_ = nullptr;
+    state_ = State::SEARCH;
+    sync_bits_ = 0;
+}
+
+hdlc::IoFrame* Decoder::operator()(bool bit)
+{
+    switch (state_)
+    {
+    case State::SEARCH:
+        sync_bits_ = ((sync_bits_ << 1) | bit) & SYNC_MASK;
+        if (__builtin_popcount(sync_bits_ ^ SYNC_WORD) <= MAX_SYNC_ERRORS)
+        {
+            invert_ = false;
+        }
+        else if (__builtin_popcount(sync_bits_ ^ (~SYNC_WORD & SYNC_MASK)) <= MAX_SYNC_ERRORS)
+        {
+            invert_ = true;
+        }
+        else
+        {
+            break;
+        }
+        state_ = State::HEADER;
+        block_size_ = HEADER_SIZE + HEADER_PARITY;
+        index_ = 0;
+        bits_ = 0;
+        break;
+    case State::HEADER:
+    case State::PAYLOAD:
+        block_[index_] = (block_[index_] << 1) | (bit ^ invert_);
+        if (++bits_ != 8) break;
+        bits_ = 0;
+        if (++index_ != block_size_) break;
+        index_ = 0;
+        return state_ == State::HEADER ? decode_header() : decode_payload();
+    }
+    return nullptr;
+}
+
+hdlc::IoFrame* Decoder::decode_header()
+{
+    state_ = State::SEARCH;
+    sync_bits_ = 0;
+
+    if (decode_block(block_.data(), HEADER_SIZE + HEADER_PARITY, HEADER_PARITY) < 0)
+    {
+        TNC_DEBUG("IL2P header uncorrectable");
+        return nullptr;
+    }
+    descramble(block_.data(), HEADER_SIZE);
+
+    frame_ = hdlc::ioFramePool().acquire();
+    if (!frame_) return nullptr;
+
+    Header header;
+    if (!il2p::decode_header(block_.data(), frame_, header))
+    {
+        reset();
+        return nullptr;
+    }
+
+    layout_ = layout(header.payload_size, header.max_fec);
+    block_number_ = 0;
+    if (layout_.count == 0) return decode_payload();
+
+    block_size_ = layout_.data_size(0) + layout_.parity;
+    state_ = State::PAYLOAD;
+    return nullptr;
+}
+
+/**
+ * Correct and descramble a payload block, adding it to the frame.  After
+ * the last block, the FCS is added so that the frame looks like one from
+ * the HDLC decoder.
+ */
+hdlc::IoFrame* Decoder::decode_payload()
+{
+    if (block_number_ != layout_.count)
+    {
+        auto data_size = layout_.data_size(block_number_);
+        int corrected = decode_block(block_.data(), block_size_, layout_.parity);
+        if (corrected < 0)
+        {
+            TNC_DEBUG("IL2P block %d uncorrectable", int(block_number_));
+            reset();
+            return nullptr;
+        }
+        descramble(block_.data(), data_size);
+        for (size_t i = 0; i != data_size; ++i)
+        {
+            if (!frame_->push_back(block_[i]))
+            {
+                reset();
+                return nullptr;
+            }
+        }
+
+        if (++block_number_ != layout_.count)
+        {
+            block_size_ = layout_.data_size(block_number_) + layout_.parity;
+            return nullptr;
+        }
+    }
+
+    auto result = frame_;
+    frame_ = nullptr;
+    state_ = State::SEARCH;
+    sync_bits_ = 0;
+
+    if (result->size() < AX25_MIN_SIZE)
+    {
+        hdlc::release(result);
+        return nullptr;
+    }
+
+    result->add_fcs();
+    return result;
+}
+
+}}} // mobilinkd::tnc::il2p
@@ -0,0 +1,132 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "HdlcFrame.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc { namespace il2p {
+
+/**
+ * IL2P (Improved Layer 2 Protocol) replaces HDLC framing with a sync word,
+ * a fixed-size header and a payload split into Reed-Solomon protected
+ * blocks.  There is no bit stuffing and no NRZI; bytes are sent MSB first.
+ *
+ * The header and each payload block are scrambled before the parity is
+ * computed.  The AX.25 address, control and PID fields of common frames
+ * are compressed into the 13-byte header (a type 1 header).  Other frames
+ * are sent whole in the payload (a type 0 header).
+ */
+
+constexpr uint32_t SYNC_WORD = 0xF15E48;
+constexpr uint32_t SYNC_MASK = 0xFFFFFF;
+constexpr int MAX_SYNC_ERRORS = 1;
+
+constexpr uint8_t PREAMBLE = 0x55;
+
+constexpr size_t HEADER_SIZE = 13;
+constexpr size_t HEADER_PARITY = 2;
+constexpr size_t MAX_PAYLOAD = 1023;
+constexpr size_t MAX_BLOCK = 255;
+
+/// The AX.25 bytes needed to build a type 1 header: two addresses,
+/// control and PID.
+constexpr size_t AX25_HEADER_SIZE = 16;
+
+/// Scramble @p size bytes in place.
+void scramble(uint8_t* data, size_t size);
+
+/// Descramble @p size bytes in place.
+void descramble(uint8_t* data, size_t size);
+
+/// Append @p parity Reed-Solomon parity bytes to the @p size bytes of data.
+void encode_block(uint8_t* block, size_t size, uint8_t parity);
+
+/**
+ * Correct a block of @p size bytes, including @p parity parity bytes.
+ *
+ * @return the number of bytes corrected or -1 if uncorrectable.
+ */
+int decode_block(uint8_t* block, size_t size, uint8_t parity);
+
+/**
+ * The payload is split into blocks of nearly equal size, the larger
+ * blocks first.
+ */
+struct Layout
+{
+    uint8_t count{0};           ///< Number of blocks.
+    uint8_t large_count{0};     ///< Number of blocks of large_size data bytes.
+    uint8_t large_size{0};      ///< Data bytes in a large block; small blocks have one less.
+    uint8_t parity{0};          ///< Parity bytes per block.
+
+    /// Data bytes in block @p n.
+    uint8_t data_size(size_t n) const
+    {
+        return n < large_count ? large_size : large_size - 1;
+    }
+};
+
+Layout layout(size_t payload_size, bool max_fec);
+
+struct Header
+{
+    std::array<uint8_t, HEADER_SIZE> data;
+    uint16_t payload_offset;    ///< AX.25 bytes replaced by the header.
+    uint16_t payload_size;
+    bool max_fec;
+};
+
+/**
+ * Build the header for an AX.25 frame (without FCS) of @p size bytes.
+ * @p ax25 holds the first AX25_HEADER_SIZE bytes of the frame, or the
+ * whole frame if it is shorter.
+ *
+ * @return false if the frame is too large for IL2P.
+ */
+bool encode_header(const uint8_t* ax25, size_t size, bool max_fec, Header& header);
+
+/**
+ * Parse a descrambled header, writing the AX.25 address, control and PID
+ * fields it holds into @p frame.
+ *
+ * @return false if the header is invalid.
+ */
+bool decode_header(const uint8_t* data, hdlc::IoFrame* frame, Header& header);
+
+/**
+ * IL2P receiver.  It searches the bit stream (after the G3RUH descrambler
+ * but before the NRZI decoder) for the sync word, in either polarity, and
+ * then collects the header and payload blocks.
+ */
+struct Decoder
+{
+    enum class State { SEARCH, HEADER, PAYLOAD };
+
+    State state_{State::SEARCH};
+    uint32_t sync_bits_{0};
+    bool invert_{false};
+    std::array<uint8_t, MAX_BLOCK> block_;
+    uint8_t index_{0};
+    uint8_t bits_{0};
+    uint8_t block_size_{0};
+    uint8_t block_number_{0};
+    Layout layout_;
+    hdlc::IoFrame* frame_{nullptr};
+
+    hdlc::IoFrame* operator()(bool bit);
+
+    bool active() const { return state_ != State::SEARCH; }
+
+    void reset();
+
+private:
+    hdlc::IoFrame* decode_header();
+    hdlc::IoFrame* decode_payload();
+};
+
+}}} // mobilinkd::tnc::il2p
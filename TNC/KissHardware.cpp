@@ -9,10 +9,12 @@
 #include "ModulatorTask.hpp"
 #include "Modulator.hpp"
 #include "HDLCEncoder.hpp"
+#include "RunTimeStats.hpp"
 #ifndef NUCLEOTNC
 #include "KissHardware.h"
 #endif
 
+#include <algorithm>
 #include <array>
 #include <cstdio>
 #include <cstring>
@@ -171,21 +173,270 @@ void ext_reply(const std::array<uint8_t, M>& cmd, const std::array<uint8_t, N>&
     ioport->write(data.data(), M + N, 6, osWaitForever);
 }
 
+void reply_adc_stats() {
+    auto& stats = audio::adc_stats;
+    uint8_t data[18];
+    data[0] = hardware::GET_ADC_STATS;
+    auto put32 = [&data](size_t index, uint32_t value) {
+        data[index] = (value >> 24) & 0xFF;
+        data[index + 1] = (value >> 16) & 0xFF;
+        data[index + 2] = (value >> 8) & 0xFF;
+        data[index + 3] = value & 0xFF;
+    };
+    put32(1, stats.dropped);
+    put32(5, stats.overruns);
+    put32(9, stats.gaps);
+    put32(13, stats.max_latency);
+    data[17] = stats.queue_high_water;
+    ioport->write(data, sizeof(data), 6, osWaitForever);
+}
+
+void reply_modem_switch_stats() {
+    auto& stats = modem_switch_stats;
+    uint8_t data[17];
+    data[0] = hardware::GET_MODEM_SWITCH_STATS;
+    auto put32 = [&data](size_t index, uint32_t value) {
+        data[index] = (value >> 24) & 0xFF;
+        data[index + 1] = (value >> 16) & 0xFF;
+        data[index + 2] = (value >> 8) & 0xFF;
+        data[index + 3] = value & 0xFF;
+    };
+    put32(1, stats.switches);
+    put32(5, stats.last_us);
+    put32(9, stats.max_us);
+    put32(13, stats.init_us);
+    ioport->write(data, sizeof(data), 6, osWaitForever);
+}
+
+/**
+ * GET_TASK_STATS reply, big-endian:
+ *
+ *   uint32_t interval (ms) since the previous poll
+ *   uint16_t time in pool critical sections (0.01%)
+ *   uint32_t pool critical sections entered
+ *   uint32_t longest pool critical section (CPU cycles)
+ *   uint8_t  task count, then for each task:
+ *     uint8_t  task number
+ *     uint16_t CPU use (0.01%)
+ *     uint16_t stack high-water mark (free words)
+ *     uint8_t  name length, then the name
+ */
+void reply_task_stats() {
+    static uint8_t data[16 + RunTimeStats::MAX_TASKS * (6 + configMAX_TASK_NAME_LEN)];
+
+    auto& stats = pollRunTimeStats();
+    size_t index = 0;
+    auto put8 = [&index](uint8_t value) { data[index++] = value; };
+    auto put16 = [&put8](uint16_t value) {
+        put8(value >> 8);
+        put8(value & 0xFF);
+    };
+    auto put32 = [&put16](uint32_t value) {
+        put16(value >> 16);
+        put16(value & 0xFFFF);
+    };
+
+    put8(hardware::GET_TASK_STATS);
+    put32(stats.interval_ms);
+    put16(stats.critical_load);
+    put32(stats.critical_count);
+    put32(stats.critical_max);
+    put8(stats.task_count);
+    for (size_t i = 0; i != stats.task_count; ++i) {
+        auto& task = stats.tasks[i];
+        size_t length = strnlen(task.name, configMAX_TASK_NAME_LEN);
+        put8(task.number);
+        put16(task.cpu);
+        put16(task.stack_free);
+        put8(length);
+        memcpy(data + index, task.name, length);
+        index += length;
+    }
+    ioport->write(data, index, 6, osWaitForever);
+}
+
+/**
+ * GET_IDLE_SLEEP_STATS reply, big-endian, since the last SET_IDLE_SLEEP:
+ *
+ *   uint8_t  IdleSleepMode
+ *   uint32_t sleeps
+ *   uint32_t sleeps abandoned because a task became ready
+ *   uint16_t time asleep (0.01%)
+ *   uint32_t longest tickless sleep (ticks)
+ *   uint32_t longest delay from wake to interrupts enabled (CPU cycles)
+ *   uint32_t worst ADC block latency (us), as in GET_ADC_STATS
+ *
+ * The time asleep is the power figure: the core draws its run current
+ * only for the rest.
+ */
+void reply_idle_sleep_stats() {
+    taskENTER_CRITICAL();
+    auto stats = idle_sleep_stats;
+    uint32_t interval = getRunTimeCounterValue() - stats.start;
+    taskEXIT_CRITICAL();
+
+    // The run-time counter is DWT cycles / 64.
+    uint64_t asleep = stats.asleep_cycles >> 6;
+    uint16_t load = interval ? std::min<uint64_t>(asleep * 10000 / interval, 10000) : 0;
+
+    uint8_t data[24];
+    data[0] = hardware::GET_IDLE_SLEEP_STATS;
+    auto put32 = [&data](size_t index, uint32_t value) {
+        data[index] = (value >> 24) & 0xFF;
+        data[index + 1] = (value >> 16) & 0xFF;
+        data[index + 2] = (value >> 8) & 0xFF;
+        data[index + 3] = value & 0xFF;
+    };
+    data[1] = idle_sleep_mode;
+    put32(2, stats.sleeps);
+    put32(6, stats.aborts);
+    data[10] = load >> 8;
+    data[11] = load & 0xFF;
+    put32(12, stats.max_ticks);
+    put32(16, stats.max_wake_cycles);
+    put32(20, audio::adc_stats.max_latency);
+    ioport->write(data, sizeof(data), 6, osWaitForever);
+}
+
+void Hardware::get_aliases() {
+    ext_reply(hardware::EXT_GET_ALIASES, uint8_t(NUMBER_OF_ALIASES));
+}
+
 void Hardware::get_alias(uint8_t alias) {
-    uint8_t result[14];
+    std::array<uint8_t, 14> result;
     if (alias >= NUMBER_OF_ALIASES or not aliases[alias].set) return;
     result[0] = alias;
-    memcpy(result + 1, aliases[alias].call.data(), aliases[alias].call.size());
+    memcpy(result.data() + 1, aliases[alias].call.data(), aliases[alias].call.size());
     result[9] = aliases[alias].set;
     result[10] = aliases[alias].use;
     result[11] = aliases[alias].insert_id;
     result[12] = aliases[alias].preempt;
     result[13] = aliases[alias].hops;
-    reply_ext(hardware::EXT_GET_ALIASES, result, 14);
+    ext_reply(hardware::EXT_GET_ALIAS, result);
+}
+
+/**
+ * Alias number, 8 characters (NUL padded), then set, use, insert_id,
+ * preempt and hops.  Clearing "set" removes the alias.
+ */
+void Hardware::set_alias(hdlc::IoFrame* frame) {
+    if (frame->size() != 16) {
+        ERROR("Invalid alias (%d bytes)", int(frame->size()));
+        return;
+    }
+
+    auto it = frame->begin();
+    std::advance(it, 2);
+    uint8_t number = *it++;
+    if (number >= NUMBER_OF_ALIASES) {
+        ERROR("Invalid alias number %d", int(number));
+        return;
+    }
+
+    auto& alias = aliases[number];
+    for (auto& c : alias.call) c = *it++;
+    alias.set = *it++;
+    alias.use = *it++;
+    alias.insert_id = *it++;
+    alias.preempt = *it++;
+    alias.hops = *it;
+    if (!alias.set) memset(&alias, 0, sizeof(alias));
+    update_crc();
+
+    get_alias(number);
+}
+
+void Hardware::get_mycall() {
+    std::array<uint8_t, CALLSIGN_LEN> result;
+    std::copy(mycall.begin(), mycall.end(), result.begin());
+    ext_reply(hardware::EXT_GET_MYCALL, result);
+}
+
+void Hardware::set_mycall(hdlc::IoFrame* frame) {
+    if (frame->size() < 3 or frame->size() > CALLSIGN_LEN + 2) {
+        ERROR("Invalid callsign (%d bytes)", int(frame->size()));
+        return;
+    }
+
+    auto it = frame->begin();
+    std::advance(it, 2);
+    mycall.fill(0);
+    std::copy(it, frame->end(), mycall.begin());
+    update_crc();
+}
+
+void Hardware::get_beacon_slots() {
+    ext_reply(hardware::EXT_GET_BEACON_SLOTS, uint8_t(NUMBER_OF_BEACONS));
 }
 
-void Hardware::set_alias(const hdlc::IoFrame* frame) {
-  UNUSED(frame);
+void Hardware::get_beacon(uint8_t number) {
+    if (number >= NUMBER_OF_BEACONS) return;
+    auto& beacon = beacons[number];
+
+    std::array<uint8_t, 5 + CALLSIGN_LEN + sizeof(beacon.path) + sizeof(beacon.text) + 1> data;
+    auto it = std::copy(std::begin(hardware::EXT_GET_BEACON), std::end(hardware::EXT_GET_BEACON), data.begin());
+    *it++ = number;
+    *it++ = (beacon.seconds >> 8) & 0xFF;
+    *it++ = beacon.seconds & 0xFF;
+    it = std::copy_n(beacon.dest.begin(), strnlen(beacon.dest.data(), CALLSIGN_LEN), it);
+    *it++ = 0;
+    auto path = reinterpret_cast<const char*>(beacon.path);
+    it = std::copy_n(beacon.path, strnlen(path, BEACON_PATH_LEN), it);
+    *it++ = 0;
+    auto text = reinterpret_cast<const char*>(beacon.text);
+    it = std::copy_n(beacon.text, strnlen(text, BEACON_TEXT_LEN), it);
+    *it++ = 0;
+    ioport->write(data.data(), it - data.begin(), 6, osWaitForever);
+}
+
+/**
+ * Beacon number, uint16_t interval in seconds (big endian), then the
+ * destination, path and text as NUL terminated strings.  An interval of
+ * 0 disables the beacon.  The beacon scheduler picks up the change.
+ */
+void Hardware::set_beacon(hdlc::IoFrame* frame) {
+    if (frame->size() < 6) {
+        ERROR("Invalid beacon (%d bytes)", int(frame->size()));
+        return;
+    }
+
+    auto it = frame->begin();
+    std::advance(it, 2);
+    uint8_t number = *it++;
+    if (number >= NUMBER_OF_BEACONS) {
+        ERROR("Invalid beacon number %d", int(number));
+        return;
+    }
+
+    Beacon beacon;
+    memset(&beacon, 0, sizeof(beacon));
+    beacon.seconds = uint16_t(*it++) << 8;
+    beacon.seconds |= *it++;
+
+    // Copy one NUL terminated string; the last one may end with the frame.
+    auto copy = [&it, frame](uint8_t* dest, size_t size) {
+        size_t i = 0;
+        while (it != frame->end()) {
+            uint8_t c = *it++;
+            if (c == 0) return true;
+            if (i == size) return false;
+            dest[i++] = c;
+        }
+        return true;
+    };
+
+    if (!copy(reinterpret_cast<uint8_t*>(beacon.dest.data()), CALLSIGN_LEN)
+        or !copy(beacon.path, BEACON_PATH_LEN)
+        or !copy(beacon.text, BEACON_TEXT_LEN)) {
+        ERROR("Invalid beacon %d", int(number));
+        return;
+    }
+
+    if (beacon.seconds == 0) memset(&beacon, 0, sizeof(beacon));
+    beacons[number] = beacon;
+    update_crc();
+
+    get_beacon(number);
 }
 
 void Hardware::announce_input_settings()
@@ -290,8 +541,47 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         TNC_DEBUG("STREAM_DCD_VALUE");
         break;
 
+    case hardware::GET_EQUALIZER:
+      TNC_DEBUG("GET_EQUALIZER");
+      osMessagePut(audioInputQueueHandle, audio::POLL_EQUALIZER,
+          osWaitForever);
+      osMessagePut(audioInputQueueHandle, audio::DEMODULATOR,
+          osWaitForever);
+        break;
+
+    case hardware::GET_ADC_STATS:
+        TNC_DEBUG("GET_ADC_STATS");
+        reply_adc_stats();
+        break;
+
+    case hardware::GET_MODEM_SWITCH_STATS:
+        TNC_DEBUG("GET_MODEM_SWITCH_STATS");
+        reply_modem_switch_stats();
+        break;
+
+    case hardware::GET_TASK_STATS:
+        TNC_DEBUG("GET_TASK_STATS");
+        reply_task_stats();
+        break;
+
+    case hardware::SET_IDLE_SLEEP:
+        TNC_DEBUG("SET_IDLE_SLEEP = %d", int(*it));
+        if (*it > IDLE_SLEEP_TICKLESS) {
+            ERROR("Invalid idle sleep mode %d", int(*it));
+            break;
+        }
+        idle_sleep_mode = *it;
+        resetIdleSleepStats();
+        audio::adc_stats.max_latency = 0;
+        [[fallthrough]];
+    case hardware::GET_IDLE_SLEEP_STATS:
+        TNC_DEBUG("GET_IDLE_SLEEP_STATS");
+        reply_idle_sleep_stats();
+        break;
+
     case hardware::POLL_INPUT_TWIST:
       TNC_DEBUG("POLL_INPUT_TWIST");
+      if (audio::pollTwistEstimate()) break;
       osMessagePut(audioInputQueueHandle, audio::POLL_TWIST_LEVEL,
           osWaitForever);
       osMessagePut(audioInputQueueHandle, audio::DEMODULATOR,
@@ -353,7 +643,7 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         if (tx_twist < 0) tx_twist = 0;
         if (tx_twist > 100) tx_twist = 100;
         TNC_DEBUG("SET_OUTPUT_TWIST: %d", int(tx_twist));
-        getModulator().init(*this);
+        initModulators();
         update_crc();
         [[fallthrough]];
     case hardware::GET_OUTPUT_TWIST:
@@ -461,6 +751,7 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         } else {
           options &= ~KISS_OPTION_TX_REV_POLARITY;
         }
+        initModulators();
         update_crc();
         [[fallthrough]];
     case hardware::GET_TX_REV_POLARITY:
@@ -468,6 +759,40 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         reply8(hardware::GET_TX_REV_POLARITY, options & KISS_OPTION_TX_REV_POLARITY ? 1 : 0);
         break;
 
+    case hardware::SET_FX25:
+        TNC_DEBUG("SET_FX25");
+        {
+            uint16_t value = 0;
+            switch (*it) {
+            case 16: value = 1; break;
+            case 32: value = 2; break;
+            case 64: value = 3; break;
+            default: break;
+            }
+            options &= ~KISS_OPTION_FX25_MASK;
+            options |= value << KISS_OPTION_FX25_SHIFT;
+        }
+        update_crc();
+        [[fallthrough]];
+    case hardware::GET_FX25:
+        TNC_DEBUG("GET_FX25");
+        reply8(hardware::GET_FX25, fx25_parity());
+        break;
+
+    case hardware::SET_AGC:
+        TNC_DEBUG("SET_AGC");
+        if (*it) {
+          options |= KISS_OPTION_AGC;
+        } else {
+          options &= ~KISS_OPTION_AGC;
+        }
+        update_crc();
+        [[fallthrough]];
+    case hardware::GET_AGC:
+        TNC_DEBUG("GET_AGC");
+        reply8(hardware::GET_AGC, options & KISS_OPTION_AGC ? 1 : 0);
+        break;
+
 #ifndef NUCLEOTNC
     case hardware::SET_USB_POWER_OFF:
         TNC_DEBUG("SET_USB_POWER_OFF");
@@ -542,10 +867,13 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
             hardware::CAP_ADJUST_INPUT|
             hardware::CAP_DFU_FIRMWARE);
 #endif
-        osMessagePut(audioInputQueueHandle, audio::POLL_TWIST_LEVEL,
-            osWaitForever);
-        osMessagePut(audioInputQueueHandle, audio::IDLE,
-            osWaitForever);
+        if (!audio::pollTwistEstimate())
+        {
+            osMessagePut(audioInputQueueHandle, audio::POLL_TWIST_LEVEL,
+                osWaitForever);
+            osMessagePut(audioInputQueueHandle, audio::IDLE,
+                osWaitForever);
+        }
         reply(hardware::GET_FIRMWARE_VERSION, (uint8_t*) FIRMWARE_VERSION,
           sizeof(FIRMWARE_VERSION) - 1);
         reply(hardware::GET_HARDWARE_VERSION, (uint8_t*) HARDWARE_VERSION,
@@ -570,6 +898,7 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         reply8(hardware::GET_MAX_INPUT_TWIST, 9);   // Constants for this FW
         ext_reply(hardware::EXT_GET_MODEM_TYPE, modem_type);
         ext_reply(hardware::EXT_GET_MODEM_TYPES, supported_modem_types);
+        ext_reply(hardware::EXT_GET_FRAMING, framing());
         if (*error_message) {
             reply(hardware::GET_ERROR_MSG, (uint8_t*) error_message, sizeof(error_message));
         }
@@ -577,6 +906,8 @@ void Hardware::handle_request(hdlc::IoFrame* frame)
         reply(hardware::GET_DATETIME, get_rtc_datetime(), 7);
         reply8(hardware::GET_RX_REV_POLARITY, options & KISS_OPTION_RX_REV_POLARITY ? 1 : 0);
         reply8(hardware::GET_TX_REV_POLARITY, options & KISS_OPTION_TX_REV_POLARITY ? 1 : 0);
+        reply8(hardware::GET_FX25, fx25_parity());
+        reply8(hardware::GET_AGC, options & KISS_OPTION_AGC ? 1 : 0);
         break;
     default:
         if (command > 0xC0)
@@ -600,9 +931,8 @@ void Hardware::handle_ext_request(hdlc::IoFrame* frame) {
 
     case hardware::EXT_SET_MODEM_TYPE[1]:
         TNC_DEBUG("SET_MODEM_TYPE");
-        if ((*it == hardware::MODEM_TYPE_1200)
-            or (*it == hardware::MODEM_TYPE_9600)
-            or (*it == hardware::MODEM_TYPE_M17))
+        if (std::find(supported_modem_types.begin(), supported_modem_types.end(), *it)
+            != supported_modem_types.end())
         {
             modem_type = *it;
             TNC_DEBUG(modem_type_lookup[modem_type]);
@@ -624,6 +954,57 @@ void Hardware::handle_ext_request(hdlc::IoFrame* frame) {
         TNC_DEBUG("EXT_GET_MODEM_TYPES");
         ext_reply(hardware::EXT_GET_MODEM_TYPES, supported_modem_types);
         break;
+    case hardware::EXT_SET_FRAMING[1]:
+        TNC_DEBUG("EXT_SET_FRAMING");
+        if (*it <= hardware::FRAMING_IL2P_MAX_FEC)
+        {
+            options &= ~KISS_OPTION_FRAMING_MASK;
+            options |= uint16_t(*it) << KISS_OPTION_FRAMING_SHIFT;
+            update_crc();
+        }
+        else
+        {
+            ERROR("Unsupported framing");
+        }
+        osMessagePut(audioInputQueueHandle, audio::UPDATE_SETTINGS, // Reset decoder/demodulator.
+            osWaitForever);
+        [[fallthrough]];
+    case hardware::EXT_GET_FRAMING[1]:
+        TNC_DEBUG("EXT_GET_FRAMING");
+        ext_reply(hardware::EXT_GET_FRAMING, framing());
+        break;
+    case hardware::EXT_SET_MYCALL[1]:
+        TNC_DEBUG("EXT_SET_MYCALL");
+        set_mycall(frame);
+        [[fallthrough]];
+    case hardware::EXT_GET_MYCALL[1]:
+        TNC_DEBUG("EXT_GET_MYCALL");
+        get_mycall();
+        break;
+    case hardware::EXT_GET_ALIASES[1]:
+        TNC_DEBUG("EXT_GET_ALIASES");
+        get_aliases();
+        break;
+    case hardware::EXT_GET_ALIAS[1]:
+        TNC_DEBUG("EXT_GET_ALIAS");
+        get_alias(*it);
+        break;
+    case hardware::EXT_SET_ALIAS[1]:
+        TNC_DEBUG("EXT_SET_ALIAS");
+        set_alias(frame);
+        break;
+    case hardware::EXT_GET_BEACON_SLOTS[1]:
+        TNC_DEBUG("EXT_GET_BEACON_SLOTS");
+        get_beacon_slots();
+        break;
+    case hardware::EXT_GET_BEACON[1]:
+        TNC_DEBUG("EXT_GET_BEACON");
+        get_beacon(*it);
+        break;
+    case hardware::EXT_SET_BEACON[1]:
+        TNC_DEBUG("EXT_SET_BEACON");
+        set_beacon(frame);
+        break;
     default:
         ERROR("Unknown extended hardware request");
     }
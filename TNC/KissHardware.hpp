@@ -107,6 +107,12 @@ constexpr const uint8_t SET_DATETIME = 50;
 constexpr const uint8_t GET_ERROR_MSG = 51;
 constexpr const uint8_t GET_SNR = 52;
 constexpr const uint8_t GET_BER = 53;
+constexpr const uint8_t GET_EQUALIZER = 54;   ///< int16_t[] Q14 taps (9600 baud).
+constexpr const uint8_t GET_ADC_STATS = 55;   ///< uint32_t dropped, overruns, gaps, max latency (us); uint8_t queue high water.
+constexpr const uint8_t GET_MODEM_SWITCH_STATS = 56;  ///< uint32_t switches, last (us), max (us), last full init (us).
+constexpr const uint8_t GET_TASK_STATS = 57;  ///< See reply_task_stats().
+constexpr const uint8_t SET_IDLE_SLEEP = 58;  ///< IdleSleepMode; resets the sleep stats.  Not stored.
+constexpr const uint8_t GET_IDLE_SLEEP_STATS = 59;    ///< See reply_idle_sleep_stats().
 
 constexpr const uint8_t SET_BLUETOOTH_NAME = 65;
 constexpr const uint8_t GET_BLUETOOTH_NAME = 66;
@@ -133,6 +139,10 @@ constexpr const uint8_t SET_RX_REV_POLARITY = 83;   // Reverse RX polarity for
 constexpr const uint8_t GET_RX_REV_POLARITY = 84;   // 4-FSK modes when true (1).
 constexpr const uint8_t SET_TX_REV_POLARITY = 85;   // Reverse TX polarity for
 constexpr const uint8_t GET_TX_REV_POLARITY = 86;   // 4-FSK modes when true (1).
+constexpr const uint8_t SET_FX25 = 87;      // FX.25 parity bytes for AFSK1200
+constexpr const uint8_t GET_FX25 = 88;      // (0 = off, 16, 32 or 64).
+constexpr const uint8_t SET_AGC = 89;       // Adjust input gain from received
+constexpr const uint8_t GET_AGC = 90;       // frame levels when true (1).
 
 constexpr const uint8_t GET_MIN_OUTPUT_TWIST = 119;  ///< int8_t (may be negative).
 constexpr const uint8_t GET_MAX_OUTPUT_TWIST = 120;  ///< int8_t (may be negative).
@@ -165,6 +175,10 @@ constexpr const uint8_t EXT_OK = 0x80;
 constexpr std::array<uint8_t, 2> EXT_GET_MODEM_TYPE = {0xC1, 0x81};
 constexpr std::array<uint8_t, 2> EXT_SET_MODEM_TYPE = {0xC1, 0x82};
 constexpr std::array<uint8_t, 2> EXT_GET_MODEM_TYPES = {0xC1, 0x83};    ///< Return a list of supported modem types
+constexpr std::array<uint8_t, 2> EXT_GET_FRAMING = {0xC1, 0x84};        ///< Link layer framing (FRAMING_*)
+constexpr std::array<uint8_t, 2> EXT_SET_FRAMING = {0xC1, 0x85};        ///< Link layer framing (FRAMING_*)
+constexpr std::array<uint8_t, 2> EXT_GET_MYCALL = {0xC1, 0x86};         ///< Station callsign, up to 8 characters (CALL-SSID)
+constexpr std::array<uint8_t, 2> EXT_SET_MYCALL = {0xC1, 0x87};         ///< Station callsign, up to 8 characters (CALL-SSID)
 
 constexpr std::array<uint8_t, 2> EXT_GET_ALIASES = {0xC1, 0x88};        ///< Number of aliases supported
 constexpr std::array<uint8_t, 2> EXT_GET_ALIAS = {0xC1, 0x89};          ///< Alias number (uint8_t), 8 characters, 5 bytes (set, use, insert_id, preempt, hops)
@@ -184,6 +198,17 @@ constexpr uint8_t MODEM_TYPE_300 = 2;
 constexpr uint8_t MODEM_TYPE_9600 = 3;
 constexpr uint8_t MODEM_TYPE_PSK31 = 4;
 constexpr uint8_t MODEM_TYPE_M17 = 5;
+constexpr uint8_t MODEM_TYPE_4800 = 6;
+constexpr uint8_t MODEM_TYPE_19200 = 7;   ///< UHF backbone links.
+constexpr uint8_t MODEM_TYPE_1200_M17 = 8; ///< Receive AFSK1200 and M17 at once; transmit AFSK1200 on KISS port 0, M17 on others.
+
+/*
+ * Link layer framing.  IL2P is only used with the G3RUH FSK modems; the
+ * other modems always use HDLC.
+ */
+constexpr uint8_t FRAMING_HDLC = 0;
+constexpr uint8_t FRAMING_IL2P = 1;           ///< IL2P, parity sized to the blocks.
+constexpr uint8_t FRAMING_IL2P_MAX_FEC = 2;   ///< IL2P, 16 parity bytes per block.
 
 // Boolean options.
 #define KISS_OPTION_CONN_TRACK      0x01
@@ -194,6 +219,11 @@ constexpr uint8_t MODEM_TYPE_M17 = 5;
 #define KISS_OPTION_PASSALL         0x20  // Ignore invalid CRC.
 #define KISS_OPTION_RX_REV_POLARITY 0x40  // Reverse Polarity on RX when set.
 #define KISS_OPTION_TX_REV_POLARITY 0x80  // Reverse Polarity on TX when set.
+#define KISS_OPTION_FX25_MASK       0x0300  // FX.25 TX parity (0 = off, 16 << (n - 1) bytes).
+#define KISS_OPTION_FX25_SHIFT      8
+#define KISS_OPTION_FRAMING_MASK    0x0C00  // Framing (FRAMING_*).
+#define KISS_OPTION_FRAMING_SHIFT   10
+#define KISS_OPTION_AGC             0x1000  // Background input gain control.
 
 #ifndef NUCLEOTNC
 const char TOCALL[] = "APML30"; // Update for every feature change.
@@ -234,13 +264,16 @@ const size_t NUMBER_OF_BEACONS = 4;     // 680 bytes
  */
 struct Hardware
 {
-    static constexpr std::array<const char*, 6> modem_type_lookup = {
+    static constexpr std::array<const char*, 9> modem_type_lookup = {
         "NOT SET",
         "AFSK1200",
         "AFSK300",
         "FSK9600",
         "PSK31",
-        "M17"
+        "M17",
+        "FSK4800",
+        "FSK19200",
+        "AFSK1200+M17"
     };
 
     // This must match the constants defined above.
@@ -249,13 +282,20 @@ struct Hardware
         AFSK300 = hardware::MODEM_TYPE_300,
         FSK9600 = hardware::MODEM_TYPE_9600,
         PSK31 = hardware::MODEM_TYPE_PSK31,
-        M17 = hardware::MODEM_TYPE_M17
+        M17 = hardware::MODEM_TYPE_M17,
+        FSK4800 = hardware::MODEM_TYPE_4800,
+        FSK19200 = hardware::MODEM_TYPE_19200,
+        AFSK1200_M17 = hardware::MODEM_TYPE_1200_M17
     };
 
-    static constexpr std::array<uint8_t, 3> supported_modem_types = {
+    static constexpr std::array<uint8_t, 7> supported_modem_types = {
         hardware::MODEM_TYPE_1200,
+        hardware::MODEM_TYPE_300,
         hardware::MODEM_TYPE_9600,
-        hardware::MODEM_TYPE_M17
+        hardware::MODEM_TYPE_M17,
+        hardware::MODEM_TYPE_4800,
+        hardware::MODEM_TYPE_19200,
+        hardware::MODEM_TYPE_1200_M17
     };
 
     uint8_t txdelay;        ///< How long in 10mS units to wait for TX to settle before starting data
@@ -385,7 +425,12 @@ struct Hardware
 
     void get_aliases();
     void get_alias(uint8_t alias);
-    void set_alias(const hdlc::IoFrame* frame);
+    void set_alias(hdlc::IoFrame* frame);
+    void get_mycall();
+    void set_mycall(hdlc::IoFrame* frame);
+    void get_beacon_slots();
+    void get_beacon(uint8_t number);
+    void set_beacon(hdlc::IoFrame* frame);
 
     bool rx_rev_polarity() const
     {
@@ -397,6 +442,27 @@ struct Hardware
         return (options & KISS_OPTION_TX_REV_POLARITY) != 0;
     }
 
+    /// Number of FX.25 parity bytes to send; 0 when FX.25 is off.
+    uint8_t fx25_parity() const
+    {
+        uint8_t value = (options & KISS_OPTION_FX25_MASK) >> KISS_OPTION_FX25_SHIFT;
+        return value ? (8 << value) : 0;
+    }
+
+    uint8_t framing() const
+    {
+        return (options & KISS_OPTION_FRAMING_MASK) >> KISS_OPTION_FRAMING_SHIFT;
+    }
+
+    /// IL2P framing is selected and the modem supports it.
+    bool il2p() const
+    {
+        if (framing() == hardware::FRAMING_HDLC) return false;
+        return modem_type == ModemType::FSK4800
+            or modem_type == ModemType::FSK9600
+            or modem_type == ModemType::FSK19200;
+    }
+
     void announce_input_settings();
 
 }; // 812 bytes
@@ -26,6 +26,22 @@ extern const std::array<float, FILTER_TAP_NUM_9> rrc_taps_f9;
 extern const std::array<float, FILTER_TAP_NUM_11> rrc_taps_f11;
 extern const std::array<float, FILTER_TAP_NUM_15> rrc_taps_f15;
 
+/**
+ * Scale of the q15 receive RRC taps: q15 tap = float tap / RRC_Q15_SCALE.
+ * The float taps have a worst-case gain of about 13.7; scaling them by
+ * 16367 / 2 keeps a full-scale (14-bit) input from saturating the filter
+ * output or its 32-bit accumulator.
+ */
+constexpr float RRC_Q15_SCALE = 2.f / 16367.f;
+
+/**
+ * The q15 receive RRC taps, rounded from rrc_taps_f so that the float and
+ * q15 chains use the same filter, and multiplied by @p polarity.
+ * (rrc_taps is an even-length design, half a sample later than
+ * rrc_taps_f.)
+ */
+std::array<int16_t, FILTER_TAP_NUM> make_rrc_taps_q15(int8_t polarity);
+
 constexpr std::array<uint8_t, 2> LSF_SYNC = { 0x55, 0xF7 };
 constexpr std::array<uint8_t, 2> STREAM_SYNC = { 0xFF, 0x5D };
 constexpr std::array<uint8_t, 2> PACKET_SYNC = { 0x75, 0xFF };
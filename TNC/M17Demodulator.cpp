@@ -4,6 +4,7 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wvolatile"
 
+#include "AgcSupervisor.hpp"
 #include "AudioLevel.hpp"
 #include "M17Demodulator.h"
 #include "Util.h"
@@ -23,9 +24,8 @@ namespace mobilinkd { namespace tnc {
 //m17::Indicator dcd_indicator{GPIOA, GPIO_PIN_2};
 //m17::Indicator str_indicator{GPIOA, GPIO_PIN_7};
 
-static float scale = 1.f / 32768.f;
-
-static float dc_block(float x)
+template <typename T>
+static T dc_block(T x)
 {
 #if 1
     return x;
@@ -41,6 +41,13 @@ static float dc_block(float x)
 #endif
 }
 
+void M17Demodulator::init()
+{
+    passall(kiss::settings().options & KISS_OPTION_PASSALL);
+    polarity = kiss::settings().rx_rev_polarity() ? -1 : 1;
+    demod_filter.init(polarity);
+}
+
 void M17Demodulator::start()
 {
     SysClock48();
@@ -48,11 +55,7 @@ void M17Demodulator::start()
     HAL_RCCEx_DisableLSCO();
 #endif
 
-    demod_filter.init(m17::rrc_taps_f);
-    passall(kiss::settings().options & KISS_OPTION_PASSALL);
-    polarity = kiss::settings().rx_rev_polarity() ? -1 : 1;
-    scale = 1.f / 32768.f * polarity;
-    audio::virtual_ground = (VREF + 1) / 2;
+    init();
 
     ADC_ChannelConfTypeDef sConfig;
 
@@ -66,7 +69,8 @@ void M17Demodulator::start()
         CxxErrorHandler();
 
     mobilinkd::adcTimerAdjust = adcTimerAdjust;
-    startADC(999, ADC_BLOCK_SIZE);
+    startADC(999, ADC_BLOCK_SIZE, true,
+        audio::adc_oversampling(audio::adc_clock(), SAMPLE_RATE, sConfig.SamplingTime));
 //    getModulator().start_loopback();
     dcd_off();
 }
@@ -89,7 +93,7 @@ void M17Demodulator::update_values(uint8_t index)
     // For deviation and offset to be accurate, this must be the stable
     // sample_index. The sync word trigger point is too noisy, resulting
     // in inaccurate frequency offset and deviation estimates.
-    correlator.apply([this,index](float t){dev.sample(t);}, sample_index);
+    correlator.apply([this,index](sample_t t){dev.sample(audio_filter_t::to_float(t));}, sample_index);
     dev.update();
     sync_sample_index = index;
 }
@@ -120,11 +124,7 @@ void M17Demodulator::dcd_off()
 
 void M17Demodulator::initialize(const q15_t* input)
 {
-    for (size_t i = 0; i != ADC_BLOCK_SIZE; i++) {
-        demod_buffer[i] = float(input[i]) * scale;
-    }
-
-    auto filtered = demod_filter(demod_buffer.data());
+    auto filtered = demod_filter(input);
     for (size_t i = 0; i != ADC_BLOCK_SIZE; ++i)
     {
         auto filtered_sample = dc_block(filtered[i]);
@@ -146,20 +146,26 @@ void M17Demodulator::update_dcd(const q15_t* input)
         dcd_off();
     }
 
+    const int16_t vgnd = audio::virtual_ground;
     for (size_t i = 0; i != ADC_BLOCK_SIZE; ++i)
     {
-        dcd(input[i] * inv);
+        dcd((input[i] - vgnd) * inv);
     }
 }
 
 [[gnu::noinline]]
 void M17Demodulator::do_unlocked()
 {
+    using m17::SyncCorrelator;
+
+    // All sync words are correlated in one pass over the correlator.
+    auto& sync = sync_correlator(correlator);
+
     // We expect to find the preamble immediately after DCD.
     if (missing_sync_count < 1920)
     {
         missing_sync_count += 1;
-        auto sync_index = preamble_sync(correlator);
+        auto sync_index = preamble_sync(correlator, sync[SyncCorrelator::PREAMBLE]);
         auto sync_updated = preamble_sync.updated();
         if (sync_updated)
         {
@@ -175,7 +181,7 @@ void M17Demodulator::do_unlocked()
         return;
     }
     // Otherwise we start searching for a sync word.
-    auto sync_index = lsf_sync(correlator);
+    auto sync_index = lsf_sync(correlator, sync[SyncCorrelator::LSF]);
     auto sync_updated = lsf_sync.updated();
     if (sync_updated)
     {
@@ -197,7 +203,7 @@ void M17Demodulator::do_unlocked()
             INFO("L sync %d", int(sync_index));
         }
     }
-    sync_index = packet_sync(correlator);
+    sync_index = packet_sync(correlator, sync[SyncCorrelator::PACKET]);
     sync_updated = packet_sync.updated();
     if (sync_updated)
     {
@@ -229,7 +235,10 @@ void M17Demodulator::do_lsf_sync()
 
     if (correlator.index() == sample_index)
     {
-        sync_triggered = preamble_sync.triggered(correlator);
+        using m17::SyncCorrelator;
+
+        auto& sync = sync_correlator(correlator);
+        sync_triggered = preamble_sync.triggered(correlator, sync[SyncCorrelator::PREAMBLE]);
         // INFO("PSync = %d", int(sync_triggered));
         if (sync_triggered > 0.1)
         {
@@ -237,8 +246,8 @@ void M17Demodulator::do_lsf_sync()
             sync_count += 1;
             return;
         }
-        sync_triggered = lsf_sync.triggered(correlator);
-        bert_triggered = packet_sync.triggered(correlator);
+        sync_triggered = lsf_sync.triggered(correlator, sync[SyncCorrelator::LSF]);
+        bert_triggered = packet_sync.triggered(correlator, sync[SyncCorrelator::PACKET]);
         if (bert_triggered < 0)
         {
             missing_sync_count = 0;
@@ -308,7 +317,11 @@ void M17Demodulator::do_stream_sync()
         return;
     }
 
-    if (eot_sync.triggered(correlator) > EOT_TRIGGER_LEVEL) {
+    using m17::SyncCorrelator;
+
+    auto& sync = sync_correlator(correlator);
+
+    if (eot_sync.triggered(correlator, sync[SyncCorrelator::EOT]) > EOT_TRIGGER_LEVEL) {
         // Note the EOT flag but continue trying to decode. This is needed
         // to avoid false triggers. If it is a true EOT, the stream will
         // end the next time we try to capture a sync word.
@@ -320,7 +333,7 @@ void M17Demodulator::do_stream_sync()
         return;
     }
 
-    uint8_t sync_index = lsf_sync(correlator);
+    uint8_t sync_index = lsf_sync(correlator, sync[SyncCorrelator::LSF]);
     int8_t sync_updated = lsf_sync.updated();
     if (sync_updated < 0)
     {
@@ -488,7 +501,7 @@ void M17Demodulator::do_sync_wait()
 }
 
 [[gnu::noinline]]
-void M17Demodulator::do_frame(float filtered_sample, hdlc::IoFrame*& frame_result)
+void M17Demodulator::do_frame(sample_t filtered_sample, hdlc::IoFrame*& frame_result)
 {
     // Only do this when there is no chance of skipping a sample. So do
     // this update as far from the sample point as possible. It should
@@ -502,7 +515,7 @@ void M17Demodulator::do_frame(float filtered_sample, hdlc::IoFrame*& frame_resul
 
     if (correlator.index() != sample_index) return;
 
-    float sample = dev.normalize(filtered_sample);
+    float sample = dev.normalize(audio_filter_t::to_float(filtered_sample));
     dev.update(sample);
 
     auto n = mobilinkd::llr<float, 4>(sample);
@@ -581,11 +594,8 @@ hdlc::IoFrame* M17Demodulator::operator()(const q15_t* input)
         return frame_result;
     }
 
-    for (size_t i = 0; i != ADC_BLOCK_SIZE; i++) {
-        demod_buffer[i] = float(input[i]) * scale;
-    }
-
-    auto filtered = demod_filter(demod_buffer.data());
+    auto filtered = demod_filter(input);
+    audio::agcSupervisor().measure(filtered, ADC_BLOCK_SIZE);
 //    getModulator().loopback(filtered);
 
     for (size_t i = 0; i != ADC_BLOCK_SIZE; ++i)
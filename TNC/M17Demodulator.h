@@ -26,11 +26,79 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <optional>
 #include <tuple>
 
 namespace mobilinkd { namespace tnc {
 
+namespace m17 {
+
+/**
+ * The M17 matched (RRC) filter for the receive chain sample type.
+ *
+ * Both take raw ADC samples and remove the virtual ground offset.  The
+ * float version scales the ADC samples and filters them with the
+ * floating point taps.  The q15 version filters the ADC samples directly
+ * with arm_fir_fast_q15; the receive polarity is folded into the taps when
+ * the demodulator is started.
+ *
+ * to_float() converts a filtered sample to the scale of the floating point
+ * chain.  It is used only at the symbol rate, where the samples are handed
+ * to the deviation estimator.
+ */
+template <typename SampleType, size_t BlockSize>
+struct RrcFilter;
+
+template <size_t BlockSize>
+struct RrcFilter<float, BlockSize>
+{
+    FirFilter<BlockSize, FILTER_TAP_NUM> filter;
+    std::array<float, BlockSize> buffer;
+    float scale = 1.f / 32768.f;
+
+    void init(int8_t polarity)
+    {
+        filter.init(rrc_taps_f);
+        scale = 1.f / 32768.f * polarity;
+    }
+
+    const float* operator()(const q15_t* input)
+    {
+        const int16_t vgnd = audio::virtual_ground;
+        for (size_t i = 0; i != BlockSize; i++) {
+            buffer[i] = float(input[i] - vgnd) * scale;
+        }
+        return filter(buffer.data());
+    }
+
+    static float to_float(float sample) { return sample; }
+};
+
+template <size_t BlockSize>
+struct RrcFilter<int16_t, BlockSize>
+{
+    static constexpr float SCALE = RRC_Q15_SCALE;
+
+    Q15FirFilter<BlockSize, FILTER_TAP_NUM> filter;
+    std::array<q15_t, FILTER_TAP_NUM> taps;
+
+    void init(int8_t polarity)
+    {
+        taps = make_rrc_taps_q15(polarity);
+        filter.init(taps.data());
+    }
+
+    const q15_t* operator()(const q15_t* input)
+    {
+        return filter.filter_adc(input);
+    }
+
+    static float to_float(q15_t sample) { return sample * SCALE; }
+};
+
+} // m17
+
 struct M17Demodulator : IDemodulator
 {
     static constexpr uint32_t ADC_BLOCK_SIZE = 192;
@@ -54,17 +122,18 @@ struct M17Demodulator : IDemodulator
     static constexpr uint8_t MAX_SYNC_COUNT = 87;
     static constexpr float EOT_TRIGGER_LEVEL = 0.1;
 
-    using audio_filter_t = FirFilter<ADC_BLOCK_SIZE, m17::FILTER_TAP_NUM>;
+    using sample_t = m17::Correlator::value_type;
+    using audio_filter_t = m17::RrcFilter<sample_t, ADC_BLOCK_SIZE>;
     using sync_word_t = SyncWord<m17::Correlator>;
 
     enum class DemodState { UNLOCKED, LSF_SYNC, STREAM_SYNC, PACKET_SYNC, BERT_SYNC, SYNC_WAIT, FRAME };
 
     audio_filter_t demod_filter;
-    std::array<float, ADC_BLOCK_SIZE> demod_buffer;
     DataCarrierDetect<float, SAMPLE_RATE, 400> dcd{2400, 3600, 0.8f, 10.0f};
     m17::ClockRecovery<float, SAMPLES_PER_SYMBOL> clock_recovery;
 
     m17::Correlator correlator;
+    m17::SyncCorrelator sync_correlator;
     sync_word_t preamble_sync{{+3,-3,+3,-3,+3,-3,+3,-3}, 29.f};
     sync_word_t lsf_sync{{+3,+3,+3,+3,-3,-3,+3,-3}, 31.f, -31.f};
     sync_word_t packet_sync{{3,-3,3,3,-3,-3,-3,-3}, 31.f, -31.f};
@@ -110,6 +179,8 @@ struct M17Demodulator : IDemodulator
     virtual ~M17Demodulator() {}
     size_t get_adc_exponent() const override { return 2; }
 
+    /// Set up the filter and decoder from the settings.
+    void init();
     void start() override;
 
     void dcd_on();
@@ -122,7 +193,7 @@ struct M17Demodulator : IDemodulator
     void do_stream_sync();
     void do_bert_sync();
     void do_sync_wait();
-    void do_frame(float filtered_sample, hdlc::IoFrame*& frame_result);
+    void do_frame(sample_t filtered_sample, hdlc::IoFrame*& frame_result);
 
     void stop() override
     {
@@ -132,6 +203,13 @@ struct M17Demodulator : IDemodulator
         mobilinkd::adcTimerAdjust = nullptr;
     }
 
+    /// Drop back to sync word search; the symbol clock is re-acquired.
+    void reset() override
+    {
+        demodState = DemodState::UNLOCKED;
+        need_clock_reset_ = true;
+    }
+
     bool locked() const override
     {
         return dcd_;
@@ -85,7 +85,19 @@ void M17Encoder::run()
 
     while (state != State::INACTIVE)
     {
-        osEvent evt = osMessageGet(input_queue, osWaitForever);
+        // Leave the frame queued if it is for the other transmit context.
+        // The encoder task must finish sending before it is suspended.
+        osEvent evt = osMessagePeek(input_queue, osWaitForever);
+        if (evt.status == osEventMessage && txModemSwitch(evt.value.p))
+        {
+            while (osMessageWaiting(m17EncoderInputQueueHandle) != 0
+                || (htim7.Instance->CR1 & TIM_CR1_CEN))
+            {
+                osDelay(1);
+            }
+            break;
+        }
+        evt = osMessageGet(input_queue, osWaitForever);
         if (evt.status == osEventMessage)
         {
             // Changing encoders when nullptr is received.
@@ -98,6 +110,7 @@ void M17Encoder::run()
             switch (frame->source())
             {
             case 0x00: // Basic packet data
+            case 0x40: // Basic packet data (AFSK1200+M17)
                 delay_ms = ((frame->size() / 25) + 1) * 40;
                 start = osKernelSysTick();
                 process_packet(frame, FrameType::BASIC_PACKET);
@@ -120,7 +133,7 @@ void M17Encoder::run()
 
             evt = osMessagePeek(input_queue, delay_ms);
             // auto num_msgs = osMessageWaiting(input_queue);
-            back2back = (evt.status == osEventMessage);
+            back2back = (evt.status == osEventMessage) && !txModemSwitch(evt.value.p);
             if (!back2back)
             {
                 if (state != State::IDLE)
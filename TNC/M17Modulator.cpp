@@ -4,6 +4,8 @@
 #include "AudioLevel.hpp"
 #include "M17Modulator.h"
 
+#include <cmath>
+
 namespace mobilinkd { namespace tnc {
 
 void M17Modulator::init(const kiss::Hardware& hw)
@@ -12,12 +14,12 @@ void M17Modulator::init(const kiss::Hardware& hw)
 
     UNUSED(hw);
 
+    // Picks up twist & polarity changes; also rebuilds the symbol table
+    // via set_gain().
+    polarity_ = kiss::settings().tx_rev_polarity() ? -1 : 1;
     audio::setAudioOutputLevel();
 
-    __HAL_TIM_SET_AUTORELOAD(&htim7, 999);
-    __HAL_TIM_SET_PRESCALER(&htim7, 0);
-
-    mobilinkd::dacTimerAdjust = dacTimerAdjust;
+    activate();
 
     DAC_ChannelConfTypeDef sConfig;
 
@@ -35,5 +37,50 @@ void M17Modulator::init(const kiss::Hardware& hw)
     if (HAL_DAC_Start(&hdac1, DAC_CHANNEL_1) != HAL_OK) CxxErrorHandler();
 }
 
+/**
+ * Set up the DAC timer for 48ksps.  M17 normally runs from the 48MHz
+ * clock; with AFSK1200+M17 it runs from the 72MHz clock used by AFSK1200.
+ * This goes by the modem type rather than the current clock, which the
+ * demodulator may not have changed yet.
+ */
+void M17Modulator::activate()
+{
+    if (kiss::settings().modem_type == kiss::Hardware::ModemType::AFSK1200_M17)
+    {
+        __HAL_TIM_SET_AUTORELOAD(&htim7, 1499);
+        mobilinkd::dacTimerAdjust = dacTimerAdjust72;
+    }
+    else
+    {
+        __HAL_TIM_SET_AUTORELOAD(&htim7, 999);
+        mobilinkd::dacTimerAdjust = dacTimerAdjust;
+    }
+    __HAL_TIM_SET_PRESCALER(&htim7, 0);
+}
+
+/**
+ * Build the polyphase symbol table.  Entry [s][j][p] is the contribution
+ * of dibit s, j symbols ago, to output phase p, in DAC units.  It uses the
+ * same coefficient indexing as arm_fir_interpolate_f32.  Twist is applied
+ * to the inner symbols and polarity to all symbols.
+ */
+void M17Modulator::update_symbol_table()
+{
+    for (uint8_t s = 0; s != ZERO_SYMBOL; ++s)
+    {
+        float symbol = symbol_skew(bits_to_symbol(s)) * polarity_ / 256.0f;
+        for (size_t j = 0; j != SPAN; ++j)
+        {
+            for (size_t phase = 0; phase != UPSAMPLE; ++phase)
+            {
+                float tap = m17::rrc_taps_f[(SPAN - j) * UPSAMPLE - 1 - phase];
+                symbol_table_[s][j][phase] = std::lround(symbol * tap * volume_ / 8);
+            }
+        }
+    }
+
+    for (auto& position : symbol_table_[ZERO_SYMBOL]) position.fill(0);
+}
+
 
 }} // mobilinkd::tnc
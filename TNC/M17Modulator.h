@@ -22,15 +22,22 @@ namespace mobilinkd { namespace tnc {
 
 /**
  * M17 modulator. Collects 16 symbols of data, upsamples by 10x using
- * an interpolating FIR filter, which is sent out via the DAC using
- * DMA.
+ * a polyphase RRC filter, which is sent out via the DAC using DMA.
+ *
+ * The filter is implemented as a lookup table of the contribution of each
+ * symbol, at each position in the filter, to each output phase.  Volume,
+ * twist and polarity are folded into the table, so the DAC interrupt only
+ * sums SPAN integers per output sample.
  */
 struct M17Modulator : Modulator
 {
     // Six buffers per M17 frame, or 12 half-buffer interrupts.
     static constexpr uint8_t UPSAMPLE = 10;
     static constexpr uint32_t BLOCKSIZE = 4;
-    static constexpr uint32_t STATE_SIZE = (m17::FILTER_TAP_NUM / UPSAMPLE) + BLOCKSIZE - 1;
+    // Number of symbols that contribute to each output sample.
+    static constexpr uint8_t SPAN = m17::FILTER_TAP_NUM / UPSAMPLE;
+    // Symbol table index for a zero (idle) symbol; 0-3 are dibits.
+    static constexpr uint8_t ZERO_SYMBOL = 4;
     // Number of bytes (4 symbol groups) to flush the FIR filter.
     static constexpr uint8_t FLUSH_LEN = ((m17::FILTER_TAP_NUM / UPSAMPLE) + 3) / 4;
     static constexpr int16_t DAC_BUFFER_LEN = 80;               // 8 symbols, 16 bits, 2 bytes.
@@ -38,26 +45,26 @@ struct M17Modulator : Modulator
     static constexpr uint16_t VREF = 4095;
     enum class State { STOPPED, STARTING, RUNNING, STOPPING };
 
-    arm_fir_interpolate_instance_f32 fir_interpolator;
-    std::array<float, STATE_SIZE> fir_state;
+    using symbol_table_type = std::array<std::array<std::array<int16_t, UPSAMPLE>, SPAN>, ZERO_SYMBOL + 1>;
+
+    symbol_table_type symbol_table_;
+    uint32_t history_ = 0;      // 3 bits per symbol table index, newest in bits 0-2.
+    int8_t polarity_ = 1;
     std::array<int16_t, DAC_BUFFER_LEN> buffer_;
-    std::array<float, 4> symbols;
     osMessageQId dacOutputQueueHandle_{0};
     PTT* ptt_{nullptr};
     uint16_t volume_{4096};
     std::atomic<uint16_t> delay_count = 0;      // TX Delay
     std::atomic<uint16_t> stop_count = 0;       // Flush the RRC matched filter.
     State state{State::STOPPED};
-    float tmp[TRANSFER_LEN];
     bool send_tone = false;
     TimerAdjust<1000, 48000, 5120> dacTimerAdjust{&htim7};
+    TimerAdjust<1500, 48000, 72000000 / 9375> dacTimerAdjust72{&htim7};   // AFSK1200+M17.
 
     M17Modulator(osMessageQId queue, PTT* ptt)
     : dacOutputQueueHandle_(queue), ptt_(ptt)
     {
-        arm_fir_interpolate_init_f32(
-            &fir_interpolator, UPSAMPLE, m17::FILTER_TAP_NUM,
-            (float32_t*) m17::rrc_taps_f.data(), fir_state.data(), BLOCKSIZE);
+        history_ = idle_history();
     }
 
     ~M17Modulator() override {}
@@ -76,6 +83,7 @@ struct M17Modulator : Modulator
     }
 
     void init(const kiss::Hardware& hw) override;
+    void activate() override;
 
     void deinit() override
     {
@@ -91,6 +99,7 @@ struct M17Modulator : Modulator
         auto v = std::max<uint16_t>(256, level);
         v = std::min<uint16_t>(4096, v);
         volume_ = v;
+        update_symbol_table();
     }
 
     void set_ptt(PTT* ptt) override
@@ -118,6 +127,7 @@ struct M17Modulator : Modulator
             HAL_RCCEx_DisableLSCO();
 #endif
             delay_count = 0;
+            history_ = idle_history();
             txdelay = kiss::settings().txdelay * 12 - 5;
             fill_empty(buffer_.data());
             fill_empty(buffer_.data() + TRANSFER_LEN);
@@ -193,6 +203,7 @@ struct M17Modulator : Modulator
             break;
         case State::STOPPED:
             stop_conversion();
+            if (hold_ptt_) break;
             ptt_->off();
 #if defined(KISS_LOGGING) && defined(HAVE_LSCO)
                 HAL_RCCEx_EnableLSCO(RCC_LSCOSOURCE_LSE);
@@ -231,6 +242,7 @@ struct M17Modulator : Modulator
             break;
         case State::STOPPED:
             stop_conversion();
+            if (hold_ptt_) break;
             ptt_->off();
 #if defined(KISS_LOGGING) && defined(HAVE_LSCO)
                 HAL_RCCEx_EnableLSCO(RCC_LSCOSOURCE_LSE);
@@ -308,6 +320,15 @@ private:
         return 0;
     }
 
+    static constexpr uint32_t idle_history()
+    {
+        uint32_t result = 0;
+        for (size_t i = 0; i != SPAN; ++i) result = (result << 3) | ZERO_SYMBOL;
+        return result;
+    }
+
+    void update_symbol_table();
+
     constexpr int16_t symbol_skew(int32_t symbol)
     {
         const size_t shift = 8;
@@ -327,10 +348,8 @@ private:
         static uint8_t pos = 0;
         static const auto Hz1000 = make_1000hz_tone();
 
-        int16_t polarity = kiss::settings().tx_rev_polarity() ? -1 : 1;
-
         for (size_t i = 0; i != TRANSFER_LEN; ++i) {
-            buffer[i] = adjust_level(Hz1000[pos++] * polarity);
+            buffer[i] = adjust_level(Hz1000[pos++] * polarity_);
             if (pos == Hz1000.size()) pos = 0;
         }
     }
@@ -346,20 +365,22 @@ private:
             return;
         }
 
-        int16_t polarity = kiss::settings().tx_rev_polarity() ? -1 : 1;
-
-        for (size_t i = 0; i != 4; ++i)
+        for (size_t i = 0; i != BLOCKSIZE; ++i)
         {
-            symbols[i] = bits_to_symbol(bits >> 6) * polarity;
+            history_ = (history_ << 3) | (bits >> 6);
             bits <<= 2;
-        }
 
-        arm_fir_interpolate_f32(
-            &fir_interpolator, symbols.data(), tmp, BLOCKSIZE);
-
-        for (size_t i = 0; i != TRANSFER_LEN; ++i)
-        {
-            buffer[i] = adjust_level(tmp[i]);
+            for (size_t phase = 0; phase != UPSAMPLE; ++phase)
+            {
+                int32_t sample = 2048;
+                uint32_t history = history_;
+                for (size_t j = 0; j != SPAN; ++j)
+                {
+                    sample += symbol_table_[history & 7][j][phase];
+                    history >>= 3;
+                }
+                *buffer++ = std::min<int32_t>(std::max<int32_t>(sample, 0), VREF);
+            }
         }
     }
 
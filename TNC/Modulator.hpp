@@ -9,6 +9,7 @@
 #include "stm32l4xx_hal.h"
 #include "cmsis_os.h"
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 
@@ -40,6 +41,22 @@ struct Modulator
      */
     virtual void init(const kiss::Hardware& hw) = 0;
 
+    /**
+     * Make an initialised modulator the active one, for modems with more
+     * than one transmit context.  Only the DAC timer is set up again; the
+     * system clock and DAC configuration are shared.  This must only be
+     * called while the DAC timer is stopped.
+     */
+    virtual void activate() { init(kiss::settings()); }
+
+    /**
+     * Keep PTT keyed, and the demodulator stopped, when the current
+     * transmission ends, because a frame for the other transmit context
+     * follows at once.  Set by the modulator task when it decides to
+     * switch contexts and cleared once the switch is made.
+     */
+    static inline std::atomic<bool> hold_ptt_{false};
+
     /**
      * Implement all functionality required to deactivate the hardware and
      * the modulator.  For example, disabling the timer used by the DAC
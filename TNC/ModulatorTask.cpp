@@ -21,6 +21,37 @@ mobilinkd::Encoder* encoder;
 
 std::function<void(void)> mobilinkd::dacTimerAdjust;
 
+ModemSwitchStats modem_switch_stats;
+
+namespace {
+
+using mobilinkd::tnc::kiss::Hardware;
+
+/*
+ * AFSK1200+M17 has two transmit contexts, chosen per frame by KISS port.
+ * Both are initialised when the modem type is set, so that changing
+ * between them only re-points the DAC timer.
+ */
+bool tx_m17 = false;            // M17 is the active transmit context.
+bool tx_switch = false;         // The encoder returned for a context switch.
+uint8_t tx_initialized = 0;     // Modem type the contexts were set up for.
+
+constexpr uint32_t TX_SWITCH_TIMEOUT = 1000;    // ms
+
+uint8_t txModemType()
+{
+    auto modem_type = mobilinkd::tnc::kiss::settings().modem_type;
+    if (modem_type != Hardware::ModemType::AFSK1200_M17) return modem_type;
+    return tx_m17 ? Hardware::ModemType::M17 : Hardware::ModemType::AFSK1200;
+}
+
+uint32_t elapsed_us(uint32_t start)
+{
+    return (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+}
+
+} // namespace
+
 /**
  * Micro-adjust the DAC timer to account for a nominal +107ppm inaccuracy
  * of the MSI in PLL mode on Nucleo32 board at 48MHz. The actual clock
@@ -63,20 +94,31 @@ extern "C" void HAL_DAC_DMAUnderrunCallbackCh1(DAC_HandleTypeDef*) {
     modulator->abort();
 }
 
-mobilinkd::tnc::Modulator& getModulator()
+namespace {
+
+mobilinkd::tnc::Modulator& modulatorFor(uint8_t modem_type)
 {
     using namespace mobilinkd::tnc;
 
     static AFSKModulator afsk1200modulator(dacOutputQueueHandle, &simplexPtt);
+    static Afsk300Modulator afsk300modulator(dacOutputQueueHandle, &simplexPtt);
+    static Fsk4800Modulator fsk4800modulator(dacOutputQueueHandle, &simplexPtt);
     static Fsk9600Modulator fsk9600modulator(dacOutputQueueHandle, &simplexPtt);
+    static Fsk19200Modulator fsk19200modulator(dacOutputQueueHandle, &simplexPtt);
     static M17Modulator m17modulator(dacOutputQueueHandle, &simplexPtt);
 
-    switch (kiss::settings().modem_type)
+    switch (modem_type)
     {
+    case kiss::Hardware::ModemType::FSK4800:
+        return fsk4800modulator;
     case kiss::Hardware::ModemType::FSK9600:
         return fsk9600modulator;
+    case kiss::Hardware::ModemType::FSK19200:
+        return fsk19200modulator;
     case kiss::Hardware::ModemType::AFSK1200:
         return afsk1200modulator;
+    case kiss::Hardware::ModemType::AFSK300:
+        return afsk300modulator;
     case kiss::Hardware::ModemType::M17:
         return m17modulator;
     default:
@@ -84,6 +126,26 @@ mobilinkd::tnc::Modulator& getModulator()
     }
 }
 
+/**
+ * Apply a setting to each transmit context, the active one last.
+ */
+template <typename F>
+void forEachModulator(F f)
+{
+    if (mobilinkd::tnc::kiss::settings().modem_type == Hardware::ModemType::AFSK1200_M17)
+    {
+        f(modulatorFor(tx_m17 ? Hardware::ModemType::AFSK1200 : Hardware::ModemType::M17));
+    }
+    f(getModulator());
+}
+
+} // namespace
+
+mobilinkd::tnc::Modulator& getModulator()
+{
+    return modulatorFor(txModemType());
+}
+
 mobilinkd::Encoder& getEncoder()
 {
     using namespace mobilinkd::tnc;
@@ -91,11 +153,14 @@ mobilinkd::Encoder& getEncoder()
     static hdlc::Encoder hdlcEncoder(hdlcOutputQueueHandle);
     static mobilinkd::M17Encoder m17Encoder(hdlcOutputQueueHandle);
 
-    switch (kiss::settings().modem_type)
+    switch (txModemType())
     {
+    case kiss::Hardware::ModemType::FSK4800:
     case kiss::Hardware::ModemType::FSK9600:
+    case kiss::Hardware::ModemType::FSK19200:
         return hdlcEncoder;
     case kiss::Hardware::ModemType::AFSK1200:
+    case kiss::Hardware::ModemType::AFSK300:
         return hdlcEncoder;
     case kiss::Hardware::ModemType::M17:
         return m17Encoder;
@@ -107,12 +172,14 @@ mobilinkd::Encoder& getEncoder()
 
 void setPtt(PTT ptt)
 {
+    using mobilinkd::tnc::Modulator;
+
     switch (ptt) {
     case PTT::SIMPLEX:
-        getModulator().set_ptt(&simplexPtt);
+        forEachModulator([](Modulator& m) { m.set_ptt(&simplexPtt); });
         break;
     case PTT::MULTIPLEX:
-        getModulator().set_ptt(&multiplexPtt);
+        forEachModulator([](Modulator& m) { m.set_ptt(&multiplexPtt); });
         break;
     }
 }
@@ -122,9 +189,21 @@ void updatePtt()
     using namespace mobilinkd::tnc::kiss;
 
     if (settings().options & KISS_OPTION_PTT_SIMPLEX)
-        getModulator().set_ptt(&simplexPtt);
+        setPtt(PTT::SIMPLEX);
     else
-        getModulator().set_ptt(&multiplexPtt);
+        setPtt(PTT::MULTIPLEX);
+}
+
+void setModulatorGain(uint16_t gain)
+{
+    forEachModulator([gain](mobilinkd::tnc::Modulator& m) { m.set_gain(gain); });
+}
+
+void initModulators()
+{
+    using mobilinkd::tnc::kiss::settings;
+
+    forEachModulator([](mobilinkd::tnc::Modulator& m) { m.init(settings()); });
 }
 
 void updateModulator()
@@ -139,18 +218,110 @@ void updateModulator()
     encoder->update_settings();
 }
 
-void startModulatorTask(void const*)
+bool txModemSwitch(void* frame)
+{
+    using mobilinkd::tnc::hdlc::IoFrame;
+
+    if (frame == nullptr) return false;
+    if (tx_initialized != Hardware::ModemType::AFSK1200_M17) return false;
+    if (mobilinkd::tnc::kiss::settings().modem_type != Hardware::ModemType::AFSK1200_M17) return false;
+
+    bool m17 = static_cast<IoFrame*>(frame)->source() != 0;
+    if (m17 == tx_m17) return false;
+    tx_switch = true;
+    mobilinkd::tnc::Modulator::hold_ptt_ = true;
+    return true;
+}
+
+namespace {
+
+void activateTxModem()
 {
     using namespace mobilinkd::tnc::kiss;
 
+    modulator = &(getModulator());
+    encoder = &(getEncoder());
+    updatePtt();
+    modulator->init(settings());
+    encoder->updateModulator();
+    encoder->update_settings();
+}
+
+/**
+ * Full set-up for the configured modem type.  For AFSK1200+M17 both
+ * transmit contexts are initialised and AFSK1200 is left active.
+ */
+void initTxModems()
+{
+    auto start = DWT->CYCCNT;
+
+    tx_switch = false;
+    tx_m17 = false;
+    tx_initialized = mobilinkd::tnc::kiss::settings().modem_type;
+
+    if (tx_initialized == Hardware::ModemType::AFSK1200_M17)
+    {
+        modulatorFor(Hardware::ModemType::M17).init(mobilinkd::tnc::kiss::settings());
+    }
+    activateTxModem();
+
+    modem_switch_stats.init_us = elapsed_us(start);
+}
+
+/**
+ * Change the transmit context.  The previous modulator stops its DAC timer
+ * once its last buffer has been sent; wait for that before re-pointing it.
+ */
+void switchTxModem()
+{
+    auto timeout = osKernelSysTick() + TX_SWITCH_TIMEOUT;
+    while (htim7.Instance->CR1 & TIM_CR1_CEN)
+    {
+        if (int32_t(osKernelSysTick() - timeout) >= 0)
+        {
+            WARN("DAC timer still running; re-initialising modulator.");
+            mobilinkd::tnc::Modulator::hold_ptt_ = false;
+            modulator->abort();
+            initTxModems();
+            return;
+        }
+        osDelay(1);
+    }
+
+    auto start = DWT->CYCCNT;
+
+    // PTT is still keyed.  The next modulator keys it again when it
+    // starts and releases it at the end of its transmission.
+    mobilinkd::tnc::Modulator::hold_ptt_ = false;
+
+    tx_m17 = !tx_m17;
+    modulator = &(getModulator());
+    encoder = &(getEncoder());
+    modulator->activate();
+    encoder->updateModulator();
+    encoder->update_settings();
+
+    auto us = elapsed_us(start);
+    modem_switch_stats.switches += 1;
+    modem_switch_stats.last_us = us;
+    if (us > modem_switch_stats.max_us) modem_switch_stats.max_us = us;
+}
+
+} // namespace
+
+void startModulatorTask(void const*)
+{
     while (true)
     {
-        modulator = &(getModulator());
-        encoder = &(getEncoder());
-        updatePtt();
-        modulator->init(settings());
-        encoder->updateModulator();
-        encoder->update_settings();
+        if (tx_switch)
+        {
+            tx_switch = false;
+            switchTxModem();
+        }
+        else
+        {
+            initTxModems();
+        }
         encoder->run();
     }
 }
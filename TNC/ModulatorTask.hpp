@@ -36,6 +36,28 @@ void setPtt(PTT ptt);
 void updatePtt(void);
 void updateModulator(void);
 
+/// Settings shared by every transmit context (see AFSK1200+M17).
+void setModulatorGain(uint16_t gain);
+void initModulators(void);
+
+/**
+ * Called by the encoders with the next frame to send.  Returns true if the
+ * frame needs the other transmit context (AFSK1200+M17 only), in which
+ * case the encoder must return from run() without taking the frame.
+ */
+bool txModemSwitch(void* frame);
+
+/// Transmit context switch timing, in microseconds (DWT cycle counter).
+struct ModemSwitchStats
+{
+    uint32_t switches;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t init_us;   ///< Last full modulator initialisation.
+};
+
+extern ModemSwitchStats modem_switch_stats;
+
 #ifdef __cplusplus
 }
 #endif
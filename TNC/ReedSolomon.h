@@ -0,0 +1,400 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd {
+
+// Parts are adapted from Phil Karn's (KA9Q) Reed-Solomon codec in libfec.
+
+namespace detail {
+
+struct GF256Tables
+{
+    std::array<uint8_t, 512> exp;       ///< Doubled to avoid mod 255.
+    std::array<uint8_t, 256> log;       ///< log[0] is 255 (A0).
+};
+
+constexpr GF256Tables make_gf256_tables(uint16_t poly)
+{
+    GF256Tables t{};
+    uint16_t x = 1;
+    for (size_t i = 0; i != 255; ++i)
+    {
+        t.exp[i] = x;
+        t.exp[i + 255] = x;
+        t.log[x] = i;
+        x <<= 1;
+        if (x & 0x100) x ^= poly;
+    }
+    t.exp[510] = t.exp[0];
+    t.exp[511] = t.exp[1];
+    t.log[0] = 255;
+    return t;
+}
+
+} // detail
+
+/**
+ * GF(2^8) arithmetic using log/antilog tables.  The tables are generated
+ * at compile time and live in flash.
+ *
+ * @tparam POLY is the field generator polynomial, which must be primitive.
+ */
+template <uint16_t POLY>
+struct GaloisField256
+{
+    static_assert(POLY > 0x100 and POLY < 0x200);
+
+    static constexpr size_t NN = 255;   ///< Field size - 1.
+    static constexpr uint8_t A0 = NN;   ///< log(0), in index form.
+
+    static constexpr detail::GF256Tables tables = detail::make_gf256_tables(POLY);
+
+    static constexpr uint8_t exp(size_t i) { return tables.exp[i]; }
+    static constexpr uint8_t log(uint8_t x) { return tables.log[x]; }
+
+    /// x mod 255, without a divide.
+    static constexpr size_t modnn(size_t x)
+    {
+        while (x >= NN)
+        {
+            x -= NN;
+            x = (x >> 8) + (x & NN);
+        }
+        return x;
+    }
+
+    static constexpr uint8_t mul(uint8_t a, uint8_t b)
+    {
+        if (a == 0 or b == 0) return 0;
+        return tables.exp[tables.log[a] + tables.log[b]];
+    }
+
+    static constexpr uint8_t div(uint8_t a, uint8_t b)
+    {
+        if (a == 0) return 0;
+        return tables.exp[tables.log[a] + NN - tables.log[b]];
+    }
+
+    static constexpr uint8_t inv(uint8_t a)
+    {
+        return tables.exp[NN - tables.log[a]];
+    }
+
+    /// alpha^n for any non-negative n.
+    static constexpr uint8_t pow(size_t n)
+    {
+        return tables.exp[modnn(n)];
+    }
+};
+
+/// The field used by FX.25, IL2P and CCSDS (x^8 + x^4 + x^3 + x^2 + 1).
+using GF256 = GaloisField256<0x11D>;
+
+/**
+ * Systematic Reed-Solomon codec over GF(256) with NROOTS parity bytes.
+ * The generator roots are alpha^(PRIM * (FCR + i)) for i in [0, NROOTS).
+ *
+ * Shortened codes are supported by passing a codeword shorter than 255
+ * bytes.  The first byte of the codeword is the highest order
+ * coefficient; the parity bytes follow the data.
+ *
+ * The encoder is an LFSR driven by the generator polynomial in index
+ * (log) form.  The decoder computes the syndromes, returning at once if
+ * they are all zero, then finds the error locator with Berlekamp-Massey,
+ * the error locations with a Chien search and the error values with
+ * Forney's algorithm.  Known bad positions may be passed as erasures;
+ * each erasure uses one parity byte rather than two.
+ *
+ * @tparam NROOTS is the number of parity bytes.
+ * @tparam FCR is the first consecutive root, in index form.
+ * @tparam PRIM is the primitive element used to generate the roots, in
+ *  index form.
+ * @tparam GF is the Galois field.
+ */
+template <size_t NROOTS, uint8_t FCR = 1, uint8_t PRIM = 1, typename GF = GF256>
+struct ReedSolomon
+{
+    static_assert(NROOTS > 0 and NROOTS < GF::NN);
+    static_assert(PRIM > 0);
+
+    static constexpr size_t NN = GF::NN;
+    static constexpr uint8_t A0 = GF::A0;
+    static constexpr size_t MAX_CODEWORD = NN;
+    static constexpr size_t MAX_DATA = MAX_CODEWORD - NROOTS;
+
+    using parity_type = std::array<uint8_t, NROOTS>;
+
+    /// The multiplicative inverse of PRIM, mod 255.
+    static constexpr uint8_t make_iprim()
+    {
+        for (size_t i = 1; i != NN; ++i)
+        {
+            if ((i * PRIM) % NN == 1) return i;
+        }
+        return 0;
+    }
+
+    static constexpr uint8_t IPRIM = make_iprim();
+    static_assert(IPRIM != 0, "PRIM must be relatively prime to 255");
+
+    /// Generator polynomial coefficients in index form, lowest order
+    /// first.  The coefficient of x^NROOTS is 1 and is not stored.
+    static constexpr std::array<uint8_t, NROOTS> make_generator()
+    {
+        std::array<uint8_t, NROOTS + 1> g{};
+        g[0] = 1;
+        for (size_t i = 0; i != NROOTS; ++i)
+        {
+            // Multiply by (x - alpha^(PRIM * (FCR + i))).
+            uint8_t root = GF::pow(PRIM * (FCR + i));
+            for (size_t j = i + 1; j != 0; --j)
+            {
+                g[j] = g[j - 1] ^ GF::mul(g[j], root);
+            }
+            g[0] = GF::mul(g[0], root);
+        }
+        std::array<uint8_t, NROOTS> result{};
+        for (size_t i = 0; i != NROOTS; ++i) result[i] = GF::log(g[i]);
+        return result;
+    }
+
+    static constexpr std::array<uint8_t, NROOTS> generator = make_generator();
+
+    /**
+     * Compute the parity for @p size data bytes.
+     */
+    static void encode(const uint8_t* data, size_t size, uint8_t* parity)
+    {
+        std::fill(parity, parity + NROOTS, 0);
+        for (size_t i = 0; i != size; ++i)
+        {
+            uint8_t feedback = GF::log(data[i] ^ parity[0]);
+            if (feedback != A0)
+            {
+                // Both terms are < 255; the exp table is doubled.
+                for (size_t j = 1; j != NROOTS; ++j)
+                {
+                    parity[j] ^= GF::exp(feedback + generator[NROOTS - j]);
+                }
+            }
+            std::copy(parity + 1, parity + NROOTS, parity);
+            parity[NROOTS - 1] = (feedback != A0) ? GF::exp(feedback + generator[0]) : 0;
+        }
+    }
+
+    /**
+     * Correct the codeword of @p size bytes (data followed by parity) in
+     * place.
+     *
+     * @return the number of bytes corrected, or -1 if the codeword has
+     *  more errors than can be corrected.
+     */
+    static int decode(uint8_t* codeword, size_t size)
+    {
+        return decode(codeword, size, nullptr, 0);
+    }
+
+    /**
+     * Correct the codeword of @p size bytes in place, given the positions
+     * of @p erasure_count bytes known to be unreliable.  Up to NROOTS
+     * erasures may be given; 2 * errors + erasures must not exceed NROOTS.
+     *
+     * @param erasures are indices into the codeword.
+     *
+     * @return the number of bytes corrected (including erasures), or -1
+     *  if the codeword is uncorrectable.
+     */
+    static int decode(uint8_t* codeword, size_t size, const uint8_t* erasures,
+        size_t erasure_count)
+    {
+        if (size <= NROOTS or size > MAX_CODEWORD) return -1;
+        if (erasure_count > NROOTS) return -1;
+
+        const size_t pad = NN - size;
+
+        // Syndromes, evaluating the codeword at each root.
+        std::array<uint8_t, NROOTS> s;
+        s.fill(codeword[0]);
+        for (size_t j = 1; j != size; ++j)
+        {
+            for (size_t i = 0; i != NROOTS; ++i)
+            {
+                s[i] = (s[i] == 0) ? codeword[j]
+                    : codeword[j] ^ GF::exp(GF::modnn(GF::log(s[i]) + (FCR + i) * PRIM));
+            }
+        }
+
+        // Most codewords are clean.
+        uint8_t syndrome_error = 0;
+        for (auto& x : s)
+        {
+            syndrome_error |= x;
+            x = GF::log(x);
+        }
+        if (syndrome_error == 0) return 0;
+
+        // Initialize lambda to the erasure locator polynomial.
+        std::array<uint8_t, NROOTS + 1> lambda{};
+        lambda[0] = 1;
+        for (size_t i = 0; i != erasure_count; ++i)
+        {
+            size_t u = GF::modnn(PRIM * (NN - 1 - (erasures[i] + pad)));
+            for (size_t j = i + 1; j != 0; --j)
+            {
+                uint8_t tmp = GF::log(lambda[j - 1]);
+                if (tmp != A0) lambda[j] ^= GF::exp(GF::modnn(u + tmp));
+            }
+        }
+
+        std::array<uint8_t, NROOTS + 1> b;
+        for (size_t i = 0; i != NROOTS + 1; ++i) b[i] = GF::log(lambda[i]);
+
+        // Berlekamp-Massey: find the error+erasure locator polynomial.
+        std::array<uint8_t, NROOTS + 1> t;
+        size_t el = erasure_count;
+        for (size_t r = erasure_count + 1; r <= NROOTS; ++r)
+        {
+            // Discrepancy at step r, in polynomial form.
+            uint8_t discrepancy = 0;
+            for (size_t i = 0; i != r; ++i)
+            {
+                if (lambda[i] != 0 and s[r - i - 1] != A0)
+                {
+                    discrepancy ^= GF::exp(GF::modnn(GF::log(lambda[i]) + s[r - i - 1]));
+                }
+            }
+            discrepancy = GF::log(discrepancy);
+
+            if (discrepancy == A0)
+            {
+                // B(x) <- x * B(x)
+                std::copy_backward(b.begin(), b.end() - 1, b.end());
+                b[0] = A0;
+                continue;
+            }
+
+            // T(x) <- lambda(x) - discrepancy * x * B(x)
+            t[0] = lambda[0];
+            for (size_t i = 0; i != NROOTS; ++i)
+            {
+                t[i + 1] = (b[i] != A0)
+                    ? lambda[i + 1] ^ GF::exp(GF::modnn(discrepancy + b[i]))
+                    : lambda[i + 1];
+            }
+
+            if (2 * el <= r + erasure_count - 1)
+            {
+                el = r + erasure_count - el;
+                // B(x) <- lambda(x) / discrepancy
+                for (size_t i = 0; i != NROOTS + 1; ++i)
+                {
+                    b[i] = (lambda[i] == 0) ? A0
+                        : GF::modnn(GF::log(lambda[i]) + NN - discrepancy);
+                }
+            }
+            else
+            {
+                std::copy_backward(b.begin(), b.end() - 1, b.end());
+                b[0] = A0;
+            }
+            lambda = t;
+        }
+
+        // Convert lambda to index form and find its degree.
+        size_t deg_lambda = 0;
+        for (size_t i = 0; i != NROOTS + 1; ++i)
+        {
+            lambda[i] = GF::log(lambda[i]);
+            if (lambda[i] != A0) deg_lambda = i;
+        }
+        if (deg_lambda == 0) return -1;
+
+        // Chien search for the roots of lambda.  With PRIM = 1 the
+        // locations are in order, so the search can skip the padding of a
+        // shortened code.
+        const size_t start = (PRIM == 1) ? pad : 0;
+        std::array<uint8_t, NROOTS + 1> reg = lambda;
+        for (size_t j = 1; j <= deg_lambda; ++j)
+        {
+            if (reg[j] != A0) reg[j] = GF::modnn(reg[j] + j * start);
+        }
+        std::array<uint8_t, NROOTS> root;
+        std::array<uint8_t, NROOTS> loc;
+        size_t count = 0;
+        for (size_t i = start + 1, k = GF::modnn(IPRIM * (start + 1) + NN - 1); i <= NN;
+            ++i, k = GF::modnn(k + IPRIM))
+        {
+            uint8_t q = 1;  // lambda[0] is always 1.
+            for (size_t j = deg_lambda; j != 0; --j)
+            {
+                if (reg[j] != A0)
+                {
+                    reg[j] = GF::modnn(reg[j] + j);
+                    q ^= GF::exp(reg[j]);
+                }
+            }
+            if (q != 0) continue;
+
+            // An error in the padding of a shortened code is uncorrectable.
+            if (k < pad) return -1;
+
+            root[count] = i;
+            loc[count] = k;
+            if (++count == deg_lambda) break;
+        }
+        if (count != deg_lambda) return -1;
+
+        // Error+erasure evaluator, omega(x) = s(x) * lambda(x) mod x^NROOTS,
+        // in index form.
+        const size_t deg_omega = deg_lambda - 1;
+        std::array<uint8_t, NROOTS> omega;
+        for (size_t i = 0; i <= deg_omega; ++i)
+        {
+            uint8_t tmp = 0;
+            for (size_t j = 0; j <= i; ++j)
+            {
+                if (s[i - j] != A0 and lambda[j] != A0)
+                {
+                    tmp ^= GF::exp(GF::modnn(s[i - j] + lambda[j]));
+                }
+            }
+            omega[i] = GF::log(tmp);
+        }
+
+        // Forney: the error value at X(l) is
+        // omega(1/X(l)) * (1/X(l))^(FCR - 1) / lambda'(1/X(l)).
+        for (size_t j = 0; j != count; ++j)
+        {
+            uint8_t num1 = 0;
+            for (size_t i = 0; i <= deg_omega; ++i)
+            {
+                if (omega[i] != A0) num1 ^= GF::exp(GF::modnn(omega[i] + i * root[j]));
+            }
+            if (num1 == 0) continue;
+
+            uint8_t num2 = GF::exp(GF::modnn(root[j] * (FCR + NN - 1) + NN));
+
+            // lambda[i + 1] for even i is the formal derivative of lambda.
+            uint8_t den = 0;
+            for (size_t i = 0; i <= std::min(deg_lambda, NROOTS - 1); i += 2)
+            {
+                if (lambda[i + 1] != A0) den ^= GF::exp(GF::modnn(lambda[i + 1] + i * root[j]));
+            }
+            if (den == 0) return -1;
+
+            codeword[loc[j] - pad] ^= GF::exp(GF::modnn(
+                GF::log(num1) + GF::log(num2) + NN - GF::log(den)));
+        }
+
+        return count;
+    }
+};
+
+} // mobilinkd
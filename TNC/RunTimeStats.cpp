@@ -0,0 +1,92 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "RunTimeStats.hpp"
+#include "memory.hpp"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <algorithm>
+
+namespace mobilinkd { namespace tnc {
+
+namespace memory {
+
+CriticalStats critical_stats;
+
+} // memory
+
+namespace {
+
+// The run-time counter is DWT cycles / 64; see getRunTimeCounterValue().
+constexpr uint32_t RUN_TIME_SHIFT = 6;
+
+RunTimeStats stats;
+TaskStatus_t task_status[RunTimeStats::MAX_TASKS];
+
+// Counters at the previous poll, by task number.
+std::array<uint32_t, RunTimeStats::MAX_TASKS * 2> last_run_time;
+uint32_t last_total = 0;
+uint32_t last_critical_count = 0;
+uint32_t last_critical_cycles = 0;
+
+uint16_t load(uint64_t part, uint64_t total)
+{
+    if (total == 0) return 0;
+    return std::min<uint64_t>(part * 10000 / total, 10000);
+}
+
+} // namespace
+
+/**
+ * Take a snapshot of the task table.  This suspends the scheduler while
+ * the table is copied; it is meant to be polled, not streamed.
+ */
+const RunTimeStats& pollRunTimeStats()
+{
+    uint32_t total = 0;
+    auto count = uxTaskGetSystemState(task_status, RunTimeStats::MAX_TASKS, &total);
+    uint32_t interval = total - last_total;
+    last_total = total;
+
+    stats.interval_ms = (uint64_t(interval) << RUN_TIME_SHIFT) / (SystemCoreClock / 1000);
+    stats.task_count = count;
+
+    for (size_t i = 0; i != count; ++i)
+    {
+        auto& status = task_status[i];
+        auto& task = stats.tasks[i];
+        task.name = status.pcTaskName;
+        task.number = status.xTaskNumber;
+        task.stack_free = status.usStackHighWaterMark;
+
+        uint32_t run_time = status.ulRunTimeCounter;
+        if (status.xTaskNumber < last_run_time.size())
+        {
+            auto& last = last_run_time[status.xTaskNumber];
+            task.cpu = load(run_time - last, interval);
+            last = run_time;
+        }
+        else
+        {
+            task.cpu = 0;
+        }
+    }
+
+    auto mask = taskENTER_CRITICAL_FROM_ISR();
+    auto critical = memory::critical_stats;
+    memory::critical_stats.max_cycles = 0;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    stats.critical_count = critical.count - last_critical_count;
+    stats.critical_load = load(critical.cycles - last_critical_cycles,
+        uint64_t(interval) << RUN_TIME_SHIFT);
+    stats.critical_max = critical.max_cycles;
+    last_critical_count = critical.count;
+    last_critical_cycles = critical.cycles;
+
+    return stats;
+}
+
+}} // mobilinkd::tnc
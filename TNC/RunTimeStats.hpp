@@ -0,0 +1,42 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "cmsis_os.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * Per-task CPU use and stack headroom, from the FreeRTOS run-time stats,
+ * plus the time spent in the pool critical sections.  CPU use and the
+ * critical section figures cover the interval since the previous poll.
+ * Reported by GET_TASK_STATS.
+ */
+struct RunTimeStats
+{
+    static constexpr size_t MAX_TASKS = 12;
+
+    struct Task
+    {
+        const char* name;
+        uint8_t number;         ///< FreeRTOS task number.
+        uint16_t cpu;           ///< 0.01%.
+        uint16_t stack_free;    ///< Stack words never used (high-water mark).
+    };
+
+    uint32_t interval_ms;
+    uint16_t critical_load;     ///< 0.01%.
+    uint32_t critical_count;
+    uint32_t critical_max;      ///< CPU cycles; since the previous poll.
+    size_t task_count;
+    std::array<Task, MAX_TASKS> tasks;
+};
+
+const RunTimeStats& pollRunTimeStats();
+
+}} // mobilinkd::tnc
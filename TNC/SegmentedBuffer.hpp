@@ -30,20 +30,15 @@ struct Pool {
     }
 
     bool allocate(chunk_list& list) {
-        bool result = false;
-        auto x = taskENTER_CRITICAL_FROM_ISR();
-        if (!free_list.empty()) {
-            list.splice(list.end(), free_list, free_list.begin());
-            result = true;
-        }
-        taskEXIT_CRITICAL_FROM_ISR(x);
-        return result;
+        memory::CriticalSection critical;
+        if (free_list.empty()) return false;
+        list.splice(list.end(), free_list, free_list.begin());
+        return true;
     }
 
     void deallocate(chunk_list& list) {
-        auto x = taskENTER_CRITICAL_FROM_ISR();
+        memory::CriticalSection critical;
         free_list.splice(free_list.end(), list);
-        taskEXIT_CRITICAL_FROM_ISR(x);
     }
 };
 
@@ -0,0 +1,46 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#include "TwistEstimator.hpp"
+
+#include <cmath>
+
+namespace mobilinkd { namespace tnc {
+
+namespace {
+
+uint32_t pack(float mark, float space)
+{
+    auto db = [](float energy) { return uint16_t(int16_t(10.0f * log10f(energy) * 256.0f)); };
+    return (uint32_t(db(mark)) << 16) | db(space);
+}
+
+} // namespace
+
+/**
+ * Publish the mean block energies for the last frame and for all frames.
+ * Zero energy (no signal at all) is not published.
+ */
+void TwistMonitor::publish(float mark, float space, float total_mark, float total_space)
+{
+    if (mark <= 0.0f or space <= 0.0f or total_mark <= 0.0f or total_space <= 0.0f) return;
+
+    instant = pack(mark, space);
+    average = pack(total_mark, total_space);
+    frames += 1;
+}
+
+void TwistMonitor::reset()
+{
+    frames = 0;
+    average = 0;
+    instant = 0;
+}
+
+TwistMonitor& twistMonitor()
+{
+    static TwistMonitor instance;
+    return instance;
+}
+
+}} // mobilinkd::tnc
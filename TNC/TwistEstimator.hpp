@@ -0,0 +1,100 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+#pragma once
+
+#include "Goertzel.h"
+
+#include <arm_math.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd { namespace tnc {
+
+/**
+ * The latest twist estimate, published by the demodulator task and read
+ * by the IO task.  The mark and space levels (dB * 256, as reported by
+ * POLL_INPUT_TWIST) are packed into one word so that they are always
+ * read as a pair.
+ */
+struct TwistMonitor
+{
+    std::atomic<uint32_t> average{0};   ///< Over all frames received.
+    std::atomic<uint32_t> instant{0};   ///< Over the last frame.
+    std::atomic<uint32_t> frames{0};
+
+    void publish(float mark, float space, float total_mark, float total_space);
+    void reset();
+
+    static int16_t mark(uint32_t levels) { return int16_t(levels >> 16); }
+    static int16_t space(uint32_t levels) { return int16_t(levels & 0xFFFF); }
+};
+
+TwistMonitor& twistMonitor();
+
+/**
+ * Online twist estimator run on the demodulator's own ADC blocks while
+ * it decodes.  Goertzel filters measure the mark and space energy of each
+ * block while the demodulator is locked; the energy of the blocks making
+ * up a frame is kept only if a frame is decoded, so that noise and
+ * interference between frames does not count.  This replaces stopping
+ * the demodulator to sample the channel at a different rate.
+ *
+ * The published estimate is cleared when the modem type changes.
+ */
+template <size_t BLOCK_SIZE, uint32_t SAMPLE_RATE>
+struct TwistEstimator
+{
+    GoertzelFilter<BLOCK_SIZE, SAMPLE_RATE> mark_filter_;
+    GoertzelFilter<BLOCK_SIZE, SAMPLE_RATE> space_filter_;
+    float mark_{0.0f};          ///< Current frame.
+    float space_{0.0f};
+    uint32_t blocks_{0};
+    float total_mark_{0.0f};    ///< Received frames.
+    float total_space_{0.0f};
+    uint32_t total_blocks_{0};
+
+    TwistEstimator(float mark, float space)
+    : mark_filter_(mark, nullptr), space_filter_(space, nullptr)
+    {}
+
+    /**
+     * @param samples is the raw ADC block just demodulated.
+     * @param locked is the demodulator lock state after the block.
+     * @param frame is true if a frame was decoded from the block.
+     */
+    void operator()(const q15_t* samples, bool locked, bool frame)
+    {
+        if (locked or frame)
+        {
+            auto data = reinterpret_cast<uint16_t*>(const_cast<q15_t*>(samples));
+            mark_filter_(data, BLOCK_SIZE);
+            space_filter_(data, BLOCK_SIZE);
+            mark_ += mark_filter_ / BLOCK_SIZE;
+            space_ += space_filter_ / BLOCK_SIZE;
+            ++blocks_;
+            mark_filter_.reset();
+            space_filter_.reset();
+        }
+
+        if (frame and blocks_ != 0)
+        {
+            total_mark_ += mark_;
+            total_space_ += space_;
+            total_blocks_ += blocks_;
+            twistMonitor().publish(mark_ / blocks_, space_ / blocks_,
+                total_mark_ / total_blocks_, total_space_ / total_blocks_);
+        }
+
+        if (frame or !locked)
+        {
+            mark_ = 0.0f;
+            space_ = 0.0f;
+            blocks_ = 0;
+        }
+    }
+};
+
+}} // mobilinkd::tnc
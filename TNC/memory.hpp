@@ -4,6 +4,7 @@
 #pragma once
 
 #include "cmsis_os.h"
+#include "stm32l4xx_hal.h"
 
 #include <boost/intrusive/list.hpp>
 
@@ -15,6 +16,45 @@ using boost::intrusive::list_base_hook;
 using boost::intrusive::list;
 using boost::intrusive::constant_time_size;
 
+/**
+ * Time spent with interrupts masked by the pool critical sections, in
+ * CPU cycles.  Reported by GET_TASK_STATS.
+ */
+struct CriticalStats
+{
+    uint32_t count;
+    uint32_t cycles;        ///< Total; wraps.
+    uint32_t max_cycles;
+};
+
+extern CriticalStats critical_stats;
+
+/**
+ * taskENTER_CRITICAL_FROM_ISR() for the pools, timed with the DWT cycle
+ * counter.  The statistics are updated before interrupts are unmasked.
+ */
+struct CriticalSection
+{
+    UBaseType_t mask_;
+    uint32_t start_;
+
+    CriticalSection()
+    : mask_(taskENTER_CRITICAL_FROM_ISR()), start_(DWT->CYCCNT)
+    {}
+
+    ~CriticalSection()
+    {
+        uint32_t cycles = DWT->CYCCNT - start_;
+        critical_stats.count += 1;
+        critical_stats.cycles += cycles;
+        if (cycles > critical_stats.max_cycles) critical_stats.max_cycles = cycles;
+        taskEXIT_CRITICAL_FROM_ISR(mask_);
+    }
+
+    CriticalSection(const CriticalSection&) = delete;
+    CriticalSection& operator=(const CriticalSection&) = delete;
+};
+
 template <uint16_t BLOCK_SIZE = 256>
 struct chunk : public list_base_hook<>
 {
@@ -50,20 +90,18 @@ struct Pool {
     }
 
     chunk_type* allocate() {
-        auto x = taskENTER_CRITICAL_FROM_ISR();
+        CriticalSection critical;
         chunk_type* result = 0;
         if (not free_list.empty()) {
             result = &free_list.front();
             free_list.pop_front();
         }
-        taskEXIT_CRITICAL_FROM_ISR(x);
         return result;
     }
 
     void deallocate(chunk_type* item) {
-        auto x = taskENTER_CRITICAL_FROM_ISR();
+        CriticalSection critical;
         free_list.push_back(*item);
-        taskEXIT_CRITICAL_FROM_ISR(x);
     }
 
     size_t free() const { return free_list.size(); }
@@ -0,0 +1,125 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host measurement of the AFSK300 tone correlators against mistuning,
+ * used to choose Afsk300Demodulator::TONE_OFFSETS.  This is not part of
+ * the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I TNC host/Afsk300Mistuning.cpp -o afsk300_mistuning
+ *   ./afsk300_mistuning
+ *
+ * The signal is continuous-phase 1600/1800Hz FSK at 300 baud, shifted by
+ * the mistuning, plus white Gaussian noise, quantized as the demodulator
+ * sees it.  One pair of afsk300::ToneCorrelator at the nominal tones
+ * decides each symbol at the sample where the window covers it exactly;
+ * the PLL is not modelled.  For each mistuning the SNR (in a 3kHz noise
+ * bandwidth) needed for a symbol error rate of 1e-3 is found by bisection
+ * over the same noise, and the loss is that SNR less the SNR needed with
+ * no mistuning.  With decoders D Hz apart, a signal is at most D/2 Hz
+ * from the nearest one.
+ */
+
+#include "Afsk300Correlator.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd::tnc;
+
+namespace {
+
+constexpr double AMPLITUDE = 2000.0;    // ADC counts (14-bit).
+constexpr size_t SYMBOLS = 200000;
+constexpr double TARGET_SER = 1e-3;
+constexpr double MAX_SNR = 30.0;
+constexpr double PI = 3.14159265358979323846;
+
+struct Channel
+{
+    std::vector<uint8_t> symbols;
+    std::vector<double> noise;          // Unit variance.
+
+    explicit Channel(uint32_t seed)
+    : symbols(SYMBOLS), noise(SYMBOLS * afsk300::SAMPLES_PER_SYMBOL)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> normal;
+        for (auto& s : symbols) s = rng() & 1;
+        for (auto& n : noise) n = normal(rng);
+    }
+};
+
+double symbol_error_rate(const Channel& channel, double offset, double snr_db)
+{
+    // SNR = (A^2 / 2) / (sigma^2 * 3000 / (fs / 2)).
+    double sigma = std::sqrt(AMPLITUDE * AMPLITUDE / 2.0
+        / std::pow(10.0, snr_db / 10.0) / (3000.0 / (afsk300::SAMPLE_RATE / 2.0)));
+
+    afsk300::ToneCorrelator mark, space;
+    mark.init(afsk300::MARK_FREQ);
+    space.init(afsk300::SPACE_FREQ);
+    std::array<int32_t, afsk300::SAMPLES_PER_SYMBOL> history{};
+
+    double phase = 0.0;
+    size_t errors = 0;
+    size_t n = 0;
+    for (size_t i = 0; i != channel.symbols.size(); ++i)
+    {
+        bool symbol = channel.symbols[i];
+        double frequency = (symbol ? afsk300::MARK_FREQ : afsk300::SPACE_FREQ) + offset;
+        float m = 0, s = 0;
+        for (size_t j = 0; j != afsk300::SAMPLES_PER_SYMBOL; ++j, ++n)
+        {
+            phase += 2.0 * PI * frequency / afsk300::SAMPLE_RATE;
+            auto sample = int32_t(std::lround(AMPLITUDE * std::sin(phase)
+                + sigma * channel.noise[n]));
+            int32_t oldest = history[j];
+            history[j] = sample;
+            m = mark(sample, oldest);
+            s = space(sample, oldest);
+        }
+        if (i != 0) errors += (m > s) != symbol;
+    }
+    return double(errors) / (channel.symbols.size() - 1);
+}
+
+double required_snr(const Channel& channel, double offset)
+{
+    double low = -5.0;
+    double high = MAX_SNR;
+    for (int i = 0; i != 12; ++i)
+    {
+        double mid = (low + high) / 2.0;
+        if (symbol_error_rate(channel, offset, mid) > TARGET_SER) low = mid;
+        else high = mid;
+    }
+    return high;
+}
+
+} // namespace
+
+int main()
+{
+    Channel channel(35);
+
+    std::printf("SNR (3kHz) for a %.0e symbol error rate vs mistuning, %zu symbols\n",
+        TARGET_SER, SYMBOLS);
+    std::printf("  %9s  %7s  %6s\n", "mistuning", "SNR", "loss");
+
+    double reference = required_snr(channel, 0.0);
+    for (double offset : {0.0, 12.5, 25.0, 37.5, 50.0, 62.5, 75.0, 100.0, 125.0, 150.0})
+    {
+        // Mistuning in either direction; report the worse.
+        double snr = std::max(required_snr(channel, offset), required_snr(channel, -offset));
+        if (snr >= MAX_SNR) std::printf("  %7.1fHz  >%.0fdB\n", offset, MAX_SNR);
+        else std::printf("  %7.1fHz  %5.2fdB  %4.2fdB\n", offset, snr, snr - reference);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host comparison of ADC hardware oversampling with the software kernels
+ * in TNC/Decimator.hpp.  This is not part of the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I TNC host/DecimatorBenchmark.cpp -o decimator_bench
+ *   ./decimator_bench
+ *
+ * Each case produces 14-bit samples at the 26.4kHz AFSK1200 rate from a
+ * model of the 12-bit ADC: a tone of AMPLITUDE LSB plus NOISE LSB rms of
+ * white noise on every conversion, rounded.  The hardware oversampler
+ * sums 2^n conversions for each trigger and shifts right by n - 2.  The
+ * software cases trigger faster with a lower ratio and decimate, so the
+ * number of conversions per second is the same (except for the resampler,
+ * which is the AFSK1200 + M17 path at 48kHz).
+ *
+ * SNR is the fitted tone power over the residual power across the whole
+ * output band.  The time is host nanoseconds per output sample for the
+ * kernel alone; MACs are the multiplies per output sample.  Cortex-M4
+ * cycle counts must be measured on the target.
+ */
+
+#include "Decimator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd::tnc;
+
+namespace {
+
+constexpr double OUTPUT_RATE = 26400.0;
+constexpr double AMPLITUDE = 20.0;      // LSB at 12 bits.
+constexpr double NOISE = 1.0;           // LSB rms per conversion.
+constexpr size_t OUTPUT_SAMPLES = 26400;
+constexpr size_t SETTLE = 64;           // Output samples skipped by the fit.
+constexpr double PI = 3.14159265358979323846;
+
+/**
+ * Capture @p count samples at @p rate with 2^n hardware oversampling.
+ */
+std::vector<int16_t> capture(double frequency, double rate, size_t n, size_t count,
+    std::mt19937& rng)
+{
+    std::normal_distribution<double> noise(0.0, NOISE);
+    std::vector<int16_t> result(count);
+    for (size_t i = 0; i != count; ++i)
+    {
+        double v = 2048.0 + AMPLITUDE * std::sin(2.0 * PI * frequency * i / rate);
+        int32_t sum = 0;
+        for (size_t j = 0; j != (size_t(1) << n); ++j)
+        {
+            sum += std::clamp<int32_t>(std::lround(v + noise(rng)), 0, 4095);
+        }
+        result[i] = int16_t(sum >> (n - 2));
+    }
+    return result;
+}
+
+/**
+ * Fit DC and the tone at @p frequency to @p samples (at OUTPUT_RATE) by
+ * least squares and return the SNR in dB.
+ */
+double snr(const std::vector<int16_t>& samples, double frequency)
+{
+    // The fit basis is nearly orthogonal over many cycles; solve the 3x3
+    // normal equations anyway.
+    double a[3][4] = {};
+    for (size_t i = SETTLE; i != samples.size(); ++i)
+    {
+        double t = 2.0 * PI * frequency * i / OUTPUT_RATE;
+        double basis[3] = {1.0, std::sin(t), std::cos(t)};
+        for (int r = 0; r != 3; ++r)
+        {
+            for (int c = 0; c != 3; ++c) a[r][c] += basis[r] * basis[c];
+            a[r][3] += basis[r] * samples[i];
+        }
+    }
+    for (int r = 0; r != 3; ++r)
+    {
+        for (int k = r + 1; k != 3; ++k)
+        {
+            double f = a[k][r] / a[r][r];
+            for (int c = r; c != 4; ++c) a[k][c] -= f * a[r][c];
+        }
+    }
+    double x[3];
+    for (int r = 2; r >= 0; --r)
+    {
+        x[r] = a[r][3];
+        for (int c = r + 1; c != 3; ++c) x[r] -= a[r][c] * x[c];
+        x[r] /= a[r][r];
+    }
+
+    double residual = 0.0;
+    size_t count = 0;
+    for (size_t i = SETTLE; i != samples.size(); ++i, ++count)
+    {
+        double t = 2.0 * PI * frequency * i / OUTPUT_RATE;
+        double e = samples[i] - (x[0] + x[1] * std::sin(t) + x[2] * std::cos(t));
+        residual += e * e;
+    }
+    double signal = (x[1] * x[1] + x[2] * x[2]) / 2.0;
+    return 10.0 * std::log10(signal / (residual / count));
+}
+
+/// Run @p kernel over the input until about 0.2s has passed.
+template <typename F>
+double time_per_output(F&& kernel, size_t outputs_per_run)
+{
+    using clock = std::chrono::steady_clock;
+    size_t runs = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    do {
+        kernel();
+        ++runs;
+        elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(200));
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (runs * outputs_per_run);
+}
+
+/// Half-band taps (Q15, outermost first) from a Hann windowed sinc.
+template <size_t N>
+std::array<int16_t, N> half_band_taps()
+{
+    constexpr size_t FILTER_SIZE = 4 * N - 1;
+    std::array<int16_t, N> taps;
+    for (size_t k = 0; k != N; ++k)
+    {
+        double d = double(2 * (N - k) - 1);     // Distance from the centre.
+        double window = 0.5 + 0.5 * std::cos(PI * d / ((FILTER_SIZE + 1) / 2));
+        taps[k] = int16_t(std::lround(std::sin(PI * d / 2) / (PI * d) * window * 32768.0));
+    }
+    return taps;
+}
+
+volatile int16_t sink;
+
+void report(const char* name, double conversions, double db1200, double db2200,
+    double ns, double macs)
+{
+    if (ns == 0.0)
+    {
+        std::printf("  %-30s %6.2fM/s  %5.1fdB  %5.1fdB  %8s  %4s\n",
+            name, conversions / 1e6, db1200, db2200, "-", "-");
+        return;
+    }
+    std::printf("  %-30s %6.2fM/s  %5.1fdB  %5.1fdB  %6.2fns  %4.0f\n",
+        name, conversions / 1e6, db1200, db2200, ns, macs);
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(43);
+
+    std::printf("1200Hz and 2200Hz tones at %.0f LSB, %.1f LSB rms noise, 26.4kHz output\n",
+        AMPLITUDE, NOISE);
+    std::printf("  %-30s %9s  %7s  %7s  %8s  %4s\n",
+        "case", "conv", "1200Hz", "2200Hz", "time", "MACs");
+
+    // Hardware oversampling only.
+    for (size_t n : {4, 5, 6})
+    {
+        double db[2];
+        int i = 0;
+        for (double f : {1200.0, 2200.0})
+        {
+            db[i++] = snr(capture(f, OUTPUT_RATE, n, OUTPUT_SAMPLES, rng), f);
+        }
+        char name[40];
+        std::snprintf(name, sizeof(name), "HW %zux", size_t(1) << n);
+        report(name, OUTPUT_RATE * (1 << n), db[0], db[1], 0.0, 0.0);
+    }
+
+    // 32x at 52.8kHz, then a 31-tap half-band filter.
+    {
+        constexpr size_t BLOCK = 264;
+        constexpr size_t N = 8;
+        double db[2];
+        std::vector<int16_t> input;
+        int i = 0;
+        for (double f : {1200.0, 2200.0})
+        {
+            input = capture(f, 2 * OUTPUT_RATE, 5, 2 * OUTPUT_SAMPLES, rng);
+            HalfBandDecimator<BLOCK, N> decimator(half_band_taps<N>());
+            std::vector<int16_t> output;
+            for (size_t j = 0; j + BLOCK <= input.size(); j += BLOCK)
+            {
+                auto y = decimator(input.data() + j);
+                output.insert(output.end(), y, y + BLOCK / 2);
+            }
+            db[i++] = snr(output, f);
+        }
+        HalfBandDecimator<BLOCK, N> decimator(half_band_taps<N>());
+        double ns = time_per_output([&] {
+            for (size_t j = 0; j + BLOCK <= input.size(); j += BLOCK)
+                sink = decimator(input.data() + j)[0];
+        }, input.size() / 2);
+        report("HW 32x 52.8k + half-band/2", 2 * OUTPUT_RATE * 32, db[0], db[1], ns, N);
+    }
+
+    // 16x at 105.6kHz, then a third-order CIC decimating by 4.
+    {
+        constexpr size_t R = 4;
+        constexpr size_t N = 3;
+        double db[2];
+        std::vector<int16_t> input;
+        int i = 0;
+        for (double f : {1200.0, 2200.0})
+        {
+            input = capture(f, R * OUTPUT_RATE, 4, R * OUTPUT_SAMPLES, rng);
+            CicDecimator<R, N> decimator;
+            std::vector<int16_t> output(OUTPUT_SAMPLES);
+            output.resize(decimator(input.data(), input.size(), output.data()));
+            db[i++] = snr(output, f);
+        }
+        CicDecimator<R, N> decimator;
+        std::vector<int16_t> output(OUTPUT_SAMPLES);
+        double ns = time_per_output([&] {
+            sink = decimator(input.data(), input.size(), output.data());
+        }, OUTPUT_SAMPLES);
+        report("HW 16x 105.6k + CIC R=4 N=3", R * OUTPUT_RATE * 16, db[0], db[1], ns, 0.0);
+    }
+
+    // The AFSK1200 + M17 path: 32x at 48kHz, resampled by 11/20.
+    {
+        constexpr size_t BLOCK = 192;
+        using resampler_t = RationalResampler<BLOCK, 11, 20, 8>;
+        constexpr double INPUT_RATE = 48000.0;
+        const size_t input_size = (size_t(OUTPUT_SAMPLES * 20 / 11) / BLOCK) * BLOCK;
+        double db[2];
+        std::vector<int16_t> input;
+        int i = 0;
+        for (double f : {1200.0, 2200.0})
+        {
+            input = capture(f, INPUT_RATE, 5, input_size, rng);
+            resampler_t resampler(6000.0f / INPUT_RATE);
+            std::vector<int16_t> output;
+            int16_t y[resampler_t::MAX_OUTPUT_SIZE];
+            for (size_t j = 0; j + BLOCK <= input.size(); j += BLOCK)
+            {
+                size_t count = resampler(input.data() + j, y);
+                output.insert(output.end(), y, y + count);
+            }
+            db[i++] = snr(output, f);
+        }
+        resampler_t resampler(6000.0f / INPUT_RATE);
+        int16_t y[resampler_t::MAX_OUTPUT_SIZE];
+        double ns = time_per_output([&] {
+            for (size_t j = 0; j + BLOCK <= input.size(); j += BLOCK)
+                sink = resampler(input.data() + j, y);
+        }, input.size() * 11 / 20);
+        report("HW 32x 48k + resample 11/20", INPUT_RATE * 32, db[0], db[1], ns, 8);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,239 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host test for the batched G3RUH receive chain in
+ * TNC/Fsk9600PhaseDecoder.hpp.  This is not part of the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I host/stubs -I TNC -I TNC/boost \
+ *       host/Fsk9600PhaseDecoderTest.cpp TNC/HdlcDecoder.cpp \
+ *       TNC/HdlcFrame.cpp TNC/Il2p.cpp host/stubs/HostSupport.cpp \
+ *       -o fsk_phase_test
+ *   ./fsk_phase_test
+ *
+ * A random bit stream of scrambled AX.25 frames is passed through both
+ * Fsk9600PhaseDecoder and the per-bit chain it replaced (descrambler, NRZI
+ * decoder and HDLC decoder, one bit at a time).  The stream has random
+ * noise between frames, so frames start at every offset within a 32-bit
+ * word, and has bit errors, aborts and lock drops.  The two must return
+ * the same frames, byte for byte, at the same bit or earlier, and agree on
+ * NewDecoder::active() after every bit.  Each DCD mode is covered, with
+ * and without passall.
+ */
+
+#include "Fsk9600PhaseDecoder.hpp"
+#include "NRZI.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd::tnc;
+using mobilinkd::libafsk::NRZI;
+
+namespace {
+
+/// The per-bit G3RUH descrambler used before the batched one.
+struct Descrambler
+{
+    uint32_t state{0};
+
+    bool operator()(bool bit)
+    {
+        bool result = (bit ^ (state >> 16) ^ (state >> 11)) & 1;
+        state = ((state << 1) | bit) & 0x1FFFF;
+        return result;
+    }
+};
+
+struct Scrambler
+{
+    uint32_t state{0};
+
+    bool operator()(bool bit)
+    {
+        bool result = (bit ^ (state >> 16) ^ (state >> 11)) & 1;
+        state = ((state << 1) | result) & 0x1FFFF;
+        return result;
+    }
+};
+
+uint16_t fcs(const std::vector<uint8_t>& data)
+{
+    uint16_t crc = 0xFFFF;
+    for (auto byte : data)
+    {
+        crc ^= byte;
+        for (int i = 0; i != 8; ++i) crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+    return crc ^ 0xFFFF;
+}
+
+struct Stream
+{
+    std::vector<uint8_t> bits;
+    std::vector<uint8_t> locked;
+    size_t frames_sent = 0;
+
+    Scrambler scrambler;
+    NRZI nrzi;
+    bool lock = true;
+
+    void send(bool bit)
+    {
+        bits.push_back(scrambler(nrzi.encode(bit)));
+        locked.push_back(lock);
+    }
+
+    void send_byte(uint8_t byte)
+    {
+        for (int i = 0; i != 8; ++i) send((byte >> i) & 1);
+    }
+
+    /// Raw channel bits, not scrambled or NRZI encoded.
+    void noise(size_t count, std::mt19937& rng)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            bits.push_back(rng() & 1);
+            locked.push_back(lock);
+        }
+    }
+
+    void frame(const std::vector<uint8_t>& data, bool abort)
+    {
+        for (int i = 0; i != 4; ++i) send_byte(0x7E);
+        int ones = 0;
+        for (size_t j = 0; j != data.size(); ++j)
+        {
+            if (abort and j == data.size() / 2)
+            {
+                send_byte(0xFE);
+                return;
+            }
+            for (int i = 0; i != 8; ++i)
+            {
+                bool bit = (data[j] >> i) & 1;
+                send(bit);
+                ones = bit ? ones + 1 : 0;
+                if (ones == 5)
+                {
+                    send(0);
+                    ones = 0;
+                }
+            }
+        }
+        send_byte(0x7E);
+        send_byte(0x7E);
+        ++frames_sent;
+    }
+};
+
+struct Decoded
+{
+    size_t bit;             ///< Index of the bit that completed the frame.
+    bool ok;
+    std::vector<uint8_t> data;
+};
+
+void collect(hdlc::IoFrame* frame, size_t bit, std::vector<Decoded>& frames)
+{
+    if (!frame) return;
+    frames.push_back({bit, frame->ok(), {frame->begin(), frame->end()}});
+    hdlc::release(frame);
+}
+
+bool run(uint32_t seed, bool passall, hdlc::NewDecoder::DCD dcd, size_t& good, size_t& sent)
+{
+    std::mt19937 rng(seed);
+    Stream stream;
+
+    for (size_t n = 0; n != 200; ++n)
+    {
+        stream.lock = true;
+        stream.noise(rng() % 64, rng);
+
+        std::vector<uint8_t> data(16 + rng() % 200);
+        for (auto& byte : data) byte = rng();
+        auto crc = fcs(data);
+        data.push_back(crc & 0xFF);
+        data.push_back(crc >> 8);
+
+        size_t start = stream.bits.size();
+        stream.frame(data, rng() % 16 == 0);
+
+        // Some bit errors, and sometimes a lock drop in the frame.
+        if (rng() % 4 == 0)
+        {
+            size_t index = start + rng() % (stream.bits.size() - start);
+            stream.bits[index] ^= 1;
+        }
+        if (rng() % 8 == 0)
+        {
+            size_t index = start + rng() % (stream.bits.size() - start);
+            size_t length = 1 + rng() % 40;
+            for (size_t i = index; i != std::min(index + length, stream.bits.size()); ++i)
+            {
+                stream.locked[i] = false;
+            }
+        }
+        stream.lock = rng() % 4 != 0;
+        stream.noise(rng() % 64, rng);
+    }
+
+    std::vector<Decoded> expected, actual;
+
+    Descrambler descrambler;
+    NRZI nrzi;
+    hdlc::NewDecoder baseline(passall);
+    Fsk9600PhaseDecoder batched;
+    batched.hdlc_decoder_.setPassall(passall);
+    baseline.setDCD(dcd);
+    batched.hdlc_decoder_.setDCD(dcd);
+
+    bool active_ok = true;
+    for (size_t i = 0; i != stream.bits.size(); ++i)
+    {
+        bool bit = stream.bits[i];
+        bool locked = stream.locked[i];
+        collect(baseline(nrzi.decode(descrambler(bit)), locked), i, expected);
+        collect(batched(bit, locked), i, actual);
+        active_ok &= baseline.active() == batched.hdlc_decoder_.active();
+    }
+
+    bool ok = expected.size() == actual.size();
+    for (size_t i = 0; ok and i != expected.size(); ++i)
+    {
+        ok = expected[i].ok == actual[i].ok and expected[i].data == actual[i].data
+            and actual[i].bit <= expected[i].bit;
+    }
+
+    for (auto& frame : expected) good += frame.ok;
+    sent += stream.frames_sent;
+
+    std::printf("  seed %u passall %d dcd %d: %zu frames, %s, active() %s\n", seed, passall,
+        int(dcd), expected.size(), ok ? "same" : "DIFFERENT", active_ok ? "same" : "DIFFERENT");
+    return ok and active_ok;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+    size_t good = 0;
+    size_t sent = 0;
+
+    std::printf("Batched vs per-bit G3RUH receive chain:\n");
+    for (uint32_t seed = 1; seed != 13; ++seed)
+    {
+        ok &= run(seed, seed & 1, hdlc::NewDecoder::DCD(seed % 3), good, sent);
+    }
+    std::printf("  %zu good frames of %zu sent without an abort\n", good, sent);
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
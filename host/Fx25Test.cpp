@@ -0,0 +1,132 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host test for the FX.25 codeword layout in TNC/Fx25.cpp.  This is not
+ * part of the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I host/stubs -I TNC -I TNC/boost host/Fx25Test.cpp \
+ *       TNC/Fx25.cpp TNC/HdlcDecoder.cpp TNC/HdlcFrame.cpp \
+ *       host/stubs/HostSupport.cpp -o fx25_test
+ *   ./fx25_test
+ *
+ * The reference codeword is an RS(48,32) block holding a short AX.25 UI
+ * frame.  Its parity was computed by a separate polynomial-division RS
+ * encoder (GF(2^8) 0x11D, roots alpha^1 to alpha^16) using the Dire Wolf
+ * FX.25 layout: the data, zeros up to 239 bytes, then the parity.  It was
+ * not captured from Dire Wolf itself.  With the zeros in front of the data
+ * instead, the parity starts 49 4F 70 14.
+ */
+
+#include "Fx25.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace mobilinkd::tnc;
+
+namespace {
+
+// APRS <- N0CALL-1, UI, "FX.25" with FCS.
+constexpr std::array<uint8_t, 24> FRAME = {
+    0x82, 0xA0, 0xA4, 0xA6, 0x40, 0x40, 0x60, 0x9C,
+    0x60, 0x86, 0x82, 0x98, 0x98, 0x63, 0x03, 0xF0,
+    0x3E, 0x46, 0x58, 0x2E, 0x32, 0x35, 0x9C, 0xD8
+};
+
+// The flags, bit-stuffed frame, and flag fill, as sent (LSB first).
+constexpr std::array<uint8_t, 32> DATA = {
+    0x7E, 0x82, 0xA0, 0xA4, 0xA6, 0x40, 0x40, 0x60,
+    0x9C, 0x60, 0x86, 0x82, 0x98, 0x98, 0x63, 0x03,
+    0xF0, 0x3E, 0x8C, 0xB0, 0x5C, 0x64, 0x6A, 0x38,
+    0xB1, 0xFD, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC
+};
+
+constexpr std::array<uint8_t, 16> PARITY = {
+    0x56, 0xA5, 0x5D, 0x41, 0xA0, 0xF8, 0xC1, 0xBE,
+    0x63, 0xC4, 0x7E, 0x0E, 0xE9, 0x0E, 0xCF, 0x36
+};
+
+const fx25::Tag& rs48_32()
+{
+    return *fx25::select_tag(DATA.size(), 16);
+}
+
+bool check_encode()
+{
+    std::array<uint8_t, fx25::MAX_CODEWORD> codeword;
+    codeword.fill(0xAA);    // The encoder must zero-fill, not rely on the caller.
+    std::copy(DATA.begin(), DATA.end(), codeword.begin());
+    fx25::encode(rs48_32(), codeword.data());
+
+    bool ok = std::equal(PARITY.begin(), PARITY.end(), codeword.begin() + DATA.size());
+    std::printf("  encode RS(48,32) parity: %s\n", ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+/**
+ * Send the tag and codeword, with @p errors random byte errors, through
+ * the FX.25 receiver and check that the frame comes out.
+ */
+bool check_receive(size_t errors, std::mt19937& rng)
+{
+    std::array<uint8_t, 48> codeword;
+    std::copy(DATA.begin(), DATA.end(), codeword.begin());
+    std::copy(PARITY.begin(), PARITY.end(), codeword.begin() + DATA.size());
+
+    std::array<size_t, 48> positions;
+    for (size_t i = 0; i != positions.size(); ++i) positions[i] = i;
+    std::shuffle(positions.begin(), positions.end(), rng);
+    for (size_t i = 0; i != errors; ++i)
+    {
+        codeword[positions[i]] ^= std::uniform_int_distribution<int>(1, 255)(rng);
+    }
+
+    fx25::Decoder decoder;
+    hdlc::IoFrame* frame = nullptr;
+
+    // Some preamble flags, then the tag and codeword, LSB first.
+    for (size_t i = 0; i != 32; ++i) decoder((0x7E >> (i & 7)) & 1);
+    for (size_t i = 0; i != 64; ++i) decoder((rs48_32().value >> i) & 1);
+    for (auto byte : codeword)
+    {
+        for (size_t i = 0; i != 8; ++i)
+        {
+            auto result = decoder((byte >> i) & 1);
+            if (result) frame = result;
+        }
+    }
+
+    bool ok = frame != nullptr and frame->ok()
+        and frame->size() == FRAME.size()
+        and std::equal(FRAME.begin(), FRAME.end(), frame->begin());
+    if (frame) hdlc::release(frame);
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+    std::mt19937 rng(25);
+
+    std::printf("FX.25:\n");
+    ok &= check_encode();
+
+    for (size_t errors : {0, 1, 4, 8})
+    {
+        size_t failures = 0;
+        for (size_t i = 0; i != 1000; ++i) failures += !check_receive(errors, rng);
+        std::printf("  receive with %zu byte errors: %zu/1000 failed\n", errors, failures);
+        ok &= failures == 0;
+    }
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
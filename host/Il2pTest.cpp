@@ -0,0 +1,304 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host test for the IL2P framing in TNC/Il2p.cpp.  This is not part of
+ * the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I host/stubs -I TNC -I TNC/boost host/Il2pTest.cpp \
+ *       TNC/Il2p.cpp TNC/HdlcFrame.cpp host/stubs/HostSupport.cpp \
+ *       -o il2p_test
+ *   ./il2p_test
+ *
+ * These are round-trip and consistency tests of this implementation only:
+ *
+ *  - scramble() followed by descramble() returns the data;
+ *  - encode_header() followed by decode_header() rebuilds the AX.25
+ *    addresses, control and PID, for type 1 and type 0 headers;
+ *  - layout() splits every payload size into blocks as the IL2P spec
+ *    describes (at most 247 or 239 data bytes, sizes within one byte,
+ *    larger blocks first);
+ *  - frames sent as HDLCEncoder::il2p_send() sends them come out of
+ *    il2p::Decoder intact, with correctable byte errors in every block,
+ *    inverted polarity and a sync word bit error.
+ *
+ * No frames from another IL2P implementation were available, so
+ * interoperability is not tested here.
+ */
+
+#include "Il2p.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd::tnc;
+
+namespace {
+
+using bytes = std::vector<uint8_t>;
+
+uint16_t fcs(const bytes& data)
+{
+    uint16_t crc = 0xFFFF;
+    for (auto byte : data)
+    {
+        crc ^= byte;
+        for (int i = 0; i != 8; ++i) crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+    return crc ^ 0xFFFF;
+}
+
+/// AX.25 address field for @p call (up to six characters).
+void address(bytes& frame, const char* call, uint8_t ssid, bool c_bit, bool last)
+{
+    size_t n = strlen(call);
+    for (size_t i = 0; i != 6; ++i) frame.push_back((i < n ? call[i] : ' ') << 1);
+    frame.push_back((c_bit << 7) | 0x60 | (ssid << 1) | last);
+}
+
+bytes ax25(const char* dest, const char* src, bool command, uint8_t control,
+    int pid, size_t info_size, std::mt19937& rng, const char* digi = nullptr)
+{
+    bytes frame;
+    address(frame, dest, 3, command, false);
+    address(frame, src, 12, !command, digi == nullptr);
+    if (digi) address(frame, digi, 0, false, true);
+    frame.push_back(control);
+    if (pid >= 0) frame.push_back(pid);
+    for (size_t i = 0; i != info_size; ++i) frame.push_back(rng());
+    return frame;
+}
+
+struct Case
+{
+    const char* name;
+    bytes frame;
+    bool type1;
+};
+
+std::vector<Case> cases(std::mt19937& rng)
+{
+    return {
+        {"UI, PID F0", ax25("APRS", "N0CALL", true, 0x03, 0xF0, 40, rng), true},
+        {"UI response, P/F", ax25("APRS", "N0CALL", false, 0x13, 0xCF, 8, rng), true},
+        {"I frame", ax25("K1ABC", "W2XYZ", true, 0xA4 | 0x10, 0xF0, 200, rng), true},
+        {"RR response", ax25("K1ABC", "W2XYZ", false, 0x61, -1, 0, rng), true},
+        {"REJ command", ax25("K1ABC", "W2XYZ", true, 0x49, -1, 0, rng), true},
+        {"SABM", ax25("K1ABC", "W2XYZ", true, 0x3F, -1, 0, rng), true},
+        {"UA", ax25("W2XYZ", "K1ABC", false, 0x73, -1, 0, rng), true},
+        {"DISC", ax25("K1ABC", "W2XYZ", true, 0x53, -1, 0, rng), true},
+        {"TEST with info", ax25("K1ABC", "W2XYZ", true, 0xE3, -1, 20, rng), true},
+        {"digipeater", ax25("APRS", "N0CALL", true, 0x03, 0xF0, 30, rng, "WIDE1"), false},
+        {"lower case call", ax25("aprs", "N0CALL", true, 0x03, 0xF0, 30, rng), false},
+        {"PID not in table", ax25("APRS", "N0CALL", true, 0x03, 0x42, 30, rng), false},
+        {"large UI", ax25("APRS", "N0CALL", true, 0x03, 0xF0, 1000, rng), true},
+        {"large type 0", ax25("APRS", "N0CALL", true, 0x03, 0x42, 1000, rng), false},
+    };
+}
+
+bool check_scrambler(std::mt19937& rng)
+{
+    size_t failures = 0;
+    for (size_t size = 1; size <= il2p::MAX_BLOCK; ++size)
+    {
+        bytes data(size);
+        for (auto& byte : data) byte = rng();
+        bytes scrambled = data;
+        il2p::scramble(scrambled.data(), size);
+        bytes descrambled = scrambled;
+        il2p::descramble(descrambled.data(), size);
+        failures += descrambled != data or (size > 4 and scrambled == data);
+    }
+    std::printf("  scrambler round trip, 1-255 bytes: %s\n", failures ? "FAILED" : "ok");
+    return failures == 0;
+}
+
+bool check_header(const Case& c)
+{
+    bytes prefix(c.frame.begin(), c.frame.begin()
+        + std::min(c.frame.size(), il2p::AX25_HEADER_SIZE));
+
+    il2p::Header header;
+    if (!il2p::encode_header(prefix.data(), c.frame.size(), false, header))
+    {
+        std::printf("  header %-18s encode FAILED\n", c.name);
+        return false;
+    }
+
+    auto frame = hdlc::acquire();
+    il2p::Header decoded;
+    bool ok = il2p::decode_header(header.data.data(), frame, decoded);
+    ok = ok and (header.payload_offset != 0) == c.type1
+        and decoded.payload_offset == header.payload_offset
+        and decoded.payload_size == header.payload_size
+        and header.payload_offset + header.payload_size == c.frame.size()
+        and std::equal(frame->begin(), frame->end(), c.frame.begin());
+    hdlc::release(frame);
+
+    std::printf("  header %-18s type %d: %s\n", c.name, c.type1 ? 1 : 0, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+bool check_layout()
+{
+    size_t failures = 0;
+    for (bool max_fec : {false, true})
+    {
+        const size_t max_block = max_fec ? 239 : 247;
+        for (size_t size = 1; size <= il2p::MAX_PAYLOAD; ++size)
+        {
+            auto layout = il2p::layout(size, max_fec);
+            size_t total = 0;
+            bool ok = layout.count == (size + max_block - 1) / max_block;
+            for (size_t i = 0; i != layout.count; ++i)
+            {
+                auto n = layout.data_size(i);
+                ok = ok and n <= max_block and n >= layout.data_size(layout.count - 1)
+                    and n - layout.data_size(layout.count - 1) <= 1;
+                total += n;
+                size_t small = layout.data_size(layout.count - 1);
+                uint8_t parity = max_fec ? 16 : small <= 61 ? 2 : small <= 123 ? 4
+                    : small <= 185 ? 6 : 8;
+                ok = ok and layout.parity == parity;
+            }
+            failures += !(ok and total == size);
+        }
+    }
+    std::printf("  layout, 1-1023 bytes: %s\n", failures ? "FAILED" : "ok");
+    return failures == 0;
+}
+
+/// A Reed-Solomon block in the bit stream.
+struct Block
+{
+    size_t start;       ///< Byte offset.
+    size_t size;        ///< Bytes, including parity.
+    uint8_t parity;
+};
+
+/// The bits HDLCEncoder::il2p_send() sends for @p frame, MSB first.
+std::vector<bool> send(const bytes& frame, bool max_fec, std::vector<Block>& blocks)
+{
+    std::vector<bool> bits;
+    auto send_msb = [&](uint8_t byte) {
+        for (int i = 7; i >= 0; --i) bits.push_back((byte >> i) & 1);
+    };
+    std::array<uint8_t, il2p::MAX_BLOCK> codeword;
+    auto send_block = [&](size_t size, uint8_t parity) {
+        blocks.push_back({bits.size() / 8, size + parity, parity});
+        il2p::scramble(codeword.data(), size);
+        il2p::encode_block(codeword.data(), size, parity);
+        for (size_t i = 0; i != size + parity; ++i) send_msb(codeword[i]);
+    };
+
+    for (int i = 0; i != 4; ++i) send_msb(il2p::PREAMBLE);
+
+    il2p::Header header;
+    il2p::encode_header(frame.data(), frame.size(), max_fec, header);
+
+    send_msb(uint8_t(il2p::SYNC_WORD >> 16));
+    send_msb(uint8_t(il2p::SYNC_WORD >> 8));
+    send_msb(uint8_t(il2p::SYNC_WORD));
+
+    std::copy(header.data.begin(), header.data.end(), codeword.begin());
+    send_block(il2p::HEADER_SIZE, il2p::HEADER_PARITY);
+
+    auto layout = il2p::layout(header.payload_size, max_fec);
+    auto it = frame.begin() + header.payload_offset;
+    for (size_t i = 0; i != layout.count; ++i)
+    {
+        auto data_size = layout.data_size(i);
+        std::copy_n(it, data_size, codeword.begin());
+        it += data_size;
+        send_block(data_size, layout.parity);
+    }
+    for (int i = 0; i != 2; ++i) send_msb(il2p::PREAMBLE);
+    return bits;
+}
+
+/**
+ * Send @p c through the decoder.  Each block gets as many random byte
+ * errors as its parity can correct.
+ */
+bool check_frame(const Case& c, bool max_fec, bool invert, std::mt19937& rng)
+{
+    std::vector<Block> blocks;
+    auto bits = send(c.frame, max_fec, blocks);
+
+    for (auto& block : blocks)
+    {
+        std::vector<size_t> positions(block.size);
+        for (size_t i = 0; i != block.size; ++i) positions[i] = i;
+        std::shuffle(positions.begin(), positions.end(), rng);
+        for (size_t i = 0; i != block.parity / 2u; ++i)
+        {
+            size_t byte = block.start + positions[i];
+            uint8_t error = std::uniform_int_distribution<int>(1, 255)(rng);
+            for (int j = 0; j != 8; ++j) bits[byte * 8 + j] = bits[byte * 8 + j] ^ ((error >> j) & 1);
+        }
+    }
+
+    // One bit error in the sync word, after the preamble.
+    size_t sync_bit = 32 + rng() % 24;
+    bits[sync_bit] = !bits[sync_bit];
+
+    il2p::Decoder decoder;
+    hdlc::IoFrame* frame = nullptr;
+    for (bool bit : bits)
+    {
+        auto result = decoder(bit ^ invert);
+        if (result) frame = result;
+    }
+
+    bytes expected = c.frame;
+    auto crc = fcs(expected);
+    expected.push_back(crc & 0xFF);
+    expected.push_back(crc >> 8);
+
+    bool ok = frame != nullptr and frame->size() == expected.size()
+        and std::equal(expected.begin(), expected.end(), frame->begin());
+    if (frame) hdlc::release(frame);
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+    std::mt19937 rng(37);
+    auto all = cases(rng);
+
+    std::printf("IL2P:\n");
+    ok &= check_scrambler(rng);
+    for (auto& c : all) ok &= check_header(c);
+    ok &= check_layout();
+
+    for (bool max_fec : {false, true})
+    {
+        size_t failures = 0;
+        size_t count = 0;
+        for (auto& c : all)
+        {
+            for (bool invert : {false, true})
+            {
+                for (size_t i = 0; i != 20; ++i, ++count)
+                {
+                    failures += !check_frame(c, max_fec, invert, rng);
+                }
+            }
+        }
+        std::printf("  decode with errors, %s: %zu/%zu failed\n",
+            max_fec ? "max FEC" : "baseline FEC", failures, count);
+        ok &= failures == 0;
+    }
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
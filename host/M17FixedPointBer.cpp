@@ -0,0 +1,307 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host comparison of the float and q15 (M17_FIXED_POINT) M17 receive
+ * front ends.  This is not part of the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I TNC host/M17FixedPointBer.cpp TNC/M17.cpp \
+ *       -o m17_fixed_ber
+ *   ./m17_fixed_ber
+ *
+ * Random 4FSK symbols are shaped with the transmit RRC filter, quantized
+ * to 14-bit ADC samples with Gaussian noise added at each Es/N0, and then
+ * passed through both matched filters:
+ *
+ *  - float: samples scaled by 1/32768 and filtered with rrc_taps_f, as
+ *    arm_fir_f32 does;
+ *  - q15: samples filtered with the q15 taps from m17::make_rrc_taps_q15()
+ *    (as RrcFilter<int16_t>::init() uses them) and a 32-bit accumulator
+ *    shifted right by 15, as arm_fir_fast_q15 does, then converted with
+ *    m17::RRC_Q15_SCALE as RrcFilter<int16_t>::to_float() does.
+ *
+ * Symbols are sliced at the ideal sample point with thresholds taken from
+ * the noise-free float output, and Gray-coded bit errors are counted.  The
+ * program also reports the difference in the converted filter outputs, in
+ * the LSF sync word correlation normalized by the signal level estimate
+ * (the quantity the sync word trigger compares), and the two envelope
+ * trackers in Correlator.h.
+ *
+ * It exits non-zero if the q15 BER is more than 10% (relative) above the
+ * float BER at any Es/N0 where the float path sees at least 100 bit errors,
+ * or if any q15 accumulator overflows.
+ */
+
+#include "M17.h"
+#include "IirFilter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+namespace {
+
+constexpr size_t SAMPLES_PER_SYMBOL = 10;
+constexpr size_t TAPS = m17::FILTER_TAP_NUM;
+constexpr size_t SYMBOLS = 200000;
+constexpr int ADC_FULL_SCALE = 8191;                ///< 14-bit, centred.
+
+// Envelope tracker constants from Correlator.h.
+constexpr std::array<float,3> IIR_B = {4.24433681e-05, 8.48867363e-05, 4.24433681e-05};
+constexpr std::array<float,3> IIR_A = {1.0, -1.98148851,  0.98165828};
+constexpr int ENVELOPE_SHIFT = 6;
+constexpr int ENVELOPE_FRAC_BITS = 8;
+
+// LSF sync word 0x55F7 as symbols.
+constexpr std::array<int8_t, 8> LSF_SYNC_SYMBOLS = {+3, +3, +3, +3, -3, -3, +3, -3};
+
+std::mt19937 rng{17};
+
+/// M17 dibit (Gray) mapping: +1 = 00, +3 = 01, -1 = 10, -3 = 11.
+uint8_t symbol_bits(int symbol)
+{
+    switch (symbol)
+    {
+    case 1: return 0;
+    case 3: return 1;
+    case -1: return 2;
+    default: return 3;
+    }
+}
+
+struct Result
+{
+    size_t bit_errors_float = 0;
+    size_t bit_errors_q15 = 0;
+    size_t bits = 0;
+    double max_sample_error = 0;     ///< Relative to the outer symbol level.
+    double max_sync_error = 0;       ///< Relative error in correlation / level.
+    double mean_limit_ratio = 0;     ///< q15 / float envelope.
+    size_t overflows = 0;
+    int delay_difference = 0;        ///< q15 - float sample delay.
+};
+
+/// ADC samples for @p symbols at @p level (fraction of full scale) with
+/// noise for @p esn0 dB.  Infinite Es/N0 gives a clean signal.
+std::vector<int16_t> make_adc(const std::vector<int8_t>& symbols, float level, float esn0)
+{
+    // Upsample and shape.  The RRC taps have unity gain at the symbol
+    // centre after matched filtering with 10 samples per symbol.
+    std::vector<float> shaped(symbols.size() * SAMPLES_PER_SYMBOL + TAPS, 0.f);
+    for (size_t i = 0; i != symbols.size(); ++i)
+    {
+        for (size_t j = 0; j != TAPS; ++j)
+        {
+            shaped[i * SAMPLES_PER_SYMBOL + j] += symbols[i] * m17::rrc_taps_f[j];
+        }
+    }
+
+    float peak = 0.f;
+    for (auto x : shaped) peak = std::max(peak, std::fabs(x));
+    const float gain = level * ADC_FULL_SCALE / peak;
+
+    // The mean symbol energy is 5 (for +/-1, +/-3) times the pulse energy.
+    // The noise is white at the ADC, with N0/2 per sample.
+    float tap_energy = 0.f;
+    for (auto t : m17::rrc_taps_f) tap_energy += t * t;
+    const float es = 5.f * tap_energy * gain * gain;
+    const float sigma = std::isinf(esn0) ? 0.f
+        : std::sqrt(es / std::pow(10.f, esn0 / 10.f) / 2.f);
+    std::normal_distribution<float> noise{0.f, sigma};
+
+    std::vector<int16_t> adc(shaped.size());
+    for (size_t i = 0; i != shaped.size(); ++i)
+    {
+        float x = std::round(shaped[i] * gain + noise(rng));
+        adc[i] = std::clamp<float>(x, -ADC_FULL_SCALE - 1, ADC_FULL_SCALE);
+    }
+    return adc;
+}
+
+std::vector<float> filter_float(const std::vector<int16_t>& adc)
+{
+    std::vector<float> out(adc.size(), 0.f);
+    for (size_t i = TAPS - 1; i < adc.size(); ++i)
+    {
+        float acc = 0.f;
+        for (size_t j = 0; j != TAPS; ++j)
+        {
+            acc += m17::rrc_taps_f[j] * (float(adc[i - j]) * (1.f / 32768.f));
+        }
+        out[i] = acc;
+    }
+    return out;
+}
+
+std::vector<int16_t> filter_q15(const std::vector<int16_t>& adc, size_t& overflows)
+{
+    const auto taps = m17::make_rrc_taps_q15(1);
+
+    std::vector<int16_t> out(adc.size(), 0);
+    for (size_t i = TAPS - 1; i < adc.size(); ++i)
+    {
+        int64_t acc = 0;
+        for (size_t j = 0; j != TAPS; ++j) acc += int32_t(taps[j]) * adc[i - j];
+        if (acc > INT32_MAX or acc < INT32_MIN) ++overflows;
+        out[i] = std::clamp<int32_t>(int32_t(acc) >> 15, -32768, 32767);
+    }
+    return out;
+}
+
+Result run(float level, float esn0)
+{
+    std::vector<int8_t> symbols(SYMBOLS);
+    const int8_t values[] = {-3, -1, 1, 3};
+    for (auto& s : symbols) s = values[rng() % 4];
+    // Sync words at regular intervals for the correlation comparison.
+    for (size_t i = 100; i + 8 < SYMBOLS; i += 192)
+    {
+        std::copy(LSF_SYNC_SYMBOLS.begin(), LSF_SYNC_SYMBOLS.end(), symbols.begin() + i);
+    }
+
+    Result result;
+
+    // Each path samples at the delay with the widest clean eye, as the
+    // clock recovery would.  The two filters need not have the same delay.
+    auto clean_adc = make_adc(symbols, level, INFINITY);
+    auto clean_f = filter_float(clean_adc);
+    auto clean_q = filter_q15(clean_adc, result.overflows);
+
+    auto outer_level = [&symbols](auto&& y, size_t delay, float scale) {
+        double sum = 0;
+        size_t count = 0;
+        for (size_t i = 0; i != SYMBOLS; ++i)
+        {
+            if (std::abs(symbols[i]) != 3) continue;
+            sum += y[i * SAMPLES_PER_SYMBOL + delay] * scale * (symbols[i] > 0 ? 1 : -1);
+            ++count;
+        }
+        return float(sum / count);
+    };
+
+    auto best_delay = [&](auto&& y, float scale) {
+        size_t best = 0;
+        float best_level = 0;
+        for (size_t delay = TAPS - 4; delay != TAPS + 2; ++delay)
+        {
+            float level = outer_level(y, delay, scale);
+            if (level > best_level)
+            {
+                best_level = level;
+                best = delay;
+            }
+        }
+        return best;
+    };
+
+    const size_t delay_f = best_delay(clean_f, 1.f);
+    const size_t delay_q = best_delay(clean_q, m17::RRC_Q15_SCALE);
+    result.delay_difference = int(delay_q) - int(delay_f);
+
+    const float level_f = outer_level(clean_f, delay_f, 1.f);
+    const float threshold = level_f * 2.f / 3.f;
+
+    auto adc = make_adc(symbols, level, esn0);
+    auto yf = filter_float(adc);
+    auto yq = filter_q15(adc, result.overflows);
+
+    auto slice = [threshold](float y) {
+        return y > threshold ? 3 : y > 0 ? 1 : y > -threshold ? -1 : -3;
+    };
+
+    // Envelope trackers, run over every sample as in Correlator::sample().
+    tnc::IirFilter<3> iir{IIR_B, IIR_A};
+    std::array<int32_t, 2> envelope = {0, 0};
+    std::vector<float> limit_f(yf.size()), limit_q(yq.size());
+    double ratio_sum = 0;
+    size_t ratio_count = 0;
+    for (size_t i = 0; i != yf.size(); ++i)
+    {
+        limit_f[i] = iir(std::fabs(yf[i]));
+        int32_t x = std::abs(int32_t(yq[i])) << ENVELOPE_FRAC_BITS;
+        envelope[0] += (x - envelope[0]) >> ENVELOPE_SHIFT;
+        envelope[1] += (envelope[0] - envelope[1]) >> ENVELOPE_SHIFT;
+        limit_q[i] = envelope[1] * (1.f / (1 << ENVELOPE_FRAC_BITS)) * m17::RRC_Q15_SCALE;
+        if (i > 5000 and limit_f[i] > 0)
+        {
+            ratio_sum += limit_q[i] / limit_f[i];
+            ++ratio_count;
+        }
+    }
+    result.mean_limit_ratio = ratio_sum / ratio_count;
+
+    for (size_t i = 8; i != SYMBOLS; ++i)
+    {
+        size_t n = i * SAMPLES_PER_SYMBOL + delay_f;
+        size_t m = i * SAMPLES_PER_SYMBOL + delay_q;
+        float f = yf[n];
+        float q = yq[m] * m17::RRC_Q15_SCALE;
+
+        result.max_sample_error = std::max<double>(result.max_sample_error,
+            std::fabs(f - q) / level_f);
+
+        uint8_t bits = symbol_bits(symbols[i]);
+        result.bit_errors_float += __builtin_popcount(bits ^ symbol_bits(slice(f)));
+        result.bit_errors_q15 += __builtin_popcount(bits ^ symbol_bits(slice(q)));
+        result.bits += 2;
+
+        // Correlation over the last 8 symbols, as Correlator::correlate().
+        // Compare only at the sync word peaks, after the trackers settle.
+        if ((i - 108) % 192 != 0 or n < 5000) continue;
+        float cf = 0;
+        int32_t cq = 0;
+        for (size_t k = 0; k != 8; ++k)
+        {
+            cf += LSF_SYNC_SYMBOLS[k] * yf[n - (8 - k) * SAMPLES_PER_SYMBOL];
+            cq += LSF_SYNC_SYMBOLS[k] * yq[m - (8 - k) * SAMPLES_PER_SYMBOL];
+        }
+        float nf = cf / limit_f[n - SAMPLES_PER_SYMBOL];
+        float nq = cq * m17::RRC_Q15_SCALE / limit_q[m - SAMPLES_PER_SYMBOL];
+        result.max_sync_error = std::max<double>(result.max_sync_error,
+            std::fabs(nq - nf) / std::fabs(nf));
+    }
+
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+    const float levels[] = {0.5f, 0.05f};     // -6dBFS and -26dBFS peak.
+    const float esn0s[] = {8.f, 10.f, 12.f, 14.f, 16.f, INFINITY};
+
+    for (auto level : levels)
+    {
+        std::printf("Input peak %.0fdBFS\n", 20 * std::log10(level));
+        std::printf("  Es/N0  BER float   BER q15     sample err  sync err  limit q15/float\n");
+        for (auto esn0 : esn0s)
+        {
+            auto r = run(level, esn0);
+            double ber_f = double(r.bit_errors_float) / r.bits;
+            double ber_q = double(r.bit_errors_q15) / r.bits;
+            std::printf("  %4.0fdB %.3e  %.3e  %9.5f  %8.5f  %6.3f\n", esn0, ber_f, ber_q,
+                r.max_sample_error, r.max_sync_error, r.mean_limit_ratio);
+
+            if (r.overflows)
+            {
+                std::printf("  %zu q15 accumulator overflows\n", r.overflows);
+                ok = false;
+            }
+            if (r.bit_errors_float >= 100 and ber_q > ber_f * 1.1) ok = false;
+        }
+    }
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
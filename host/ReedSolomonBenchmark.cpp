@@ -0,0 +1,194 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host benchmark and self-check for TNC/ReedSolomon.h.  This is not part
+ * of the firmware build.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++20 -O2 -I TNC host/ReedSolomonBenchmark.cpp -o rs_bench
+ *   ./rs_bench
+ *
+ * To compare against an earlier codec, extract its header and build with
+ * RS_BENCH_BASELINE defined, which skips the checks that need erasure
+ * decoding or a PRIM template parameter:
+ *
+ *   mkdir -p /tmp/rs_old
+ *   git show <commit>:TNC/ReedSolomon.h > /tmp/rs_old/ReedSolomon.h
+ *   g++ -std=c++20 -O2 -DRS_BENCH_BASELINE -I /tmp/rs_old \
+ *       host/ReedSolomonBenchmark.cpp -o rs_bench_old
+ *
+ * Each decode case corrupts a fresh copy of a valid codeword with the
+ * given number of random byte errors and reports codewords per second.
+ * The copy is included in the timing, so the clean case mostly measures
+ * the syndrome computation.
+ */
+
+#include "ReedSolomon.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+namespace {
+
+std::mt19937 rng{0x5EED};
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr double MIN_SECONDS = 0.5;
+
+/// Pick @p count distinct positions in [0, size).
+std::vector<uint8_t> positions(size_t size, size_t count)
+{
+    std::vector<uint8_t> result;
+    while (result.size() != count)
+    {
+        uint8_t p = rng() % size;
+        if (std::find(result.begin(), result.end(), p) == result.end()) result.push_back(p);
+    }
+    return result;
+}
+
+template <typename RS>
+std::vector<uint8_t> make_codeword(size_t size)
+{
+    constexpr size_t NROOTS = std::tuple_size_v<typename RS::parity_type>;
+    std::vector<uint8_t> codeword(size);
+    for (size_t i = 0; i != size - NROOTS; ++i) codeword[i] = rng();
+    RS::encode(codeword.data(), size - NROOTS, codeword.data() + size - NROOTS);
+    return codeword;
+}
+
+/// Report codewords per second for @p fn, run repeatedly for MIN_SECONDS.
+template <typename F>
+double rate(F fn)
+{
+    size_t count = 0;
+    auto start = clock_type::now();
+    double elapsed = 0.0;
+    do
+    {
+        for (size_t i = 0; i != 1000; ++i) fn();
+        count += 1000;
+        elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+    } while (elapsed < MIN_SECONDS);
+    return count / elapsed;
+}
+
+void print_rate(const char* name, double r)
+{
+    if (r >= 1e6) std::printf("  %-26s %6.2fM/s\n", name, r / 1e6);
+    else std::printf("  %-26s %6.1fk/s\n", name, r / 1e3);
+}
+
+template <typename RS>
+bool bench_decode(const char* name, size_t size, size_t errors)
+{
+    auto original = make_codeword<RS>(size);
+
+    // A small set of error patterns, so that the pattern generation is not
+    // timed, but the branch predictor does not learn a single pattern.
+    constexpr size_t PATTERNS = 64;
+    std::vector<std::vector<uint8_t>> corrupted;
+    for (size_t i = 0; i != PATTERNS; ++i)
+    {
+        auto c = original;
+        for (auto p : positions(size, errors)) c[p] ^= 1 + rng() % 255;
+        corrupted.push_back(c);
+    }
+
+    std::vector<uint8_t> work(size);
+    size_t index = 0;
+    bool ok = true;
+    double r = rate([&] {
+        auto& c = corrupted[index++ % PATTERNS];
+        std::memcpy(work.data(), c.data(), size);
+        int result = RS::decode(work.data(), size);
+        if (result != int(errors) or work != original) ok = false;
+    });
+
+    print_rate(name, r);
+    if (!ok) std::printf("  %s: decode FAILED\n", name);
+    return ok;
+}
+
+template <typename RS>
+void bench_encode(const char* name, size_t size)
+{
+    constexpr size_t NROOTS = std::tuple_size_v<typename RS::parity_type>;
+    auto codeword = make_codeword<RS>(size);
+    double r = rate([&] {
+        RS::encode(codeword.data(), size - NROOTS, codeword.data() + size - NROOTS);
+        codeword[0] += 1;
+    });
+    print_rate(name, r);
+}
+
+#ifndef RS_BENCH_BASELINE
+
+/**
+ * Decode random error and erasure patterns with 2 * errors + erasures up
+ * to NROOTS.  Some erasures are given for bytes which are not in error.
+ */
+template <typename RS>
+bool check_erasures(const char* name, size_t size, size_t trials)
+{
+    constexpr size_t NROOTS = std::tuple_size_v<typename RS::parity_type>;
+    size_t failures = 0;
+
+    for (size_t trial = 0; trial != trials; ++trial)
+    {
+        auto original = make_codeword<RS>(size);
+        size_t erasure_count = rng() % (NROOTS + 1);
+        size_t error_count = rng() % ((NROOTS - erasure_count) / 2 + 1);
+
+        auto p = positions(size, erasure_count + error_count);
+        auto c = original;
+        for (auto i : p) if (rng() % 4) c[i] ^= 1 + rng() % 255;
+
+        int result = RS::decode(c.data(), size, p.data(), erasure_count);
+        if (result < 0 or c != original) ++failures;
+    }
+
+    std::printf("  %-26s %zu/%zu failed\n", name, failures, trials);
+    return failures == 0;
+}
+
+#endif
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+
+    std::printf("Decode (codewords/s):\n");
+    ok &= bench_decode<ReedSolomon<16>>("RS(255,239) clean", 255, 0);
+    ok &= bench_decode<ReedSolomon<16>>("RS(255,239) 8 errors", 255, 8);
+    ok &= bench_decode<ReedSolomon<32>>("RS(255,223) 16 errors", 255, 16);
+    ok &= bench_decode<ReedSolomon<64>>("RS(255,191) 32 errors", 255, 32);
+    ok &= bench_decode<ReedSolomon<16>>("RS(100,84) 4 errors", 100, 4);
+    ok &= bench_decode<ReedSolomon<2>>("RS(15,13) 1 error", 15, 1);
+
+    std::printf("Encode (codewords/s):\n");
+    bench_encode<ReedSolomon<16>>("RS(255,239)", 255);
+
+#ifndef RS_BENCH_BASELINE
+    std::printf("Errors and erasures:\n");
+    ok &= check_erasures<ReedSolomon<16>>("RS(255,239)", 255, 10000);
+    ok &= check_erasures<ReedSolomon<32>>("RS(255,223)", 255, 10000);
+    ok &= check_erasures<ReedSolomon<16, 0>>("RS(100,84) FCR 0", 100, 10000);
+    ok &= check_erasures<ReedSolomon<32, 112, 11>>("RS(255,223) FCR 112 PRIM 11", 255, 10000);
+#endif
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
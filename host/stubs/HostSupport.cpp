@@ -0,0 +1,15 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Definitions which the firmware provides from modules that are not built
+ * into the host programs.
+ */
+
+#include "memory.hpp"
+
+namespace mobilinkd { namespace tnc { namespace memory {
+
+CriticalStats critical_stats;
+
+}}} // mobilinkd::tnc::memory
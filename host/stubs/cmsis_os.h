@@ -0,0 +1,24 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host stand-ins for the CMSIS-RTOS and FreeRTOS calls used by the
+ * protocol code in TNC/.  This is not part of the firmware build.  The
+ * host programs are single-threaded, so critical sections do nothing.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t UBaseType_t;
+
+typedef enum
+{
+    osOK = 0
+} osStatus;
+
+#define taskENTER_CRITICAL_FROM_ISR() (UBaseType_t(0))
+#define taskEXIT_CRITICAL_FROM_ISR(x) ((void)(x))
+
+inline osStatus osThreadYield() { return osOK; }
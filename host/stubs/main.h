@@ -0,0 +1,14 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host stand-in for Inc/main.h.  This is not part of the firmware build.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CxxErrorHandler() \
+    do { std::fprintf(stderr, "error at %s:%d\n", __FILE__, __LINE__); std::abort(); } while (0)
@@ -0,0 +1,73 @@
+// Copyright 2024 Rob Riggs <rob@mobilinkd.com>
+// All rights reserved.
+
+/**
+ * Host stand-ins for the parts of the STM32 HAL and CMSIS used by the
+ * protocol code in TNC/, so that it can be built into the host programs.
+ * This is not part of the firmware build.
+ *
+ * The CRC unit is modelled with the configuration from MX_CRC_Init():
+ * 16-bit polynomial 0x1021, initial value 0xFFFF, input bit-reversed by
+ * byte, output not reversed.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+typedef enum
+{
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+struct CRC_HandleTypeDef
+{
+    uint32_t state;
+};
+
+inline CRC_HandleTypeDef hcrc;
+
+inline uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef* handle, uint32_t* buffer, uint32_t length)
+{
+    auto data = reinterpret_cast<const uint8_t*>(buffer);
+    uint32_t crc = handle->state;
+    for (uint32_t i = 0; i != length; ++i)
+    {
+        uint8_t byte = data[i];
+        for (int j = 0; j != 8; ++j)
+        {
+            bool bit = ((crc >> 15) ^ (byte >> j)) & 1;
+            crc = ((crc << 1) & 0xFFFF) ^ (bit ? 0x1021 : 0);
+        }
+    }
+    handle->state = crc;
+    return crc;
+}
+
+inline uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef* handle, uint32_t* buffer, uint32_t length)
+{
+    handle->state = 0xFFFF;
+    return HAL_CRC_Accumulate(handle, buffer, length);
+}
+
+struct DWT_Type
+{
+    uint32_t CYCCNT;
+};
+
+inline DWT_Type host_dwt;
+#define DWT (&host_dwt)
+
+inline uint32_t __RBIT(uint32_t value)
+{
+    uint32_t result = 0;
+    for (int i = 0; i != 32; ++i)
+    {
+        result = (result << 1) | (value & 1);
+        value >>= 1;
+    }
+    return result;
+}